@@ -0,0 +1,1361 @@
+// Minimal in-process AviSynth host, see avs_stub.h
+//
+// This translation unit plays the role of avisynth.dll: it is compiled with
+// BUILDING_AVSCORE so that the baked member functions of avisynth.h get
+// their real bodies here, and it fills the AVS_Linkage table that the filter
+// sources call through.
+
+#define BUILDING_AVSCORE 1
+#include "avs_stub.h"
+#include "engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <malloc.h>
+#endif
+
+#define STUB_FRAME_ALIGN 64
+
+static void* stub_aligned_malloc(size_t size, size_t align)
+{
+#ifdef _MSC_VER
+  return _aligned_malloc(size, align);
+#else
+  void* p = nullptr;
+  if (posix_memalign(&p, align, size) != 0)
+    return nullptr;
+  return p;
+#endif
+}
+
+static void stub_aligned_free(void* p)
+{
+#ifdef _MSC_VER
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+static long stub_inc(volatile long* v)
+{
+#ifdef _MSC_VER
+  return _InterlockedIncrement(v);
+#else
+  return __atomic_add_fetch(v, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+static long stub_dec(volatile long* v)
+{
+#ifdef _MSC_VER
+  return _InterlockedDecrement(v);
+#else
+  return __atomic_sub_fetch(v, 1, __ATOMIC_ACQ_REL);
+#endif
+}
+
+/**********************************************************************/
+// frame properties
+
+struct StubProp {
+  char type; // 'i', 'f', 's'
+  std::vector<int64_t> i;
+  std::vector<double> f;
+  std::vector<std::string> s;
+  int size() const { return type == 'i' ? (int)i.size() : type == 'f' ? (int)f.size() : (int)s.size(); }
+};
+
+class AVSMap {
+public:
+  std::map<std::string, StubProp> data;
+};
+
+/**********************************************************************/
+// VideoInfo
+
+bool VideoInfo::HasVideo() const { return width != 0; }
+bool VideoInfo::HasAudio() const { return audio_samples_per_second != 0; }
+bool VideoInfo::IsRGB() const { return !!(pixel_type & CS_BGR); }
+bool VideoInfo::IsRGB24() const { return ((pixel_type & CS_BGR24) == CS_BGR24) && ((pixel_type & CS_Sample_Bits_Mask) == CS_Sample_Bits_8); }
+bool VideoInfo::IsRGB32() const { return ((pixel_type & CS_BGR32) == CS_BGR32) && ((pixel_type & CS_Sample_Bits_Mask) == CS_Sample_Bits_8); }
+bool VideoInfo::IsYUV() const { return !!(pixel_type & CS_YUV); }
+bool VideoInfo::IsYUY2() const { return (pixel_type & CS_YUY2) == CS_YUY2; }
+bool VideoInfo::IsYV24() const { return (pixel_type & CS_PLANAR_MASK) == (CS_YV24 & CS_PLANAR_FILTER); }
+bool VideoInfo::IsYV16() const { return (pixel_type & CS_PLANAR_MASK) == (CS_YV16 & CS_PLANAR_FILTER); }
+bool VideoInfo::IsYV12() const { return (pixel_type & CS_PLANAR_MASK) == (CS_YV12 & CS_PLANAR_FILTER); }
+bool VideoInfo::IsYV411() const { return (pixel_type & CS_PLANAR_MASK) == (CS_YV411 & CS_PLANAR_FILTER); }
+bool VideoInfo::IsY8() const { return (pixel_type & CS_PLANAR_MASK) == (CS_Y8 & CS_PLANAR_FILTER); }
+
+bool VideoInfo::IsColorSpace(int c_space) const
+{
+  return IsPlanar() ? ((pixel_type & CS_PLANAR_MASK) == (c_space & CS_PLANAR_FILTER)) : ((pixel_type & c_space) == c_space);
+}
+
+bool VideoInfo::Is(int property) const { return (image_type & property) == property; }
+bool VideoInfo::IsPlanar() const { return !!(pixel_type & CS_PLANAR); }
+bool VideoInfo::IsFieldBased() const { return !!(image_type & IT_FIELDBASED); }
+bool VideoInfo::IsParityKnown() const { return ((image_type & IT_FIELDBASED) && (image_type & (IT_BFF | IT_TFF))); }
+bool VideoInfo::IsBFF() const { return !!(image_type & IT_BFF); }
+bool VideoInfo::IsTFF() const { return !!(image_type & IT_TFF); }
+bool VideoInfo::IsVPlaneFirst() const { return !IsY() && IsPlanar() && (pixel_type & (CS_VPlaneFirst | CS_UPlaneFirst)) == CS_VPlaneFirst; }
+
+int VideoInfo::BytesFromPixels(int pixels) const
+{
+  if (IsPlanar())
+    return pixels * ComponentSize(); // luma/first plane
+  return pixels * (BitsPerPixel() >> 3);
+}
+
+int VideoInfo::RowSize(int plane) const
+{
+  const int rowsize = BytesFromPixels(width);
+  switch (plane) {
+  case PLANAR_U: case PLANAR_V: case PLANAR_U_ALIGNED: case PLANAR_V_ALIGNED:
+    if (!IsPlanar() || IsY() || IsPlanarRGB() || IsPlanarRGBA())
+      return (IsPlanarRGB() || IsPlanarRGBA()) ? rowsize : 0;
+    return rowsize >> GetPlaneWidthSubsampling(plane);
+  case PLANAR_A: case PLANAR_A_ALIGNED:
+    return (IsYUVA() || IsPlanarRGBA()) ? rowsize : 0;
+  }
+  return rowsize;
+}
+
+int VideoInfo::BMPSize() const { return RowSize() * height; }
+int64_t VideoInfo::AudioSamplesFromFrames(int) const { return 0; }
+int VideoInfo::FramesFromAudioSamples(int64_t) const { return 0; }
+int64_t VideoInfo::AudioSamplesFromBytes(int64_t) const { return 0; }
+int64_t VideoInfo::BytesFromAudioSamples(int64_t) const { return 0; }
+int VideoInfo::AudioChannels() const { return 0; }
+int VideoInfo::SampleType() const { return 0; }
+bool VideoInfo::IsSampleType(int testtype) const { return !!(sample_type & testtype); }
+int VideoInfo::SamplesPerSecond() const { return 0; }
+int VideoInfo::BytesPerAudioSample() const { return 0; }
+
+void VideoInfo::SetFieldBased(bool isfieldbased)
+{
+  if (isfieldbased) image_type |= IT_FIELDBASED;
+  else image_type &= ~IT_FIELDBASED;
+}
+
+void VideoInfo::Set(int property) { image_type |= property; }
+void VideoInfo::Clear(int property) { image_type &= ~property; }
+
+int VideoInfo::GetPlaneWidthSubsampling(int plane) const
+{
+  if (plane == PLANAR_Y || plane == 0 || plane == PLANAR_A || IsPlanarRGB() || IsPlanarRGBA())
+    return 0;
+  if (IsY())
+    return 0;
+  if (IsYUY2())
+    return 1;
+  return ((pixel_type >> CS_Shift_Sub_Width) + 1) & 3;
+}
+
+int VideoInfo::GetPlaneHeightSubsampling(int plane) const
+{
+  if (plane == PLANAR_Y || plane == 0 || plane == PLANAR_A || IsPlanarRGB() || IsPlanarRGBA())
+    return 0;
+  if (IsY() || IsYUY2())
+    return 0;
+  return ((pixel_type >> CS_Shift_Sub_Height) + 1) & 3;
+}
+
+int VideoInfo::BitsPerPixel() const
+{
+  if (IsYUY2()) return 16;
+  if (!IsPlanar()) {
+    const int bits = ComponentSize() * 8;
+    return (pixel_type & CS_RGBA_TYPE) ? 4 * bits : 3 * bits;
+  }
+  const int bits = ComponentSize() * 8;
+  if (IsY()) return bits;
+  if (IsPlanarRGB()) return 3 * bits;
+  if (IsPlanarRGBA()) return 4 * bits;
+  const int ws = GetPlaneWidthSubsampling(PLANAR_U);
+  const int hs = GetPlaneHeightSubsampling(PLANAR_U);
+  int total = bits + ((2 * bits) >> (ws + hs));
+  if (IsYUVA()) total += bits;
+  return total;
+}
+
+int VideoInfo::BytesPerChannelSample() const { return 0; }
+
+static unsigned stub_gcd(unsigned a, unsigned b)
+{
+  while (b) { unsigned t = a % b; a = b; b = t; }
+  return a;
+}
+
+void VideoInfo::SetFPS(unsigned numerator, unsigned denominator)
+{
+  const unsigned x = stub_gcd(numerator, denominator);
+  fps_numerator = x ? numerator / x : numerator;
+  fps_denominator = x ? denominator / x : denominator;
+}
+
+void VideoInfo::MulDivFPS(unsigned multiplier, unsigned divisor)
+{
+  SetFPS(fps_numerator * multiplier, fps_denominator * divisor);
+}
+
+bool VideoInfo::IsSameColorspace(const VideoInfo& vi) const
+{
+  if (vi.pixel_type == pixel_type) return true;
+  if (IsYV12() && vi.IsYV12()) return true;
+  return false;
+}
+
+int VideoInfo::NumComponents() const
+{
+  if (IsY()) return 1;
+  if (IsYUY2()) return 3;
+  if (IsYUVA() || IsPlanarRGBA() || (!IsPlanar() && (pixel_type & CS_RGBA_TYPE))) return 4;
+  return 3;
+}
+
+int VideoInfo::ComponentSize() const
+{
+  if (!IsPlanar() && !IsRGB48() && !IsRGB64())
+    return 1;
+  switch (pixel_type & CS_Sample_Bits_Mask) {
+  case CS_Sample_Bits_8: return 1;
+  case CS_Sample_Bits_10:
+  case CS_Sample_Bits_12:
+  case CS_Sample_Bits_14:
+  case CS_Sample_Bits_16: return 2;
+  case CS_Sample_Bits_32: return 4;
+  }
+  return 1;
+}
+
+int VideoInfo::BitsPerComponent() const
+{
+  if (!IsPlanar() && !IsRGB48() && !IsRGB64())
+    return 8;
+  switch (pixel_type & CS_Sample_Bits_Mask) {
+  case CS_Sample_Bits_8: return 8;
+  case CS_Sample_Bits_10: return 10;
+  case CS_Sample_Bits_12: return 12;
+  case CS_Sample_Bits_14: return 14;
+  case CS_Sample_Bits_16: return 16;
+  case CS_Sample_Bits_32: return 32;
+  }
+  return 8;
+}
+
+static int stub_layout(int pixel_type)
+{
+  return pixel_type & VideoInfo::CS_PLANAR_MASK & ~VideoInfo::CS_Sample_Bits_Mask;
+}
+
+bool VideoInfo::Is444() const { return stub_layout(pixel_type) == (CS_GENERIC_YUV444 & CS_PLANAR_FILTER) || stub_layout(pixel_type) == (CS_GENERIC_YUVA444 & CS_PLANAR_FILTER); }
+bool VideoInfo::Is422() const { return stub_layout(pixel_type) == (CS_GENERIC_YUV422 & CS_PLANAR_FILTER) || stub_layout(pixel_type) == (CS_GENERIC_YUVA422 & CS_PLANAR_FILTER); }
+bool VideoInfo::Is420() const { return stub_layout(pixel_type) == (CS_GENERIC_YUV420 & CS_PLANAR_FILTER) || stub_layout(pixel_type) == (CS_GENERIC_YUVA420 & CS_PLANAR_FILTER); }
+bool VideoInfo::IsY() const { return stub_layout(pixel_type) == CS_GENERIC_Y; }
+bool VideoInfo::IsRGB48() const { return (pixel_type & CS_BGR48) == CS_BGR48 && !(pixel_type & CS_PLANAR) && (pixel_type & CS_Sample_Bits_Mask) == CS_Sample_Bits_16; }
+bool VideoInfo::IsRGB64() const { return (pixel_type & CS_BGR64) == CS_BGR64 && !(pixel_type & CS_PLANAR) && (pixel_type & CS_Sample_Bits_Mask) == CS_Sample_Bits_16; }
+bool VideoInfo::IsYUVA() const { return !!(pixel_type & CS_YUVA); }
+bool VideoInfo::IsPlanarRGB() const { return IsPlanar() && IsRGB() && !(pixel_type & CS_RGBA_TYPE); }
+bool VideoInfo::IsPlanarRGBA() const { return IsPlanar() && IsRGB() && !!(pixel_type & CS_RGBA_TYPE); }
+
+/**********************************************************************/
+// VideoFrameBuffer
+
+// released buffers are kept for reuse, like the real frame registry does
+static std::mutex stub_pool_mutex;
+static std::multimap<int, VideoFrameBuffer*>* stub_pool = nullptr;
+
+VideoFrameBuffer::VideoFrameBuffer(int size, int margin, Device* _device)
+  : data((BYTE*)stub_aligned_malloc(size + margin, STUB_FRAME_ALIGN)), data_size(size), sequence_number(0), refcount(0), device(_device)
+{
+  if (!data)
+    throw std::bad_alloc();
+}
+
+VideoFrameBuffer::VideoFrameBuffer() : data(nullptr), data_size(0), sequence_number(0), refcount(0), device(nullptr) {}
+
+VideoFrameBuffer::~VideoFrameBuffer()
+{
+  stub_aligned_free(data);
+}
+
+const BYTE* VideoFrameBuffer::GetReadPtr() const { return data; }
+BYTE* VideoFrameBuffer::GetWritePtr() { stub_inc(&sequence_number); return data; }
+int VideoFrameBuffer::GetDataSize() const { return data_size; }
+int VideoFrameBuffer::GetSequenceNumber() const { return sequence_number; }
+int VideoFrameBuffer::GetRefcount() const { return refcount; }
+
+/**********************************************************************/
+// VideoFrame
+
+void* VideoFrame::operator new(size_t size) { return ::operator new(size); }
+
+VideoFrame::VideoFrame(VideoFrameBuffer* _vfb, AVSMap* avsmap, int _offset, int _pitch, int _row_size, int _height)
+  : refcount(0), vfb(_vfb), offset(_offset), pitch(_pitch), row_size(_row_size), height(_height),
+  offsetU(_offset), offsetV(_offset), pitchUV(0), row_sizeUV(0), heightUV(0),
+  offsetA(0), pitchA(0), row_sizeA(0), properties(avsmap)
+{
+  stub_inc(&vfb->refcount);
+}
+
+VideoFrame::VideoFrame(VideoFrameBuffer* _vfb, AVSMap* avsmap, int _offset, int _pitch, int _row_size, int _height,
+  int _offsetU, int _offsetV, int _pitchUV, int _row_sizeUV, int _heightUV)
+  : refcount(0), vfb(_vfb), offset(_offset), pitch(_pitch), row_size(_row_size), height(_height),
+  offsetU(_offsetU), offsetV(_offsetV), pitchUV(_pitchUV), row_sizeUV(_row_sizeUV), heightUV(_heightUV),
+  offsetA(0), pitchA(0), row_sizeA(0), properties(avsmap)
+{
+  stub_inc(&vfb->refcount);
+}
+
+VideoFrame::VideoFrame(VideoFrameBuffer* _vfb, AVSMap* avsmap, int _offset, int _pitch, int _row_size, int _height,
+  int _offsetU, int _offsetV, int _pitchUV, int _row_sizeUV, int _heightUV, int _offsetA)
+  : refcount(0), vfb(_vfb), offset(_offset), pitch(_pitch), row_size(_row_size), height(_height),
+  offsetU(_offsetU), offsetV(_offsetV), pitchUV(_pitchUV), row_sizeUV(_row_sizeUV), heightUV(_heightUV),
+  offsetA(_offsetA), pitchA(_offsetA ? _pitch : 0), row_sizeA(_offsetA ? _row_size : 0), properties(avsmap)
+{
+  stub_inc(&vfb->refcount);
+}
+
+void VideoFrame::AddRef() { stub_inc(&refcount); }
+
+void VideoFrame::Release()
+{
+  if (stub_dec(&refcount) != 0)
+    return;
+  VideoFrameBuffer* _vfb = vfb;
+  delete properties;
+  delete this;
+  if (stub_dec(&_vfb->refcount) == 0) {
+    std::lock_guard<std::mutex> lock(stub_pool_mutex);
+    if (!stub_pool)
+      stub_pool = new std::multimap<int, VideoFrameBuffer*>();
+    if (stub_pool->size() < 64)
+      stub_pool->insert(std::make_pair(_vfb->data_size, _vfb));
+    else
+      delete _vfb;
+  }
+}
+
+VideoFrame::~VideoFrame() { DESTRUCTOR(); }
+void VideoFrame::DESTRUCTOR() { /* frames are released through Release() */ }
+
+int VideoFrame::GetPitch(int plane) const
+{
+  switch (plane) {
+  case PLANAR_U: case PLANAR_V: case PLANAR_B: case PLANAR_R:
+  case PLANAR_U_ALIGNED: case PLANAR_V_ALIGNED: case PLANAR_B_ALIGNED: case PLANAR_R_ALIGNED:
+    return pitchUV;
+  case PLANAR_A: case PLANAR_A_ALIGNED:
+    return pitchA;
+  }
+  return pitch;
+}
+
+int VideoFrame::GetRowSize(int plane) const
+{
+  switch (plane) {
+  case PLANAR_U: case PLANAR_V: case PLANAR_B: case PLANAR_R:
+    return pitchUV ? row_sizeUV : 0;
+  case PLANAR_U_ALIGNED: case PLANAR_V_ALIGNED: case PLANAR_B_ALIGNED: case PLANAR_R_ALIGNED:
+    return pitchUV ? (row_sizeUV + STUB_FRAME_ALIGN - 1) & ~(STUB_FRAME_ALIGN - 1) : 0;
+  case PLANAR_A: case PLANAR_A_ALIGNED:
+    return pitchA ? row_sizeA : 0;
+  case PLANAR_Y_ALIGNED: case PLANAR_G_ALIGNED:
+    return (row_size + STUB_FRAME_ALIGN - 1) & ~(STUB_FRAME_ALIGN - 1);
+  }
+  return row_size;
+}
+
+int VideoFrame::GetHeight(int plane) const
+{
+  switch (plane) {
+  case PLANAR_U: case PLANAR_V: case PLANAR_B: case PLANAR_R:
+  case PLANAR_U_ALIGNED: case PLANAR_V_ALIGNED: case PLANAR_B_ALIGNED: case PLANAR_R_ALIGNED:
+    return pitchUV ? heightUV : 0;
+  case PLANAR_A: case PLANAR_A_ALIGNED:
+    return pitchA ? height : 0;
+  }
+  return height;
+}
+
+VideoFrameBuffer* VideoFrame::GetFrameBuffer() const { return vfb; }
+
+int VideoFrame::GetOffset(int plane) const
+{
+  switch (plane) {
+  case PLANAR_U: case PLANAR_B: case PLANAR_U_ALIGNED: case PLANAR_B_ALIGNED:
+    return offsetU;
+  case PLANAR_V: case PLANAR_R: case PLANAR_V_ALIGNED: case PLANAR_R_ALIGNED:
+    return offsetV;
+  case PLANAR_A: case PLANAR_A_ALIGNED:
+    return offsetA;
+  }
+  return offset;
+}
+
+const BYTE* VideoFrame::GetReadPtr(int plane) const { return vfb->GetReadPtr() + GetOffset(plane); }
+bool VideoFrame::IsWritable() const { return refcount == 1 && vfb->refcount == 1; }
+
+BYTE* VideoFrame::GetWritePtr(int plane) const
+{
+  if (!plane || plane == PLANAR_Y || plane == PLANAR_G)
+    return IsWritable() ? vfb->GetWritePtr() + GetOffset(plane) : nullptr;
+  return vfb->data + GetOffset(plane);
+}
+
+AVSMap& VideoFrame::getProperties() { return *properties; }
+const AVSMap& VideoFrame::getConstProperties() { return *properties; }
+void VideoFrame::setProperties(const AVSMap& _properties) { *properties = _properties; }
+
+/**********************************************************************/
+// PVideoFrame
+
+void PVideoFrame::Init(VideoFrame* x) { p = x; if (p) p->AddRef(); }
+void PVideoFrame::Set(VideoFrame* x) { if (x) x->AddRef(); if (p) p->Release(); p = x; }
+
+PVideoFrame::PVideoFrame() { CONSTRUCTOR0(); }
+PVideoFrame::PVideoFrame(const PVideoFrame& x) { CONSTRUCTOR1(x); }
+PVideoFrame::PVideoFrame(VideoFrame* x) { CONSTRUCTOR2(x); }
+void PVideoFrame::operator=(VideoFrame* x) { OPERATOR_ASSIGN0(x); }
+void PVideoFrame::operator=(const PVideoFrame& x) { OPERATOR_ASSIGN1(x); }
+PVideoFrame::~PVideoFrame() { DESTRUCTOR(); }
+
+void PVideoFrame::CONSTRUCTOR0() { p = nullptr; }
+void PVideoFrame::CONSTRUCTOR1(const PVideoFrame& x) { Init(x.p); }
+void PVideoFrame::CONSTRUCTOR2(VideoFrame* x) { Init(x); }
+void PVideoFrame::OPERATOR_ASSIGN0(VideoFrame* x) { Set(x); }
+void PVideoFrame::OPERATOR_ASSIGN1(const PVideoFrame& x) { Set(x.p); }
+void PVideoFrame::DESTRUCTOR() { if (p) p->Release(); }
+
+/**********************************************************************/
+// IClip, PClip
+
+void IClip::AddRef() { stub_inc(&refcnt); }
+void IClip::Release() { if (stub_dec(&refcnt) == 0) delete this; }
+
+IClip* PClip::GetPointerWithAddRef() const { if (p) p->AddRef(); return p; }
+void PClip::Init(IClip* x) { p = x; if (p) p->AddRef(); }
+void PClip::Set(IClip* x) { if (x) x->AddRef(); if (p) p->Release(); p = x; }
+
+PClip::PClip() { CONSTRUCTOR0(); }
+PClip::PClip(const PClip& x) { CONSTRUCTOR1(x); }
+PClip::PClip(IClip* x) { CONSTRUCTOR2(x); }
+void PClip::operator=(IClip* x) { OPERATOR_ASSIGN0(x); }
+void PClip::operator=(const PClip& x) { OPERATOR_ASSIGN1(x); }
+PClip::~PClip() { DESTRUCTOR(); }
+
+void PClip::CONSTRUCTOR0() { p = nullptr; }
+void PClip::CONSTRUCTOR1(const PClip& x) { Init(x.p); }
+void PClip::CONSTRUCTOR2(IClip* x) { Init(x); }
+void PClip::OPERATOR_ASSIGN0(IClip* x) { Set(x); }
+void PClip::OPERATOR_ASSIGN1(const PClip& x) { Set(x.p); }
+void PClip::DESTRUCTOR() { if (p) p->Release(); }
+
+/**********************************************************************/
+// AVSValue
+// strings are not owned (they live in the environment string store),
+// arrays are deep copied.
+
+AVSValue::AVSValue() { CONSTRUCTOR0(); }
+AVSValue::AVSValue(IClip* c) { CONSTRUCTOR1(c); }
+AVSValue::AVSValue(const PClip& c) { CONSTRUCTOR2(c); }
+AVSValue::AVSValue(bool b) { CONSTRUCTOR3(b); }
+AVSValue::AVSValue(int i) { CONSTRUCTOR4(i); }
+AVSValue::AVSValue(float f) { CONSTRUCTOR5(f); }
+AVSValue::AVSValue(double f) { CONSTRUCTOR6(f); }
+AVSValue::AVSValue(const char* s) { CONSTRUCTOR7(s); }
+AVSValue::AVSValue(const AVSValue* a, int size) { CONSTRUCTOR8(a, size); }
+AVSValue::AVSValue(const AVSValue& a, int size) { CONSTRUCTOR8(&a, size); }
+AVSValue::AVSValue(const AVSValue& v) { CONSTRUCTOR9(v); }
+AVSValue::~AVSValue() { DESTRUCTOR(); }
+AVSValue& AVSValue::operator=(const AVSValue& v) { return OPERATOR_ASSIGN(v); }
+const AVSValue& AVSValue::operator[](int index) const { return OPERATOR_INDEX(index); }
+
+void AVSValue::CONSTRUCTOR0() { type = 'v'; array_size = 0; clip = nullptr; }
+void AVSValue::CONSTRUCTOR1(IClip* c) { type = 'c'; array_size = 0; clip = c; if (c) c->AddRef(); }
+void AVSValue::CONSTRUCTOR2(const PClip& c) { type = 'c'; array_size = 0; clip = c.GetPointerWithAddRef(); }
+void AVSValue::CONSTRUCTOR3(bool b) { type = 'b'; array_size = 0; clip = nullptr; boolean = b; }
+void AVSValue::CONSTRUCTOR4(int i) { type = 'i'; array_size = 0; clip = nullptr; integer = i; }
+void AVSValue::CONSTRUCTOR5(float f) { type = 'f'; array_size = 0; clip = nullptr; floating_pt = f; }
+void AVSValue::CONSTRUCTOR6(double f) { type = 'f'; array_size = 0; clip = nullptr; floating_pt = float(f); }
+void AVSValue::CONSTRUCTOR7(const char* s) { type = 's'; array_size = 0; clip = nullptr; string = s; }
+
+void AVSValue::CONSTRUCTOR8(const AVSValue* a, int size)
+{
+  type = 'a';
+  array_size = (short)size;
+  if (size == 0) {
+    array = nullptr;
+    return;
+  }
+  AVSValue* arr = new AVSValue[size];
+  for (int i = 0; i < size; i++)
+    arr[i].Assign(&a[i], false);
+  array = arr;
+}
+
+void AVSValue::CONSTRUCTOR9(const AVSValue& v) { Assign(&v, true); }
+
+void AVSValue::DESTRUCTOR()
+{
+  if (IsClip() && clip)
+    clip->Release();
+  if (IsArray() && array)
+    delete[] array;
+  type = 'v';
+}
+
+void AVSValue::Assign(const AVSValue* src, bool init)
+{
+  if (src == this)
+    return;
+  AVSValue old;
+  if (!init) {
+    // keep the old content alive until the copy is done
+    old.type = type; old.array_size = array_size; old.clip = clip;
+    old.array = array;
+  }
+  type = src->type;
+  array_size = src->array_size;
+  if (src->IsClip()) {
+    clip = src->clip;
+    if (clip) clip->AddRef();
+  }
+  else if (src->IsArray()) {
+    AVSValue* arr = array_size ? new AVSValue[array_size] : nullptr;
+    for (int i = 0; i < array_size; i++)
+      arr[i].Assign(&src->array[i], false);
+    array = arr;
+  }
+  else {
+    memcpy((void*)&clip, (const void*)&src->clip, sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double));
+  }
+  // old goes out of scope here and releases the previous content
+}
+
+AVSValue& AVSValue::OPERATOR_ASSIGN(const AVSValue& v) { Assign(&v, false); return *this; }
+
+const AVSValue& AVSValue::OPERATOR_INDEX(int index) const
+{
+  if (!IsArray())
+    return *this;
+  static const AVSValue undefined;
+  if (index < 0 || index >= array_size)
+    return undefined;
+  return array[index];
+}
+
+bool AVSValue::Defined() const { return type != 'v'; }
+bool AVSValue::IsClip() const { return type == 'c'; }
+bool AVSValue::IsBool() const { return type == 'b'; }
+bool AVSValue::IsInt() const { return type == 'i'; }
+bool AVSValue::IsFloat() const { return type == 'f' || type == 'i'; }
+bool AVSValue::IsString() const { return type == 's'; }
+bool AVSValue::IsArray() const { return type == 'a'; }
+bool AVSValue::IsFunction() const { return type == 'n'; }
+
+PClip AVSValue::AsClip() const { return IsClip() ? PClip(clip) : PClip(); }
+bool AVSValue::AsBool() const { return AsBool1(); }
+int AVSValue::AsInt() const { return AsInt1(); }
+const char* AVSValue::AsString() const { return AsString1(); }
+double AVSValue::AsFloat() const { return AsFloat1(); }
+float AVSValue::AsFloatf() const { return float(AsFloat1()); }
+bool AVSValue::AsBool(bool def) const { return AsBool2(def); }
+int AVSValue::AsInt(int def) const { return AsInt2(def); }
+double AVSValue::AsDblDef(double def) const { return IsFloat() ? AsFloat1() : def; }
+double AVSValue::AsFloat(float def) const { return AsFloat2(def); }
+float AVSValue::AsFloatf(float def) const { return float(AsFloat2(def)); }
+const char* AVSValue::AsString(const char* def) const { return AsString2(def); }
+int AVSValue::ArraySize() const { return IsArray() ? array_size : 1; }
+
+bool AVSValue::AsBool1() const { return IsBool() ? boolean : false; }
+int AVSValue::AsInt1() const { return IsInt() ? integer : 0; }
+const char* AVSValue::AsString1() const { return IsString() ? string : nullptr; }
+double AVSValue::AsFloat1() const { return IsInt() ? (double)integer : type == 'f' ? (double)floating_pt : 0.0; }
+bool AVSValue::AsBool2(bool def) const { return IsBool() ? boolean : def; }
+int AVSValue::AsInt2(int def) const { return IsInt() ? integer : def; }
+double AVSValue::AsFloat2(float def) const { return IsFloat() ? AsFloat1() : (double)def; }
+const char* AVSValue::AsString2(const char* def) const { return IsString() ? string : def; }
+
+/**********************************************************************/
+// CPU detection
+
+namespace avsstub {
+
+  // the detection of the engine, which the C API uses too
+  int DetectCPUFlags()
+  {
+    return fft3d::DetectCPUFlags();
+  }
+
+} // namespace avsstub
+
+/**********************************************************************/
+// ScriptEnvironment
+
+class ScriptEnvironment : public IScriptEnvironment {
+  struct Function {
+    std::string name;
+    std::string params;
+    ApplyFunc apply;
+    void* user_data;
+  };
+
+  std::vector<Function> functions;
+  std::deque<std::string> strings;
+  std::mutex string_mutex;
+  std::vector<std::pair<ShutdownFunc, void*>> shutdown;
+  AVS_Linkage linkage;
+  int cpuflags;
+
+public:
+  ScriptEnvironment(int _cpuflags);
+  ~ScriptEnvironment() override;
+
+  void SetCPUFlags(int flags) { cpuflags = flags; }
+
+  PVideoFrame NewFrame(const VideoInfo& vi, AVSMap* props);
+
+  int __stdcall GetCPUFlags() override { return cpuflags; }
+
+  char* __stdcall SaveString(const char* s, int length = -1) override
+  {
+    std::lock_guard<std::mutex> lock(string_mutex);
+    strings.emplace_back(s, length < 0 ? strlen(s) : (size_t)length);
+    return &strings.back()[0];
+  }
+
+  char* Sprintf(const char* fmt, ...) override
+  {
+    va_list val;
+    va_start(val, fmt);
+    char* result = VSprintf(fmt, val);
+    va_end(val);
+    return result;
+  }
+
+  char* __stdcall VSprintf(const char* fmt, va_list val) override
+  {
+    char buf[4096];
+    vsnprintf(buf, sizeof(buf), fmt, val);
+    return SaveString(buf);
+  }
+
+  void ThrowError(const char* fmt, ...) override
+  {
+    char buf[4096];
+    va_list val;
+    va_start(val, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, val);
+    va_end(val);
+    throw AvisynthError(SaveString(buf));
+  }
+
+  void __stdcall AddFunction(const char* name, const char* params, ApplyFunc apply, void* user_data) override
+  {
+    functions.push_back(Function{ name, params, apply, user_data });
+  }
+
+  bool __stdcall FunctionExists(const char* name) override
+  {
+    for (auto& f : functions)
+      if (f.name == name) return true;
+    return false;
+  }
+
+  AVSValue __stdcall Invoke(const char* name, const AVSValue args, const char* const* arg_names = 0) override;
+
+  AVSValue __stdcall GetVar(const char* name) override { AVS_UNUSED(name); throw NotFound(); }
+  bool __stdcall SetVar(const char*, const AVSValue&) override { return false; }
+  bool __stdcall SetGlobalVar(const char*, const AVSValue&) override { return false; }
+  void __stdcall PushContext(int = 0) override {}
+  void __stdcall PopContext() override {}
+
+  PVideoFrame __stdcall NewVideoFrame(const VideoInfo& vi, int align = FRAME_ALIGN) override
+  {
+    AVS_UNUSED(align);
+    return NewFrame(vi, new AVSMap());
+  }
+
+  bool __stdcall MakeWritable(PVideoFrame* pvf) override;
+
+  void __stdcall BitBlt(BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch, int row_size, int height) override
+  {
+    if (height <= 0 || row_size <= 0)
+      return;
+    if (dst_pitch == src_pitch && src_pitch == row_size) {
+      memcpy(dstp, srcp, (size_t)row_size * height);
+      return;
+    }
+    for (int y = 0; y < height; y++) {
+      memcpy(dstp, srcp, row_size);
+      dstp += dst_pitch;
+      srcp += src_pitch;
+    }
+  }
+
+  void __stdcall AtExit(ShutdownFunc function, void* user_data) override { shutdown.push_back(std::make_pair(function, user_data)); }
+
+  void __stdcall CheckVersion(int version = AVISYNTH_INTERFACE_VERSION) override
+  {
+    if (version > AVISYNTH_INTERFACE_VERSION)
+      ThrowError("Plugin was designed for a later version of Avisynth (%d)", version);
+  }
+
+  PVideoFrame __stdcall Subframe(PVideoFrame, int, int, int, int) override { ThrowError("Subframe: not supported by the stub environment"); return PVideoFrame(); }
+  int __stdcall SetMemoryMax(int) override { return 0; }
+  int __stdcall SetWorkingDir(const char*) override { return -1; }
+  void* __stdcall ManageCache(int, void*) override { return nullptr; }
+  bool __stdcall PlanarChromaAlignment(PlanarChromaAlignmentMode) override { return true; }
+  PVideoFrame __stdcall SubframePlanar(PVideoFrame, int, int, int, int, int, int, int) override { ThrowError("SubframePlanar: not supported by the stub environment"); return PVideoFrame(); }
+  void __stdcall DeleteScriptEnvironment() override { delete this; }
+  void __stdcall ApplyMessage(PVideoFrame*, const VideoInfo&, const char*, int, int, int, int) override {}
+  const AVS_Linkage* __stdcall GetAVSLinkage() override { return &linkage; }
+  AVSValue __stdcall GetVarDef(const char*, const AVSValue& def = AVSValue()) override { return def; }
+  PVideoFrame __stdcall SubframePlanarA(PVideoFrame, int, int, int, int, int, int, int, int) override { ThrowError("SubframePlanarA: not supported by the stub environment"); return PVideoFrame(); }
+
+  void __stdcall copyFrameProps(const PVideoFrame& src, PVideoFrame& dst) override
+  {
+    dst->getProperties().data = const_cast<PVideoFrame&>(src)->getConstProperties().data;
+  }
+  const AVSMap* __stdcall getFramePropsRO(const PVideoFrame& frame) override { return &const_cast<PVideoFrame&>(frame)->getConstProperties(); }
+  AVSMap* __stdcall getFramePropsRW(PVideoFrame& frame) override { return &frame->getProperties(); }
+
+  int __stdcall propNumKeys(const AVSMap* map) override { return (int)map->data.size(); }
+
+  const char* __stdcall propGetKey(const AVSMap* map, int index) override
+  {
+    if (index < 0 || index >= (int)map->data.size())
+      return nullptr;
+    auto it = map->data.begin();
+    std::advance(it, index);
+    return it->first.c_str();
+  }
+
+  int __stdcall propNumElements(const AVSMap* map, const char* key) override
+  {
+    auto it = map->data.find(key);
+    return it == map->data.end() ? -1 : it->second.size();
+  }
+
+  char __stdcall propGetType(const AVSMap* map, const char* key) override
+  {
+    auto it = map->data.find(key);
+    if (it == map->data.end())
+      return (char)PROPTYPE_UNSET;
+    return it->second.type;
+  }
+
+  const StubProp* FindProp(const AVSMap* map, const char* key, char type, int index, int* error)
+  {
+    if (error) *error = 0;
+    auto it = map->data.find(key);
+    int err = 0;
+    if (it == map->data.end())
+      err = GETPROPERROR_UNSET;
+    else if (it->second.type != type)
+      err = GETPROPERROR_TYPE;
+    else if (index < 0 || index >= it->second.size())
+      err = GETPROPERROR_INDEX;
+    if (err) {
+      if (!error)
+        ThrowError("Property read unsuccessful but no error output: %s", key);
+      *error = err;
+      return nullptr;
+    }
+    return &it->second;
+  }
+
+  int64_t __stdcall propGetInt(const AVSMap* map, const char* key, int index, int* error) override
+  {
+    const StubProp* p = FindProp(map, key, PROPTYPE_INT, index, error);
+    return p ? p->i[index] : 0;
+  }
+  double __stdcall propGetFloat(const AVSMap* map, const char* key, int index, int* error) override
+  {
+    const StubProp* p = FindProp(map, key, PROPTYPE_FLOAT, index, error);
+    return p ? p->f[index] : 0.0;
+  }
+  const char* __stdcall propGetData(const AVSMap* map, const char* key, int index, int* error) override
+  {
+    const StubProp* p = FindProp(map, key, PROPTYPE_DATA, index, error);
+    return p ? p->s[index].c_str() : nullptr;
+  }
+  int __stdcall propGetDataSize(const AVSMap* map, const char* key, int index, int* error) override
+  {
+    const StubProp* p = FindProp(map, key, PROPTYPE_DATA, index, error);
+    return p ? (int)p->s[index].size() : -1;
+  }
+  PClip __stdcall propGetClip(const AVSMap*, const char*, int, int* error) override { if (error) *error = GETPROPERROR_TYPE; return PClip(); }
+  const PVideoFrame __stdcall propGetFrame(const AVSMap*, const char*, int, int* error) override { if (error) *error = GETPROPERROR_TYPE; return PVideoFrame(); }
+
+  int __stdcall propDeleteKey(AVSMap* map, const char* key) override { return (int)map->data.erase(key); }
+
+  StubProp* PrepareProp(AVSMap* map, const char* key, char type, int append)
+  {
+    auto it = map->data.find(key);
+    if (it != map->data.end() && append == PROPAPPENDMODE_TOUCH)
+      return nullptr;
+    if (it != map->data.end() && append == PROPAPPENDMODE_APPEND) {
+      if (it->second.type != type)
+        return nullptr;
+      return &it->second;
+    }
+    StubProp& p = map->data[key];
+    p = StubProp();
+    p.type = type;
+    return &p;
+  }
+
+  int __stdcall propSetInt(AVSMap* map, const char* key, int64_t i, int append) override
+  {
+    StubProp* p = PrepareProp(map, key, PROPTYPE_INT, append);
+    if (!p) return append == PROPAPPENDMODE_TOUCH ? 0 : 1;
+    p->i.push_back(i);
+    return 0;
+  }
+  int __stdcall propSetFloat(AVSMap* map, const char* key, double d, int append) override
+  {
+    StubProp* p = PrepareProp(map, key, PROPTYPE_FLOAT, append);
+    if (!p) return append == PROPAPPENDMODE_TOUCH ? 0 : 1;
+    p->f.push_back(d);
+    return 0;
+  }
+  int __stdcall propSetData(AVSMap* map, const char* key, const char* d, int length, int append) override
+  {
+    StubProp* p = PrepareProp(map, key, PROPTYPE_DATA, append);
+    if (!p) return append == PROPAPPENDMODE_TOUCH ? 0 : 1;
+    p->s.emplace_back(d, length < 0 ? strlen(d) : (size_t)length);
+    return 0;
+  }
+  int __stdcall propSetClip(AVSMap*, const char*, PClip&, int) override { return 1; }
+  int __stdcall propSetFrame(AVSMap*, const char*, const PVideoFrame&, int) override { return 1; }
+
+  const int64_t* __stdcall propGetIntArray(const AVSMap* map, const char* key, int* error) override
+  {
+    const StubProp* p = FindProp(map, key, PROPTYPE_INT, 0, error);
+    return p ? p->i.data() : nullptr;
+  }
+  const double* __stdcall propGetFloatArray(const AVSMap* map, const char* key, int* error) override
+  {
+    const StubProp* p = FindProp(map, key, PROPTYPE_FLOAT, 0, error);
+    return p ? p->f.data() : nullptr;
+  }
+  int __stdcall propSetIntArray(AVSMap* map, const char* key, const int64_t* i, int size) override
+  {
+    StubProp* p = PrepareProp(map, key, PROPTYPE_INT, PROPAPPENDMODE_REPLACE);
+    p->i.assign(i, i + size);
+    return 0;
+  }
+  int __stdcall propSetFloatArray(AVSMap* map, const char* key, const double* d, int size) override
+  {
+    StubProp* p = PrepareProp(map, key, PROPTYPE_FLOAT, PROPAPPENDMODE_REPLACE);
+    p->f.assign(d, d + size);
+    return 0;
+  }
+
+  AVSMap* __stdcall createMap() override { return new AVSMap(); }
+  void __stdcall freeMap(AVSMap* map) override { delete map; }
+  void __stdcall clearMap(AVSMap* map) override { map->data.clear(); }
+
+  PVideoFrame __stdcall NewVideoFrameP(const VideoInfo& vi, PVideoFrame* propSrc, int align = FRAME_ALIGN) override
+  {
+    AVS_UNUSED(align);
+    AVSMap* props = new AVSMap();
+    if (propSrc && *propSrc)
+      props->data = (*propSrc)->getConstProperties().data;
+    return NewFrame(vi, props);
+  }
+
+  size_t __stdcall GetEnvProperty(AvsEnvProperty prop) override
+  {
+    switch (prop) {
+    case AEP_PHYSICAL_CPUS:
+    case AEP_LOGICAL_CPUS: return std::max(1u, std::thread::hardware_concurrency());
+    case AEP_THREADPOOL_THREADS:
+    case AEP_FILTERCHAIN_THREADS: return 1;
+    case AEP_THREAD_ID: return 0;
+    case AEP_VERSION: return AVISYNTH_INTERFACE_VERSION;
+    case AEP_FRAME_ALIGN:
+    case AEP_PLANE_ALIGN: return STUB_FRAME_ALIGN;
+    default: return 0;
+    }
+  }
+
+  void* __stdcall Allocate(size_t nBytes, size_t alignment, AvsAllocType) override { return stub_aligned_malloc(nBytes, std::max<size_t>(alignment, sizeof(void*))); }
+  void __stdcall Free(void* ptr) override { stub_aligned_free(ptr); }
+
+  bool __stdcall GetVarTry(const char*, AVSValue*) const override { return false; }
+  bool __stdcall GetVarBool(const char*, bool def) const override { return def; }
+  int __stdcall GetVarInt(const char*, int def) const override { return def; }
+  double __stdcall GetVarDouble(const char*, double def) const override { return def; }
+  const char* __stdcall GetVarString(const char*, const char* def) const override { return def; }
+  int64_t __stdcall GetVarLong(const char*, int64_t def) const override { return def; }
+
+  bool __stdcall InvokeTry(AVSValue* result, const char* name, const AVSValue& args, const char* const* arg_names = 0) override
+  {
+    if (!FunctionExists(name))
+      return false;
+    *result = Invoke(name, args, arg_names);
+    return true;
+  }
+  AVSValue __stdcall Invoke2(const AVSValue&, const char* name, const AVSValue args, const char* const* arg_names = 0) override { return Invoke(name, args, arg_names); }
+  bool __stdcall Invoke2Try(AVSValue* result, const AVSValue&, const char* name, const AVSValue args, const char* const* arg_names = 0) override { return InvokeTry(result, name, args, arg_names); }
+  AVSValue __stdcall Invoke3(const AVSValue&, const PFunction&, const AVSValue, const char* const* = 0) override { throw NotFound(); }
+  bool __stdcall Invoke3Try(AVSValue*, const AVSValue&, const PFunction&, const AVSValue, const char* const* = 0) override { return false; }
+};
+
+// Parameter string parser: "c[sigma]f[beta]f..." -> list of (name, type)
+static std::vector<std::pair<std::string, char>> ParseParams(const std::string& params)
+{
+  std::vector<std::pair<std::string, char>> result;
+  std::string name;
+  for (size_t i = 0; i < params.size(); i++) {
+    const char c = params[i];
+    if (c == '[') {
+      const size_t end = params.find(']', i);
+      name = params.substr(i + 1, end - i - 1);
+      i = end;
+    }
+    else if (c == '*' || c == '+') {
+      continue; // repeat markers are not supported, the previous argument stays single
+    }
+    else {
+      result.push_back(std::make_pair(name, c));
+      name.clear();
+    }
+  }
+  return result;
+}
+
+static bool StubEqualNoCase(const std::string& a, const char* b)
+{
+  const size_t len = strlen(b);
+  if (a.size() != len) return false;
+  for (size_t i = 0; i < len; i++)
+    if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+  return true;
+}
+
+AVSValue __stdcall ScriptEnvironment::Invoke(const char* name, const AVSValue args, const char* const* arg_names)
+{
+  const Function* f = nullptr;
+  for (auto& fn : functions)
+    if (StubEqualNoCase(fn.name, name)) { f = &fn; break; }
+  if (!f)
+    throw NotFound();
+
+  const auto params = ParseParams(f->params);
+  std::vector<AVSValue> positional(params.size());
+  const int nargs = args.IsArray() ? args.ArraySize() : (args.Defined() ? 1 : 0);
+  int next_unnamed = 0;
+  for (int i = 0; i < nargs; i++) {
+    const AVSValue& a = args.IsArray() ? args[i] : args;
+    if (arg_names && arg_names[i]) {
+      size_t k = 0;
+      for (; k < params.size(); k++)
+        if (StubEqualNoCase(params[k].first, arg_names[i])) break;
+      if (k == params.size())
+        ThrowError("%s does not have a named argument \"%s\"", name, arg_names[i]);
+      positional[k] = a;
+    }
+    else {
+      if (next_unnamed >= (int)params.size())
+        ThrowError("%s: too many arguments", name);
+      positional[next_unnamed++] = a;
+    }
+  }
+  AVSValue packed(positional.data(), (int)positional.size());
+  return f->apply(packed, f->user_data, this);
+}
+
+ScriptEnvironment::ScriptEnvironment(int _cpuflags) : cpuflags(_cpuflags < 0 ? avsstub::DetectCPUFlags() : _cpuflags)
+{
+  memset((void*)&linkage, 0, sizeof(linkage));
+  linkage.Size = sizeof(AVS_Linkage);
+
+  linkage.HasVideo = &VideoInfo::HasVideo;
+  linkage.HasAudio = &VideoInfo::HasAudio;
+  linkage.IsRGB = &VideoInfo::IsRGB;
+  linkage.IsRGB24 = &VideoInfo::IsRGB24;
+  linkage.IsRGB32 = &VideoInfo::IsRGB32;
+  linkage.IsYUV = &VideoInfo::IsYUV;
+  linkage.IsYUY2 = &VideoInfo::IsYUY2;
+  linkage.IsYV24 = &VideoInfo::IsYV24;
+  linkage.IsYV16 = &VideoInfo::IsYV16;
+  linkage.IsYV12 = &VideoInfo::IsYV12;
+  linkage.IsYV411 = &VideoInfo::IsYV411;
+  linkage.IsY8 = &VideoInfo::IsY8;
+  linkage.IsColorSpace = &VideoInfo::IsColorSpace;
+  linkage.Is = &VideoInfo::Is;
+  linkage.IsPlanar = &VideoInfo::IsPlanar;
+  linkage.IsFieldBased = &VideoInfo::IsFieldBased;
+  linkage.IsParityKnown = &VideoInfo::IsParityKnown;
+  linkage.IsBFF = &VideoInfo::IsBFF;
+  linkage.IsTFF = &VideoInfo::IsTFF;
+  linkage.IsVPlaneFirst = &VideoInfo::IsVPlaneFirst;
+  linkage.BytesFromPixels = &VideoInfo::BytesFromPixels;
+  linkage.RowSize = &VideoInfo::RowSize;
+  linkage.BMPSize = &VideoInfo::BMPSize;
+  linkage.AudioSamplesFromFrames = &VideoInfo::AudioSamplesFromFrames;
+  linkage.FramesFromAudioSamples = &VideoInfo::FramesFromAudioSamples;
+  linkage.AudioSamplesFromBytes = &VideoInfo::AudioSamplesFromBytes;
+  linkage.BytesFromAudioSamples = &VideoInfo::BytesFromAudioSamples;
+  linkage.AudioChannels = &VideoInfo::AudioChannels;
+  linkage.SampleType = &VideoInfo::SampleType;
+  linkage.IsSampleType = &VideoInfo::IsSampleType;
+  linkage.SamplesPerSecond = &VideoInfo::SamplesPerSecond;
+  linkage.BytesPerAudioSample = &VideoInfo::BytesPerAudioSample;
+  linkage.SetFieldBased = &VideoInfo::SetFieldBased;
+  linkage.Set = &VideoInfo::Set;
+  linkage.Clear = &VideoInfo::Clear;
+  linkage.GetPlaneWidthSubsampling = &VideoInfo::GetPlaneWidthSubsampling;
+  linkage.GetPlaneHeightSubsampling = &VideoInfo::GetPlaneHeightSubsampling;
+  linkage.BitsPerPixel = &VideoInfo::BitsPerPixel;
+  linkage.BytesPerChannelSample = &VideoInfo::BytesPerChannelSample;
+  linkage.SetFPS = &VideoInfo::SetFPS;
+  linkage.MulDivFPS = &VideoInfo::MulDivFPS;
+  linkage.IsSameColorspace = &VideoInfo::IsSameColorspace;
+
+  linkage.VFBGetReadPtr = &VideoFrameBuffer::GetReadPtr;
+  linkage.VFBGetWritePtr = &VideoFrameBuffer::GetWritePtr;
+  linkage.GetDataSize = &VideoFrameBuffer::GetDataSize;
+  linkage.GetSequenceNumber = &VideoFrameBuffer::GetSequenceNumber;
+  linkage.GetRefcount = &VideoFrameBuffer::GetRefcount;
+
+  linkage.GetPitch = &VideoFrame::GetPitch;
+  linkage.GetRowSize = &VideoFrame::GetRowSize;
+  linkage.GetHeight = &VideoFrame::GetHeight;
+  linkage.GetFrameBuffer = &VideoFrame::GetFrameBuffer;
+  linkage.GetOffset = &VideoFrame::GetOffset;
+  linkage.VFGetReadPtr = &VideoFrame::GetReadPtr;
+  linkage.IsWritable = &VideoFrame::IsWritable;
+  linkage.VFGetWritePtr = &VideoFrame::GetWritePtr;
+  linkage.VideoFrame_DESTRUCTOR = &VideoFrame::DESTRUCTOR;
+
+  linkage.PClip_CONSTRUCTOR0 = &PClip::CONSTRUCTOR0;
+  linkage.PClip_CONSTRUCTOR1 = &PClip::CONSTRUCTOR1;
+  linkage.PClip_CONSTRUCTOR2 = &PClip::CONSTRUCTOR2;
+  linkage.PClip_OPERATOR_ASSIGN0 = &PClip::OPERATOR_ASSIGN0;
+  linkage.PClip_OPERATOR_ASSIGN1 = &PClip::OPERATOR_ASSIGN1;
+  linkage.PClip_DESTRUCTOR = &PClip::DESTRUCTOR;
+
+  linkage.PVideoFrame_CONSTRUCTOR0 = &PVideoFrame::CONSTRUCTOR0;
+  linkage.PVideoFrame_CONSTRUCTOR1 = &PVideoFrame::CONSTRUCTOR1;
+  linkage.PVideoFrame_CONSTRUCTOR2 = &PVideoFrame::CONSTRUCTOR2;
+  linkage.PVideoFrame_OPERATOR_ASSIGN0 = &PVideoFrame::OPERATOR_ASSIGN0;
+  linkage.PVideoFrame_OPERATOR_ASSIGN1 = &PVideoFrame::OPERATOR_ASSIGN1;
+  linkage.PVideoFrame_DESTRUCTOR = &PVideoFrame::DESTRUCTOR;
+
+  linkage.AVSValue_CONSTRUCTOR0 = &AVSValue::CONSTRUCTOR0;
+  linkage.AVSValue_CONSTRUCTOR1 = &AVSValue::CONSTRUCTOR1;
+  linkage.AVSValue_CONSTRUCTOR2 = &AVSValue::CONSTRUCTOR2;
+  linkage.AVSValue_CONSTRUCTOR3 = &AVSValue::CONSTRUCTOR3;
+  linkage.AVSValue_CONSTRUCTOR4 = &AVSValue::CONSTRUCTOR4;
+  linkage.AVSValue_CONSTRUCTOR5 = &AVSValue::CONSTRUCTOR5;
+  linkage.AVSValue_CONSTRUCTOR6 = &AVSValue::CONSTRUCTOR6;
+  linkage.AVSValue_CONSTRUCTOR7 = &AVSValue::CONSTRUCTOR7;
+  linkage.AVSValue_CONSTRUCTOR8 = &AVSValue::CONSTRUCTOR8;
+  linkage.AVSValue_CONSTRUCTOR9 = &AVSValue::CONSTRUCTOR9;
+  linkage.AVSValue_DESTRUCTOR = &AVSValue::DESTRUCTOR;
+  linkage.AVSValue_OPERATOR_ASSIGN = &AVSValue::OPERATOR_ASSIGN;
+  linkage.AVSValue_OPERATOR_INDEX = &AVSValue::OPERATOR_INDEX;
+  linkage.Defined = &AVSValue::Defined;
+  linkage.IsClip = &AVSValue::IsClip;
+  linkage.IsBool = &AVSValue::IsBool;
+  linkage.IsInt = &AVSValue::IsInt;
+  linkage.IsFloat = &AVSValue::IsFloat;
+  linkage.IsString = &AVSValue::IsString;
+  linkage.IsArray = &AVSValue::IsArray;
+  linkage.AsClip = &AVSValue::AsClip;
+  linkage.AsBool1 = &AVSValue::AsBool1;
+  linkage.AsInt1 = &AVSValue::AsInt1;
+  linkage.AsString1 = &AVSValue::AsString1;
+  linkage.AsFloat1 = &AVSValue::AsFloat1;
+  linkage.AsBool2 = &AVSValue::AsBool2;
+  linkage.AsInt2 = &AVSValue::AsInt2;
+  linkage.AsDblDef = &AVSValue::AsDblDef;
+  linkage.AsFloat2 = &AVSValue::AsFloat2;
+  linkage.AsString2 = &AVSValue::AsString2;
+  linkage.ArraySize = &AVSValue::ArraySize;
+
+  linkage.NumComponents = &VideoInfo::NumComponents;
+  linkage.ComponentSize = &VideoInfo::ComponentSize;
+  linkage.BitsPerComponent = &VideoInfo::BitsPerComponent;
+  linkage.Is444 = &VideoInfo::Is444;
+  linkage.Is422 = &VideoInfo::Is422;
+  linkage.Is420 = &VideoInfo::Is420;
+  linkage.IsY = &VideoInfo::IsY;
+  linkage.IsRGB48 = &VideoInfo::IsRGB48;
+  linkage.IsRGB64 = &VideoInfo::IsRGB64;
+  linkage.IsYUVA = &VideoInfo::IsYUVA;
+  linkage.IsPlanarRGB = &VideoInfo::IsPlanarRGB;
+  linkage.IsPlanarRGBA = &VideoInfo::IsPlanarRGBA;
+
+  linkage.getProperties = &VideoFrame::getProperties;
+  linkage.getConstProperties = &VideoFrame::getConstProperties;
+  linkage.setProperties = &VideoFrame::setProperties;
+  linkage.IsFunction = &AVSValue::IsFunction;
+}
+
+ScriptEnvironment::~ScriptEnvironment()
+{
+  for (auto it = shutdown.rbegin(); it != shutdown.rend(); ++it)
+    it->first(it->second, this);
+  std::lock_guard<std::mutex> lock(stub_pool_mutex);
+  if (stub_pool) {
+    for (auto& b : *stub_pool)
+      delete b.second;
+    stub_pool->clear();
+  }
+}
+
+PVideoFrame ScriptEnvironment::NewFrame(const VideoInfo& vi, AVSMap* props)
+{
+  const int align = STUB_FRAME_ALIGN;
+  const int rowsize = vi.RowSize(0);
+  const int pitch = (rowsize + align - 1) & ~(align - 1);
+  const bool has_uv = vi.IsPlanar() && !vi.IsY();
+  const bool has_a = vi.IsYUVA() || vi.IsPlanarRGBA();
+  int rowsizeUV = 0, heightUV = 0, pitchUV = 0;
+  if (has_uv) {
+    rowsizeUV = vi.RowSize(PLANAR_U);
+    heightUV = vi.height >> vi.GetPlaneHeightSubsampling(PLANAR_U);
+    pitchUV = (rowsizeUV + align - 1) & ~(align - 1);
+  }
+  const int sizeY = pitch * vi.height;
+  const int sizeUV = pitchUV * heightUV;
+  const int size = sizeY + 2 * sizeUV + (has_a ? sizeY : 0);
+
+  VideoFrameBuffer* vfb = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(stub_pool_mutex);
+    if (stub_pool) {
+      auto it = stub_pool->find(size);
+      if (it != stub_pool->end()) {
+        vfb = it->second;
+        stub_pool->erase(it);
+      }
+    }
+  }
+  if (!vfb)
+    vfb = new VideoFrameBuffer(size, align, nullptr);
+
+  VideoFrame* frame;
+  if (has_a)
+    frame = new VideoFrame(vfb, props, 0, pitch, rowsize, vi.height, sizeY, sizeY + sizeUV, pitchUV, rowsizeUV, heightUV, sizeY + 2 * sizeUV);
+  else if (has_uv)
+    frame = new VideoFrame(vfb, props, 0, pitch, rowsize, vi.height, sizeY, sizeY + sizeUV, pitchUV, rowsizeUV, heightUV);
+  else
+    frame = new VideoFrame(vfb, props, 0, pitch, rowsize, vi.height);
+  return PVideoFrame(frame);
+}
+
+bool __stdcall ScriptEnvironment::MakeWritable(PVideoFrame* pvf)
+{
+  if ((*pvf)->IsWritable())
+    return false;
+  // copy of the whole buffer with the same layout and properties
+  const VideoFrame* f = pvf->operator->();
+  VideoFrameBuffer* vfb = new VideoFrameBuffer(f->vfb->data_size, 64, nullptr);
+  memcpy(vfb->data, f->vfb->data, f->vfb->data_size);
+  AVSMap* props = new AVSMap();
+  props->data = f->properties->data;
+  VideoFrame* copy = new VideoFrame(vfb, props, f->offset, f->pitch, f->row_size, f->height,
+    f->offsetU, f->offsetV, f->pitchUV, f->row_sizeUV, f->heightUV, f->offsetA);
+  copy->pitchA = f->pitchA; copy->row_sizeA = f->row_sizeA;
+  *pvf = PVideoFrame(copy);
+  return true;
+}
+
+/**********************************************************************/
+// clips
+
+namespace {
+
+  class NoiseClip : public IClip {
+    VideoInfo vi;
+    std::vector<PVideoFrame> frames;
+  public:
+    NoiseClip(ScriptEnvironment* env, const VideoInfo& _vi, float noise, uint32_t seed, int pool) : vi(_vi)
+    {
+      const int planes_yuv[4] = { PLANAR_Y, PLANAR_U, PLANAR_V, PLANAR_A };
+      const int planes_rgb[4] = { PLANAR_G, PLANAR_B, PLANAR_R, PLANAR_A };
+      const int* planes = vi.IsPlanarRGB() || vi.IsPlanarRGBA() ? planes_rgb : planes_yuv;
+      const int nplanes = vi.IsPlanar() ? vi.NumComponents() : 1;
+      const int bits = vi.BitsPerComponent();
+      const int pixelsize = vi.ComponentSize();
+      const float scale = bits == 32 ? 1.0f / 255.0f : float(1 << (bits - 8));
+      const float maxval = bits == 32 ? 1.0f : float((1 << bits) - 1);
+
+      uint32_t state = seed ? seed : 0x9e3779b9u;
+      auto rnd = [&state]() -> float {
+        state ^= state << 13; state ^= state >> 17; state ^= state << 5;
+        return float(state & 0xffffff) / float(0x1000000) - 0.5f; // -0.5..0.5
+      };
+
+      for (int f = 0; f < pool; f++) {
+        PVideoFrame frame = env->NewVideoFrame(vi);
+        for (int p = 0; p < nplanes; p++) {
+          const int plane = vi.IsPlanar() ? planes[p] : 0;
+          BYTE* dstp = frame->GetWritePtr(plane);
+          const int pitch = frame->GetPitch(plane);
+          const int height = frame->GetHeight(plane);
+          const int width = frame->GetRowSize(plane) / pixelsize;
+          const bool chroma = vi.IsYUV() && vi.IsPlanar() && (plane == PLANAR_U || plane == PLANAR_V);
+          for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+              // smooth content drifting by one pixel per frame
+              float base = 128.0f + 60.0f * std::sin((x + f) * 0.05f + p) * std::cos(y * 0.037f - 0.3f * p);
+              if (chroma)
+                base = 128.0f + 0.5f * (base - 128.0f);
+              float v = base + noise * 2.0f * rnd();
+              if (bits == 32) {
+                v = v * scale;
+                if (chroma) v -= 0.5f;
+                reinterpret_cast<float*>(dstp)[x] = v;
+              }
+              else {
+                v = v * scale + 0.5f;
+                v = v < 0 ? 0 : v > maxval ? maxval : v;
+                if (pixelsize == 1)
+                  dstp[x] = (BYTE)v;
+                else
+                  reinterpret_cast<uint16_t*>(dstp)[x] = (uint16_t)v;
+              }
+            }
+            dstp += pitch;
+          }
+        }
+        frames.push_back(frame);
+      }
+    }
+
+    PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment*) override
+    {
+      if (n < 0) n = 0;
+      if (n >= vi.num_frames) n = vi.num_frames - 1;
+      return frames[n % frames.size()];
+    }
+    bool __stdcall GetParity(int) override { return false; }
+    void __stdcall GetAudio(void*, int64_t, int64_t, IScriptEnvironment*) override {}
+    int __stdcall SetCacheHints(int, int) override { return 0; }
+    const VideoInfo& __stdcall GetVideoInfo() override { return vi; }
+  };
+
+  class CallbackClip : public IClip {
+    VideoInfo vi;
+    avsstub::FetchFunc fetch;
+    void* user_data;
+  public:
+    CallbackClip(const VideoInfo& _vi, avsstub::FetchFunc _fetch, void* _user_data) : vi(_vi), fetch(_fetch), user_data(_user_data) {}
+
+    PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override
+    {
+      if (n < 0) n = 0;
+      if (n >= vi.num_frames) n = vi.num_frames - 1;
+      PVideoFrame frame = env->NewVideoFrame(vi);
+      fetch(n, frame, vi, user_data);
+      return frame;
+    }
+    bool __stdcall GetParity(int) override { return false; }
+    void __stdcall GetAudio(void*, int64_t, int64_t, IScriptEnvironment*) override {}
+    int __stdcall SetCacheHints(int, int) override { return 0; }
+    const VideoInfo& __stdcall GetVideoInfo() override { return vi; }
+  };
+
+  struct PixelTypeEntry {
+    int pixel_type;
+    const char* name;
+  };
+
+  const PixelTypeEntry pixel_type_names[] = {
+    { VideoInfo::CS_YV12, "YV12" }, { VideoInfo::CS_YV16, "YV16" }, { VideoInfo::CS_YV24, "YV24" },
+    { VideoInfo::CS_Y8, "Y8" }, { VideoInfo::CS_YUY2, "YUY2" },
+    { VideoInfo::CS_YV12, "YUV420P8" }, { VideoInfo::CS_YV16, "YUV422P8" }, { VideoInfo::CS_YV24, "YUV444P8" },
+    { VideoInfo::CS_YUV420P10, "YUV420P10" }, { VideoInfo::CS_YUV422P10, "YUV422P10" }, { VideoInfo::CS_YUV444P10, "YUV444P10" }, { VideoInfo::CS_Y10, "Y10" },
+    { VideoInfo::CS_YUV420P12, "YUV420P12" }, { VideoInfo::CS_YUV422P12, "YUV422P12" }, { VideoInfo::CS_YUV444P12, "YUV444P12" }, { VideoInfo::CS_Y12, "Y12" },
+    { VideoInfo::CS_YUV420P14, "YUV420P14" }, { VideoInfo::CS_YUV422P14, "YUV422P14" }, { VideoInfo::CS_YUV444P14, "YUV444P14" }, { VideoInfo::CS_Y14, "Y14" },
+    { VideoInfo::CS_YUV420P16, "YUV420P16" }, { VideoInfo::CS_YUV422P16, "YUV422P16" }, { VideoInfo::CS_YUV444P16, "YUV444P16" }, { VideoInfo::CS_Y16, "Y16" },
+    { VideoInfo::CS_YUV420PS, "YUV420PS" }, { VideoInfo::CS_YUV422PS, "YUV422PS" }, { VideoInfo::CS_YUV444PS, "YUV444PS" }, { VideoInfo::CS_Y32, "Y32" },
+    { VideoInfo::CS_RGBP, "RGBP8" }, { VideoInfo::CS_RGBP10, "RGBP10" }, { VideoInfo::CS_RGBP16, "RGBP16" }, { VideoInfo::CS_RGBPS, "RGBPS" },
+  };
+
+} // namespace
+
+namespace avsstub {
+
+  IScriptEnvironment* CreateEnvironment(int cpuflags)
+  {
+    return new ScriptEnvironment(cpuflags);
+  }
+
+  void DeleteEnvironment(IScriptEnvironment* env)
+  {
+    env->DeleteScriptEnvironment();
+  }
+
+  void SetCPUFlags(IScriptEnvironment* env, int cpuflags)
+  {
+    static_cast<ScriptEnvironment*>(env)->SetCPUFlags(cpuflags < 0 ? DetectCPUFlags() : cpuflags);
+  }
+
+  VideoInfo MakeVideoInfo(int pixel_type, int width, int height, int num_frames)
+  {
+    VideoInfo vi;
+    memset((void*)&vi, 0, sizeof(vi));
+    vi.width = width;
+    vi.height = height;
+    vi.fps_numerator = 25;
+    vi.fps_denominator = 1;
+    vi.num_frames = num_frames;
+    vi.pixel_type = pixel_type;
+    return vi;
+  }
+
+  PClip CreateNoiseClip(IScriptEnvironment* env, int pixel_type, int width, int height,
+    int num_frames, float noise, uint32_t seed, int pool)
+  {
+    const VideoInfo vi = MakeVideoInfo(pixel_type, width, height, num_frames);
+    return new NoiseClip(static_cast<ScriptEnvironment*>(env), vi, noise, seed, std::max(1, std::min(pool, num_frames)));
+  }
+
+  PClip CreateCallbackClip(IScriptEnvironment* env, const VideoInfo& vi, FetchFunc fetch, void* user_data)
+  {
+    AVS_UNUSED(env);
+    return new CallbackClip(vi, fetch, user_data);
+  }
+
+  int PixelTypeFromName(const char* name)
+  {
+    for (auto& p : pixel_type_names)
+      if (StubEqualNoCase(p.name, name))
+        return p.pixel_type;
+    return 0;
+  }
+
+  const char* PixelTypeName(int pixel_type)
+  {
+    for (auto& p : pixel_type_names)
+      if (p.pixel_type == pixel_type)
+        return p.name;
+    return "unknown";
+  }
+
+} // namespace avsstub
@@ -0,0 +1,42 @@
+// Minimal in-process AviSynth host used by the benchmark and tool executables.
+// It implements just enough of IScriptEnvironment / AVS_Linkage to load the
+// filter sources without an AviSynth+ install: frame allocation, BitBlt,
+// AddFunction/Invoke with named arguments, CPU flags and frame properties.
+
+#ifndef __AVS_STUB_H__
+#define __AVS_STUB_H__
+
+#include "avisynth.h"
+#include <cstdint>
+
+namespace avsstub {
+
+  // cpuflags: -1 = detect, otherwise the value reported by GetCPUFlags()
+  IScriptEnvironment* CreateEnvironment(int cpuflags = -1);
+  void DeleteEnvironment(IScriptEnvironment* env);
+
+  // override the CPU flags reported to filters created afterwards
+  void SetCPUFlags(IScriptEnvironment* env, int cpuflags);
+  int DetectCPUFlags();
+
+  // Noisy synthetic test clip. The frames contain a slowly moving smooth
+  // pattern plus uniform noise of the given amplitude (in 8 bit units),
+  // they are generated once ('pool' distinct frames) and returned cyclically.
+  PClip CreateNoiseClip(IScriptEnvironment* env, int pixel_type, int width, int height,
+    int num_frames, float noise, uint32_t seed, int pool = 16);
+
+  // Source clip backed by caller supplied frame memory; fetch is called for
+  // every GetFrame and must fill the given frame planes.
+  typedef void(*FetchFunc)(int n, PVideoFrame& dst, const VideoInfo& vi, void* user_data);
+  PClip CreateCallbackClip(IScriptEnvironment* env, const VideoInfo& vi, FetchFunc fetch, void* user_data);
+
+  // VideoInfo helper: builds a planar/packed video info with the given pixel_type
+  VideoInfo MakeVideoInfo(int pixel_type, int width, int height, int num_frames);
+
+  // parse a format name like "YV12", "YUV420P10", "Y16", "YUV444PS", "YUY2"; returns 0 if unknown
+  int PixelTypeFromName(const char* name);
+  const char* PixelTypeName(int pixel_type);
+
+} // namespace avsstub
+
+#endif // __AVS_STUB_H__
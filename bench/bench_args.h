@@ -0,0 +1,43 @@
+// Command line helpers shared by the benchmark executables on the avs_stub.cpp host:
+// comma separated number lists and name=value FFT3DFilter arguments.
+
+#ifndef __BENCH_ARGS_H__
+#define __BENCH_ARGS_H__
+
+#include "avisynth.h"
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// name=value argument passed on to FFT3DFilter
+struct NamedArg {
+  std::string name;
+  std::string value;
+};
+
+// "1,2.5,3" -> {1, 2.5, 3}, stops at the first item which is not a number
+inline std::vector<float> ParseList(const char* s)
+{
+  std::vector<float> list;
+  while (*s)
+  {
+    char* end;
+    list.push_back(strtof(s, &end));
+    if (end == s)
+      break;
+    s = *end == ',' ? end + 1 : end;
+  }
+  return list;
+}
+
+// true/false: bool, with '.' or an exponent: float, else int
+inline AVSValue ArgValue(const std::string& v)
+{
+  if (v == "true" || v == "false")
+    return AVSValue(v == "true");
+  if (v.find_first_of(".eE") != std::string::npos)
+    return AVSValue((float)atof(v.c_str()));
+  return AVSValue(atoi(v.c_str()));
+}
+
+#endif // __BENCH_ARGS_H__
@@ -0,0 +1,171 @@
+// fft3dfilter_bench: speed of FFT3DFilter without an AviSynth+ install.
+//
+// The filter sources are linked against the in-process host of avs_stub.cpp,
+// the source clip is synthetic noise. For every combination of the bt, degrid,
+// pfactor and sharpen lists the filter is made anew and asked for all frames
+// in order. Reported per combination: frames/s, ns per block (wall clock time
+// divided by the blocks of all processed planes) and the per frame stage times
+// of the stats=true frame properties: overlap, fft, kernel and decode, CPU time
+// summed over threads.
+//
+// usage: fft3dfilter_bench [options] [name=value ...]
+//   --width N, --height N      frame size (1920x1080)
+//   --format NAME              YV12, YV24, Y8, YUV420P10, YUV420P16, Y32, YUY2, RGBP8, ... (YV12)
+//   --frames N                 frames per combination, after the warmup (50)
+//   --warmup N                 frames before the measured ones (3)
+//   --noise F                  noise amplitude in 8 bit units (10)
+//   --bt LIST                  comma separated (-1,0,1,2,3,4,5)
+//   --degrid LIST              (0,1)
+//   --pfactor LIST             (0,0.1)
+//   --sharpen LIST             (0,0.3)
+//   --cpu FLAGS                CPU flags seen by the filter, e.g. 0 for the C code (detected)
+//   name=value                 any other FFT3DFilter argument, e.g. plane=4 ncpu=4 bw=48 sigma=3.0
+// FFTW (libfftw3f) is loaded at run time as by the plugin.
+
+#include "avs_stub.h"
+#include "bench_args.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" const char* __stdcall AvisynthPluginInit3(IScriptEnvironment* env, const AVS_Linkage* const vectors);
+
+static int IntArg(const std::vector<NamedArg>& args, const char* name, int def)
+{
+  for (auto& a : args)
+    if (a.name == name)
+      return atoi(a.value.c_str());
+  return def;
+}
+
+// blocks per frame of all processed planes, same formulas as the filter
+static long long BlocksPerFrame(const VideoInfo& vi, const std::vector<NamedArg>& args)
+{
+  int bw = IntArg(args, "bw", 32), bh = IntArg(args, "bh", 32);
+  int ow = IntArg(args, "ow", bw / 3), oh = IntArg(args, "oh", bh / 3);
+  int plane = IntArg(args, "plane", vi.IsRGB() ? 4 : 0);
+  auto blocks = [&](int width, int height) {
+    return (long long)((width - ow + (bw - ow - 1)) / (bw - ow)) * ((height - oh + (bh - oh - 1)) / (bh - oh));
+  };
+  int cw = vi.width, ch = vi.height; // chroma plane size
+  if (vi.IsYUY2())
+    cw = vi.width / 2;
+  else if (vi.IsPlanar() && !vi.IsY() && !vi.IsRGB())
+  {
+    cw = vi.width >> vi.GetPlaneWidthSubsampling(PLANAR_U);
+    ch = vi.height >> vi.GetPlaneHeightSubsampling(PLANAR_U);
+  }
+  if (vi.IsY() || plane == 0)
+    return blocks(vi.width, vi.height);
+  if (plane == 1 || plane == 2)
+    return blocks(cw, ch);
+  if (plane == 3)
+    return 2 * blocks(cw, ch);
+  return blocks(vi.width, vi.height) + 2 * blocks(cw, ch);
+}
+
+int main(int argc, char** argv)
+{
+  int width = 1920, height = 1080, frames = 50, warmup = 3, cpuflags = -1;
+  float noise = 10;
+  const char* format = "YV12";
+  std::vector<float> bts = { -1, 0, 1, 2, 3, 4, 5 }, degrids = { 0, 1 }, pfactors = { 0, 0.1f }, sharpens = { 0, 0.3f };
+  std::vector<NamedArg> extra;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool takes = v != nullptr && !strncmp(a, "--", 2);
+    if (takes && !strcmp(a, "--width")) width = atoi(v);
+    else if (takes && !strcmp(a, "--height")) height = atoi(v);
+    else if (takes && !strcmp(a, "--format")) format = v;
+    else if (takes && !strcmp(a, "--frames")) frames = atoi(v);
+    else if (takes && !strcmp(a, "--warmup")) warmup = atoi(v);
+    else if (takes && !strcmp(a, "--noise")) noise = (float)atof(v);
+    else if (takes && !strcmp(a, "--bt")) bts = ParseList(v);
+    else if (takes && !strcmp(a, "--degrid")) degrids = ParseList(v);
+    else if (takes && !strcmp(a, "--pfactor")) pfactors = ParseList(v);
+    else if (takes && !strcmp(a, "--sharpen")) sharpens = ParseList(v);
+    else if (takes && !strcmp(a, "--cpu")) cpuflags = (int)strtol(v, nullptr, 0);
+    else if (strchr(a, '=') != nullptr && strncmp(a, "--", 2))
+    {
+      const char* eq = strchr(a, '=');
+      extra.push_back({ std::string(a, eq - a), std::string(eq + 1) });
+      continue;
+    }
+    else
+    {
+      fprintf(stderr, "unknown option %s, see the head of fft3dfilter_bench.cpp\n", a);
+      return 2;
+    }
+    i++;
+  }
+
+  int pixel_type = avsstub::PixelTypeFromName(format);
+  if (pixel_type == 0 || width <= 0 || height <= 0 || frames <= 0 || warmup < 0)
+  {
+    fprintf(stderr, "bad format or size\n");
+    return 2;
+  }
+
+  IScriptEnvironment* env = avsstub::CreateEnvironment(cpuflags);
+  AvisynthPluginInit3(env, env->GetAVSLinkage());
+  int failed = 0;
+  {
+    PClip src = avsstub::CreateNoiseClip(env, pixel_type, width, height, warmup + frames, noise, 1234);
+    long long blocks = BlocksPerFrame(src->GetVideoInfo(), extra);
+
+    printf("%s %dx%d, %d frames (+%d warmup), %lld blocks per frame\n", avsstub::PixelTypeName(pixel_type), width, height, frames, warmup, blocks);
+    printf("stage times are CPU ms per frame, summed over threads\n");
+    printf("%4s %6s %7s %7s | %9s %10s | %8s %8s %8s %8s\n", "bt", "degrid", "pfactor", "sharpen", "frames/s", "ns/block", "overlap", "fft", "kernel", "decode");
+
+    for (float bt : bts)
+      for (float degrid : degrids)
+        for (float pfactor : pfactors)
+          for (float sharpen : sharpens)
+          {
+            std::vector<AVSValue> values = { src, AVSValue((int)bt), AVSValue(degrid), AVSValue(pfactor), AVSValue(sharpen), AVSValue(true) };
+            std::vector<const char*> names = { nullptr, "bt", "degrid", "pfactor", "sharpen", "stats" };
+            for (auto& a : extra)
+            {
+              values.push_back(ArgValue(a.value));
+              names.push_back(a.name.c_str());
+            }
+            printf("%4d %6.2f %7.2f %7.2f | ", (int)bt, degrid, pfactor, sharpen);
+            fflush(stdout);
+            try
+            {
+              PClip clip = env->Invoke("FFT3DFilter", AVSValue(values.data(), (int)values.size()), names.data()).AsClip();
+              for (int n = 0; n < warmup; n++)
+                clip->GetFrame(n, env);
+              double overlapms = 0, fftms = 0, kernelms = 0, decodems = 0;
+              auto start = std::chrono::steady_clock::now();
+              for (int n = warmup; n < warmup + frames; n++)
+              {
+                PVideoFrame f = clip->GetFrame(n, env);
+                const AVSMap* props = env->getFramePropsRO(f);
+                int err;
+                overlapms += env->propGetFloat(props, "FFT3D_OverlapTime", 0, &err);
+                fftms += env->propGetFloat(props, "FFT3D_FFTTime", 0, &err);
+                kernelms += env->propGetFloat(props, "FFT3D_KernelTime", 0, &err);
+                decodems += env->propGetFloat(props, "FFT3D_DecodeTime", 0, &err);
+              }
+              double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+              printf("%9.2f %10.1f | %8.3f %8.3f %8.3f %8.3f\n", frames / sec, sec * 1e9 / ((double)frames * blocks),
+                overlapms / frames, fftms / frames, kernelms / frames, decodems / frames);
+            }
+            catch (const AvisynthError& e)
+            {
+              printf("error: %s\n", e.msg);
+              failed++;
+            }
+          }
+  }
+  avsstub::DeleteEnvironment(env);
+  return failed ? 1 : 0;
+}
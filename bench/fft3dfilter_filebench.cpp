@@ -0,0 +1,381 @@
+// fft3dfilter_filebench: speed of the filter engine on a memory mapped raw or Y4M file.
+//
+// The file is mapped read only, with sequential read-ahead advice (Linux madvise
+// MADV_SEQUENTIAL), and the engine reads its source planes straight from the mapping:
+// no decoder, no read() copies, only page faults, which are counted (together with the
+// first touch of the engine buffers at frame 0). --touch faults the whole file in before
+// the clock starts, so that only the filter is timed.
+// Each filtered plane has an fft3d::Engine, the frames are processed in order.
+//
+// usage: fft3dfilter_filebench [options] [name=value ...] FILE
+//   FILE.y4m                   YUV4MPEG2, size and format from its header
+//   --raw WxH:FORMAT           headerless planar frames, FORMAT as a Y4M colorspace: 420, 422, 444, mono,
+//                              with p10, p12, p14, p16 for high bit depth (e.g. 1920x1080:420p10)
+//   --frames N                 frames to process (all)
+//   --touch                    read every page of the file before timing
+//   --cpu FLAGS                CPU flags for the engine, e.g. 0 for the C code (detected)
+//   -o FILE                    write the filtered frames as raw planar frames
+//   name=value                 FFT3DFilter arguments, e.g. sigma=3 bt=3 plane=4 ncpu=4
+// FFTW (libfftw3f) is loaded at run time as by the plugin.
+
+#include "engine.h"
+#include "y4m.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read only mapping of a whole file
+class MappedFile {
+  const uint8_t *base = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+public:
+  bool open(const char *path, std::string &error)
+  {
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size))
+    {
+      error = std::string("cannot open ") + path;
+      return false;
+    }
+    length = (size_t)size.QuadPart;
+    mapping = length ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    base = mapping ? (const uint8_t *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int fd = ::open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+      if (fd >= 0)
+        close(fd);
+      error = std::string("cannot open ") + path;
+      return false;
+    }
+    length = (size_t)st.st_size;
+    void *p = length ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd); // the mapping keeps the file
+    base = p == MAP_FAILED ? nullptr : (const uint8_t *)p;
+    if (base)
+      madvise((void *)base, length, MADV_SEQUENTIAL); // aggressive read-ahead, pages behind may be dropped
+#endif
+    if (base == nullptr)
+    {
+      error = std::string("cannot map ") + path;
+      return false;
+    }
+    return true;
+  }
+
+  ~MappedFile()
+  {
+#ifdef _WIN32
+    if (base)
+      UnmapViewOfFile(base);
+    if (mapping)
+      CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+      CloseHandle(file);
+#else
+    if (base)
+      munmap((void *)base, length);
+#endif
+  }
+
+  const uint8_t *data() const { return base; }
+  size_t size() const { return length; }
+};
+
+// page faults of the process so far: minor (page cache), major (disk)
+static void PageFaults(long long &minor, long long &major)
+{
+  minor = major = 0;
+#ifndef _WIN32
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0)
+  {
+    minor = ru.ru_minflt;
+    major = ru.ru_majflt;
+  }
+#endif
+}
+
+// One plane of the frames of the mapping, read in place
+class MappedSource : public fft3d::FrameSource {
+  const MappedFile &file;
+  const Y4MFormat &format;
+  int plane;
+
+public:
+  std::vector<size_t> frames;
+  size_t planeoffset;
+
+  MappedSource(const MappedFile &_file, const Y4MFormat &_format, int _plane, size_t _planeoffset) :
+    file(_file), format(_format), plane(_plane), planeoffset(_planeoffset) {}
+
+  fft3d::Plane GetPlane(int k) override
+  {
+    fft3d::Plane p;
+    p.ptr = file.data() + frames[k] + planeoffset;
+    p.pitch = format.PlaneWidth(plane) * format.BytesPerSample();
+    return p;
+  }
+};
+
+// offsets of the frame data in a Y4M file, after their FRAME lines
+static bool IndexY4M(const MappedFile &file, size_t pos, size_t framebytes, std::vector<size_t> &frames)
+{
+  const uint8_t *p = file.data();
+  size_t size = file.size();
+  while (pos < size)
+  {
+    if (size - pos < 5 || memcmp(p + pos, "FRAME", 5) != 0)
+      return false;
+    const uint8_t *nl = (const uint8_t *)memchr(p + pos, '\n', size - pos);
+    if (nl == nullptr)
+      return false;
+    pos = nl - p + 1;
+    if (size - pos < framebytes)
+      return false; // truncated
+    frames.push_back(pos);
+    pos += framebytes;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const char *path = nullptr, *raw = nullptr, *outpath = nullptr;
+  int maxframes = -1, cpuflags = -1, plane = 0;
+  bool touch = false;
+  fft3d::Params params;
+  bool sigma2set = false, sigma3set = false, sigma4set = false;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    const char *eq = strchr(a, '=');
+    if (v && !strcmp(a, "--raw")) { raw = v; i++; }
+    else if (v && !strcmp(a, "--frames")) { maxframes = atoi(v); i++; }
+    else if (v && !strcmp(a, "--cpu")) { cpuflags = (int)strtol(v, nullptr, 0); i++; }
+    else if (v && !strcmp(a, "-o")) { outpath = v; i++; }
+    else if (!strcmp(a, "--touch")) touch = true;
+    else if (eq && a[0] != '-')
+    {
+      std::string name(a, eq - a);
+      const char *val = eq + 1;
+      bool b = !strcmp(val, "true") || atoi(val) != 0;
+      if (name == "plane") plane = atoi(val);
+      else if (name == "sigma") params.sigma = (float)atof(val);
+      else if (name == "beta") params.beta = (float)atof(val);
+      else if (name == "bw") params.bw = atoi(val);
+      else if (name == "bh") params.bh = atoi(val);
+      else if (name == "bt") params.bt = atoi(val);
+      else if (name == "ow") params.ow = atoi(val);
+      else if (name == "oh") params.oh = atoi(val);
+      else if (name == "kratio") params.kratio = (float)atof(val);
+      else if (name == "sharpen") params.sharpen = (float)atof(val);
+      else if (name == "scutoff") params.scutoff = (float)atof(val);
+      else if (name == "svr") params.svr = (float)atof(val);
+      else if (name == "smin") params.smin = (float)atof(val);
+      else if (name == "smax") params.smax = (float)atof(val);
+      else if (name == "measure") params.measure = b;
+      else if (name == "interlaced") params.interlaced = b;
+      else if (name == "wintype") params.wintype = atoi(val);
+      else if (name == "pframe") params.pframe = atoi(val);
+      else if (name == "px") params.px = atoi(val);
+      else if (name == "py") params.py = atoi(val);
+      else if (name == "pcutoff") params.pcutoff = (float)atof(val);
+      else if (name == "pfactor") params.pfactor = (float)atof(val);
+      else if (name == "sigma2") { params.sigma2 = (float)atof(val); sigma2set = true; }
+      else if (name == "sigma3") { params.sigma3 = (float)atof(val); sigma3set = true; }
+      else if (name == "sigma4") { params.sigma4 = (float)atof(val); sigma4set = true; }
+      else if (name == "degrid") params.degrid = (float)atof(val);
+      else if (name == "dehalo") params.dehalo = (float)atof(val);
+      else if (name == "hr") params.hr = (float)atof(val);
+      else if (name == "ht") params.ht = (float)atof(val);
+      else if (name == "ncpu") params.ncpu = atoi(val);
+      else if (name == "numa") params.numa = atoi(val);
+      else if (name == "halfcache") params.halfcache = b;
+      else if (name == "hugepages") params.hugepages = atoi(val);
+      else if (name == "membudget") params.membudget = (size_t)std::max(0, atoi(val)) << 20;
+      else if (name == "removemean") params.removemean = b;
+      else
+      {
+        fprintf(stderr, "unknown parameter %s\n", name.c_str());
+        return 2;
+      }
+    }
+    else if (!path && a[0] != '-')
+      path = a;
+    else
+    {
+      fprintf(stderr, "unknown option %s, see the head of fft3dfilter_filebench.cpp\n", a);
+      return 2;
+    }
+  }
+  if (!sigma2set) params.sigma2 = params.sigma;
+  if (!sigma3set) params.sigma3 = params.sigma;
+  if (!sigma4set) params.sigma4 = params.sigma;
+  if (path == nullptr)
+  {
+    fprintf(stderr, "usage: fft3dfilter_filebench [--raw WxH:FORMAT] [--frames N] [--touch] [--cpu FLAGS] [-o FILE] [name=value ...] FILE\n");
+    return 2;
+  }
+
+  std::string error;
+  MappedFile file;
+  if (!file.open(path, error))
+  {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  // format and frame index
+  Y4MFormat format;
+  std::vector<size_t> frames;
+  if (raw)
+  {
+    int w = 0, h = 0;
+    char colorspace[32] = "";
+    if (sscanf(raw, "%dx%d:%31s", &w, &h, colorspace) != 3 ||
+      !ParseY4MHeader(std::string("YUV4MPEG2 W") + std::to_string(w) + " H" + std::to_string(h) + " C" + colorspace, format, error))
+    {
+      fprintf(stderr, "bad --raw %s %s\n", raw, error.c_str());
+      return 2;
+    }
+    for (size_t pos = 0; pos + format.FrameBytes() <= file.size(); pos += format.FrameBytes())
+      frames.push_back(pos);
+  }
+  else
+  {
+    const uint8_t *nl = (const uint8_t *)memchr(file.data(), '\n', std::min<size_t>(file.size(), 4096));
+    if (nl == nullptr || !ParseY4MHeader(std::string((const char *)file.data(), nl - file.data()), format, error))
+    {
+      fprintf(stderr, "%s: %s\n", path, error.empty() ? "no YUV4MPEG2 header, use --raw" : error.c_str());
+      return 1;
+    }
+    if (!IndexY4M(file, nl - file.data() + 1, format.FrameBytes(), frames))
+      fprintf(stderr, "%s: bad or truncated frame after %d frames, the rest is ignored\n", path, (int)frames.size());
+  }
+  if (maxframes >= 0 && (size_t)maxframes < frames.size())
+    frames.resize(maxframes);
+  if (frames.empty())
+  {
+    fprintf(stderr, "%s: no frames\n", path);
+    return 1;
+  }
+
+  // planes as FFT3DFilter's plane: 0 Y, 1 U, 2 V, 3 U and V, 4 all
+  if (plane < 0 || plane > 4)
+  {
+    fprintf(stderr, "plane must be from 0 to 4\n");
+    return 2;
+  }
+  bool filtered[3] = { plane == 0 || plane == 4, plane == 1 || plane >= 3, plane == 2 || plane >= 3 };
+  if (format.planes == 1)
+    filtered[1] = filtered[2] = false;
+
+  size_t planeoffset[3] = { 0, format.PlaneBytes(0), format.PlaneBytes(0) + format.PlaneBytes(1) };
+  std::unique_ptr<MappedSource> sources[3];
+  std::unique_ptr<fft3d::Engine> engines[3];
+  std::vector<uint8_t> out[3];
+  try
+  {
+    int flags = cpuflags == -1 ? fft3d::DetectCPUFlags() : cpuflags;
+    for (int p = 0; p < format.planes; p++)
+    {
+      out[p].resize(format.PlaneBytes(p));
+      if (!filtered[p])
+        continue;
+      sources[p].reset(new MappedSource(file, format, p, planeoffset[p]));
+      sources[p]->frames = frames;
+      fft3d::Format f;
+      f.width = format.PlaneWidth(p);
+      f.height = format.PlaneHeight(p);
+      f.bits_per_pixel = format.bits;
+      f.chroma = p != 0;
+      f.num_frames = (int)frames.size();
+      engines[p].reset(new fft3d::Engine(params, f, sources[p].get(), flags));
+    }
+  }
+  catch (const fft3d::Error &e)
+  {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  FILE *outfile = nullptr;
+  if (outpath && (outfile = fopen(outpath, "wb")) == nullptr)
+  {
+    fprintf(stderr, "cannot write %s\n", outpath);
+    return 1;
+  }
+
+  if (touch)
+  {
+    volatile uint8_t sum = 0;
+    for (size_t pos = 0; pos < file.size(); pos += 4096)
+      sum += file.data()[pos];
+  }
+
+  long long minor0, major0, minor1, major1;
+  PageFaults(minor0, major0);
+  auto start = std::chrono::steady_clock::now();
+  try
+  {
+    for (int n = 0; n < (int)frames.size(); n++)
+    {
+      for (int p = 0; p < format.planes; p++)
+      {
+        int rowsize = format.PlaneWidth(p) * format.BytesPerSample();
+        if (engines[p])
+        {
+          fft3d::Plane srcplane = engines[p]->Source(n);
+          if (!engines[p]->Process(n, srcplane, out[p].data(), rowsize))
+            memcpy(out[p].data(), srcplane.ptr, out[p].size()); // Kalman first frame
+        }
+        else if (outfile)
+          memcpy(out[p].data(), file.data() + frames[n] + planeoffset[p], out[p].size());
+        if (outfile)
+          fwrite(out[p].data(), 1, out[p].size(), outfile);
+      }
+    }
+  }
+  catch (const fft3d::Error &e)
+  {
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  PageFaults(minor1, major1);
+  if (outfile)
+    fclose(outfile);
+
+  double mb = (double)frames.size() * format.FrameBytes() / (1 << 20);
+  printf("%s: %dx%d %d bit, %d planes, %d frames\n", path, format.width, format.height, format.bits, format.planes, (int)frames.size());
+  printf("%.3f s, %.2f frames/s, %.1f MB/s of input, page faults: %lld minor, %lld major%s\n", sec, frames.size() / sec, mb / sec,
+    minor1 - minor0, major1 - major0, touch ? " (pre-touched)" : "");
+  return 0;
+}
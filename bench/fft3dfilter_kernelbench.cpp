@@ -0,0 +1,330 @@
+// fft3dfilter_kernelbench: speed of the frequency domain kernels, per instruction set.
+//
+// Every kernel of fft3dfilter_c.cpp, fft3dfilter_sse.cpp and fft3dfilter_avx2.cpp is
+// called on random spectra of howmanyblocks blocks of bw x bh, through the CPU dispatching
+// functions of engine.cpp with the CPU flags forced to C, SSE2 and the detected set
+// (AVX2). So the code is measured which the filter really runs with those flags: the old
+// x86 assembler kernels are not built for x64, there the dispatchers use the C code.
+// Kernels which the filter calls only in C (e.g. bt=5, most degrid variants) have no
+// SIMD columns.
+// Reported: coefficients per ns (complex values of the half spectrum, outwidth*bh per
+// block; samples for the block mean kernels, pixels for the YUY2 rows) and the speedup
+// against C. Kernels which work in place get their input restored before every call,
+// the time of that copy is measured alone and subtracted.
+//
+// usage: fft3dfilter_kernelbench [options]
+//   --sizes LIST      bw x bh x howmanyblocks, comma separated (16x16x1024,32x32x256,64x64x64)
+//   --kernel NAME     only the kernels whose name contains NAME
+//   --time MS         time of one measurement, the best of 5 is taken (20)
+//   --cpu FLAGS       CPU flags of the last column (detected)
+
+#include "avs_stub.h"
+#include "arena.h"
+#include "fftwlite.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+// CPU dispatching kernels of engine.cpp (last argument CPUFlags)
+void ApplyWiener2D(fftwf_complex *out, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float dehalo, float *wdehalo, float ht2n, int CPUFlags);
+void ApplyPattern2D(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float pfactor, float *pattern2d0, float beta, int CPUFlags);
+void ApplyWiener3D2(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, int CPUFlags);
+void ApplyPattern3D2(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, int CPUFlags);
+void ApplyWiener3D3(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, int CPUFlags);
+void ApplyPattern3D3(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, int CPUFlags);
+void ApplyWiener3D3_degrid(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags);
+void ApplyPattern3D3_degrid(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags);
+void ApplyWiener3D4(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, int CPUFlags);
+void ApplyPattern3D4(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, int CPUFlags);
+void ApplyWiener3D4_degrid(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags);
+void ApplyPattern3D4_degrid(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags);
+void ApplyKalman(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float covarNoiseNormed, float kratio2, int CPUFlags);
+void ApplyKalmanPattern(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float *covarNoiseNormed, float kratio2, int CPUFlags);
+void Sharpen(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float dehalo, float *wdehalo, float ht2n, int CPUFlags);
+void Sharpen_degrid(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float degrid, fftwf_complex *gridsample, float dehalo, float *wdehalo, float ht2n, int CPUFlags);
+void SpectrumToHalf(const fftwf_complex *src, uint16_t *dst, int size, float scale, int CPUFlags);
+void HalfToSpectrum(const uint16_t *src, fftwf_complex *dst, int size, float scale, int CPUFlags);
+void GetAndSubtractMean(float *in, int howmanyblocks, int bwbh, const float *wanblock, float meannorm, float *mean, int CPUFlags);
+void RestoreMean(float *in, int howmanyblocks, int bwbh, const float *wanblock, float scale, const float *mean, int CPUFlags);
+void YUY2ToPlaneRow(const uint8_t *src, uint8_t *dst, int width, int plane, int CPUFlags);
+void PlaneRowToYUY2(const uint8_t *src, uint8_t *dst, int width, int plane, int CPUFlags);
+void MergeYUY2Row(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize, int CPUFlags);
+// called by the filter only in C
+void ApplyWiener2D_degrid_C(fftwf_complex *out, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float degrid, fftwf_complex *gridsample, float dehalo, float *wdehalo, float ht2n);
+void ApplyPattern2D_degrid_C(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float pfactor, float *pattern2d0, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyWiener3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyWiener3D5_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D5_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta);
+void ApplyWiener3D5_degrid_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D5_degrid_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+
+struct Size {
+  int bw, bh, blocks;
+};
+
+// buffers of one size, random content; the pristine copies restore the in-place kernels
+struct Buffers {
+  Arena arena;
+  int bw, bh, blocks, outwidth, outpitch;
+  size_t outsize; // complex values of all blocks
+  fftwf_complex *cur, *prev2, *prev, *next, *next2, *dst, *gridsample;
+  fftwf_complex *cur0, *last, *last0;
+  float *covar, *covar0, *covarProcess, *covarProcess0;
+  float *pattern, *wsharpen, *wdehalo, *covarNoise;
+  float *in, *in0, *wanblock, *mean;
+  uint16_t *half;
+  uint8_t *yuy2, *yuy2b, *row;
+
+  Buffers(const Size &s) : bw(s.bw), bh(s.bh), blocks(s.blocks)
+  {
+    outwidth = bw / 2 + 1;
+    outpitch = (outwidth + 1) / 2 * 2; // even, as in the filter
+    outsize = (size_t)outpitch * bh * blocks;
+    size_t insize = (size_t)bw * bh * blocks;
+    for (fftwf_complex **p : { &cur, &prev2, &prev, &next, &next2, &dst, &cur0, &last, &last0 })
+      arena.reserve(*p, outsize);
+    arena.reserve(gridsample, (size_t)outpitch * bh);
+    for (float **p : { &covar, &covar0, &covarProcess, &covarProcess0 })
+      arena.reserve(*p, outsize);
+    for (float **p : { &pattern, &wsharpen, &wdehalo, &covarNoise })
+      arena.reserve(*p, (size_t)outpitch * bh);
+    arena.reserve(in, insize);
+    arena.reserve(in0, insize);
+    arena.reserve(wanblock, (size_t)bw * bh);
+    arena.reserve(mean, (size_t)blocks);
+    arena.reserve(half, outsize * 2);
+    arena.reserve(yuy2, insize * 2);
+    arena.reserve(yuy2b, insize * 2);
+    arena.reserve(row, insize);
+    if (!arena.allocate())
+    {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+
+    // spectra around the noise level, so that the Wiener factors are not all 0 or 1
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> coef(0.0f, 100.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (fftwf_complex *p : { cur0, prev2, prev, next, next2, last0 })
+      for (size_t i = 0; i < outsize; i++)
+      {
+        p[i][0] = coef(rng);
+        p[i][1] = coef(rng);
+      }
+    for (int i = 0; i < outpitch * bh; i++)
+    {
+      gridsample[i][0] = coef(rng) * 0.1f;
+      gridsample[i][1] = coef(rng) * 0.1f;
+      pattern[i] = 10000.0f * (0.5f + unit(rng));
+      covarNoise[i] = pattern[i];
+      wsharpen[i] = unit(rng);
+      wdehalo[i] = unit(rng);
+    }
+    for (size_t i = 0; i < outsize; i++)
+      covar0[i] = covarProcess0[i] = 10000.0f;
+    for (size_t i = 0; i < insize; i++)
+      in0[i] = 255.0f * unit(rng);
+    for (int i = 0; i < bw * bh; i++)
+      wanblock[i] = unit(rng);
+    for (int i = 0; i < blocks; i++)
+      mean[i] = 128.0f;
+    for (size_t i = 0; i < insize * 2; i++)
+      yuy2[i] = yuy2b[i] = (uint8_t)rng();
+    for (size_t i = 0; i < insize; i++)
+      row[i] = (uint8_t)rng();
+    memcpy(cur, cur0, sizeof(fftwf_complex) * outsize);
+    SpectrumToHalf(cur, half, (int)outsize, 1.0f / 256, 0);
+  }
+
+  size_t coefs() const { return (size_t)outwidth * bh * blocks; }
+  size_t samples() const { return (size_t)bw * bh * blocks; }
+};
+
+struct Kernel {
+  const char *name;
+  bool simd; // the dispatcher has SIMD code (for x64 it can still be C, see above)
+  std::function<size_t(const Buffers &)> count; // coefficients (samples, pixels) of a call
+  std::function<void(Buffers &, int)> run; // (buffers, CPUFlags)
+  std::function<void(Buffers &)> restore; // null: input is not changed
+};
+
+static std::vector<Kernel> MakeKernels()
+{
+  const float sigma2 = 10000.0f, beta = 1.0f, degrid = 1.0f, pfactor = 0.1f, kratio2 = 4.0f;
+  const float sharpen = 0.3f, smin = 1000.0f, smax = 100000.0f, dehalo = 0.0f, ht2n = 0.0f;
+  auto coefs = [](const Buffers &b) { return b.coefs(); };
+  auto samples = [](const Buffers &b) { return b.samples(); };
+  auto restore_cur = [](Buffers &b) { memcpy(b.cur, b.cur0, sizeof(fftwf_complex) * b.outsize); };
+  auto restore_kalman = [](Buffers &b) {
+    memcpy(b.cur, b.cur0, sizeof(fftwf_complex) * b.outsize);
+    memcpy(b.last, b.last0, sizeof(fftwf_complex) * b.outsize);
+    memcpy(b.covar, b.covar0, sizeof(float) * b.outsize);
+    memcpy(b.covarProcess, b.covarProcess0, sizeof(float) * b.outsize);
+  };
+  auto restore_in = [](Buffers &b) { memcpy(b.in, b.in0, sizeof(float) * b.samples()); };
+
+  return {
+    { "ApplyWiener2D", false, coefs, [=](Buffers &b, int f) { ApplyWiener2D(b.cur, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, sharpen, smin, smax, b.wsharpen, dehalo, b.wdehalo, ht2n, f); }, restore_cur },
+    { "ApplyWiener2D_degrid", false, coefs, [=](Buffers &b, int) { ApplyWiener2D_degrid_C(b.cur, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, sharpen, smin, smax, b.wsharpen, degrid, b.gridsample, dehalo, b.wdehalo, ht2n); }, restore_cur },
+    { "ApplyPattern2D", false, coefs, [=](Buffers &b, int f) { ApplyPattern2D(b.cur, b.outwidth, b.outpitch, b.bh, b.blocks, pfactor, b.pattern, beta, f); }, restore_cur },
+    { "ApplyPattern2D_degrid", false, coefs, [=](Buffers &b, int) { ApplyPattern2D_degrid_C(b.cur, b.outwidth, b.outpitch, b.bh, b.blocks, pfactor, b.pattern, beta, degrid, b.gridsample); }, restore_cur },
+    { "ApplyKalman", true, coefs, [=](Buffers &b, int f) { ApplyKalman(b.cur, b.last, b.covar, b.covarProcess, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, kratio2, f); }, restore_kalman },
+    { "ApplyKalmanPattern", false, coefs, [=](Buffers &b, int f) { ApplyKalmanPattern(b.cur, b.last, b.covar, b.covarProcess, b.outwidth, b.outpitch, b.bh, b.blocks, b.covarNoise, kratio2, f); }, restore_kalman },
+    { "ApplyWiener3D2", true, coefs, [=](Buffers &b, int f) { ApplyWiener3D2(b.cur0, b.prev, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, f); }, nullptr },
+    { "ApplyWiener3D2_degrid", false, coefs, [=](Buffers &b, int) { ApplyWiener3D2_degrid_C(b.cur0, b.prev, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, degrid, b.gridsample); }, nullptr },
+    { "ApplyPattern3D2", true, coefs, [=](Buffers &b, int f) { ApplyPattern3D2(b.cur0, b.prev, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, f); }, nullptr },
+    { "ApplyPattern3D2_degrid", false, coefs, [=](Buffers &b, int) { ApplyPattern3D2_degrid_C(b.cur0, b.prev, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, degrid, b.gridsample); }, nullptr },
+    { "ApplyWiener3D3", true, coefs, [=](Buffers &b, int f) { ApplyWiener3D3(b.cur0, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, f); }, nullptr },
+    { "ApplyWiener3D3_degrid", true, coefs, [=](Buffers &b, int f) { ApplyWiener3D3_degrid(b.cur0, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, degrid, b.gridsample, f); }, nullptr },
+    { "ApplyPattern3D3", true, coefs, [=](Buffers &b, int f) { ApplyPattern3D3(b.cur0, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, f); }, nullptr },
+    { "ApplyPattern3D3_degrid", true, coefs, [=](Buffers &b, int f) { ApplyPattern3D3_degrid(b.cur0, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, degrid, b.gridsample, f); }, nullptr },
+    { "ApplyWiener3D4", true, coefs, [=](Buffers &b, int f) { ApplyWiener3D4(b.cur0, b.prev2, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, f); }, nullptr },
+    { "ApplyWiener3D4_degrid", true, coefs, [=](Buffers &b, int f) { ApplyWiener3D4_degrid(b.cur0, b.prev2, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, degrid, b.gridsample, f); }, nullptr },
+    { "ApplyPattern3D4", false, coefs, [=](Buffers &b, int f) { ApplyPattern3D4(b.cur0, b.prev2, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, f); }, nullptr },
+    { "ApplyPattern3D4_degrid", true, coefs, [=](Buffers &b, int f) { ApplyPattern3D4_degrid(b.cur0, b.prev2, b.prev, b.next, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, degrid, b.gridsample, f); }, nullptr },
+    { "ApplyWiener3D5", false, coefs, [=](Buffers &b, int) { ApplyWiener3D5_C(b.cur0, b.prev2, b.prev, b.next, b.next2, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta); }, nullptr },
+    { "ApplyWiener3D5_degrid", false, coefs, [=](Buffers &b, int) { ApplyWiener3D5_degrid_C(b.cur0, b.prev2, b.prev, b.next, b.next2, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, sigma2, beta, degrid, b.gridsample); }, nullptr },
+    { "ApplyPattern3D5", false, coefs, [=](Buffers &b, int) { ApplyPattern3D5_C(b.cur0, b.prev2, b.prev, b.next, b.next2, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta); }, nullptr },
+    { "ApplyPattern3D5_degrid", false, coefs, [=](Buffers &b, int) { ApplyPattern3D5_degrid_C(b.cur0, b.prev2, b.prev, b.next, b.next2, b.dst, b.outwidth, b.outpitch, b.bh, b.blocks, b.pattern, beta, degrid, b.gridsample); }, nullptr },
+    { "Sharpen", true, coefs, [=](Buffers &b, int f) { Sharpen(b.cur, b.outwidth, b.outpitch, b.bh, b.blocks, sharpen, smin, smax, b.wsharpen, dehalo, b.wdehalo, ht2n, f); }, restore_cur },
+    { "Sharpen_degrid", true, coefs, [=](Buffers &b, int f) { Sharpen_degrid(b.cur, b.outwidth, b.outpitch, b.bh, b.blocks, sharpen, smin, smax, b.wsharpen, degrid, b.gridsample, dehalo, b.wdehalo, ht2n, f); }, restore_cur },
+    { "SpectrumToHalf", true, coefs, [=](Buffers &b, int f) { SpectrumToHalf(b.cur0, b.half, (int)b.outsize, 1.0f / 256, f); }, nullptr },
+    { "HalfToSpectrum", true, coefs, [=](Buffers &b, int f) { HalfToSpectrum(b.half, b.dst, (int)b.outsize, 256.0f, f); }, nullptr },
+    { "GetAndSubtractMean", true, samples, [=](Buffers &b, int f) { GetAndSubtractMean(b.in, b.blocks, b.bw * b.bh, b.wanblock, 1.0f / (b.bw * b.bh), b.mean, f); }, restore_in },
+    { "RestoreMean", true, samples, [=](Buffers &b, int f) { RestoreMean(b.in, b.blocks, b.bw * b.bh, b.wanblock, 1.0f, b.mean, f); }, restore_in },
+    { "YUY2ToPlaneRow", true, samples, [=](Buffers &b, int f) { YUY2ToPlaneRow(b.yuy2, b.row, (int)b.samples(), 0, f); }, nullptr },
+    { "PlaneRowToYUY2", true, samples, [=](Buffers &b, int f) { PlaneRowToYUY2(b.row, b.yuy2b, (int)b.samples(), 0, f); }, nullptr },
+    { "MergeYUY2Row", true, samples, [=](Buffers &b, int f) { MergeYUY2Row(b.yuy2, b.yuy2, b.yuy2, b.yuy2b, (int)b.samples() * 2, f); }, nullptr },
+  };
+}
+
+// ns of one call, the best of 5 measurements of about ms milliseconds each
+static double Measure(const std::function<void()> &call, double ms)
+{
+  using clock = std::chrono::steady_clock;
+  call(); // warm the caches
+  int reps = 1;
+  for (;;)
+  {
+    auto start = clock::now();
+    for (int i = 0; i < reps; i++)
+      call();
+    double t = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    if (t >= ms / 4 || reps >= (1 << 24))
+    {
+      reps = std::max(1, (int)(reps * ms / std::max(t, 1e-3)));
+      break;
+    }
+    reps *= 4;
+  }
+  double best = 0;
+  for (int m = 0; m < 5; m++)
+  {
+    auto start = clock::now();
+    for (int i = 0; i < reps; i++)
+      call();
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / reps;
+    best = m == 0 ? ns : std::min(best, ns);
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  std::vector<Size> sizes = { { 16, 16, 1024 }, { 32, 32, 256 }, { 64, 64, 64 } };
+  const char *only = nullptr;
+  double ms = 20;
+  int cpuflags = avsstub::DetectCPUFlags();
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (v != nullptr && !strcmp(a, "--sizes"))
+    {
+      sizes.clear();
+      for (const char *s = v; *s;)
+      {
+        Size z;
+        int n = 0;
+        if (sscanf(s, "%dx%dx%d%n", &z.bw, &z.bh, &z.blocks, &n) != 3 || z.bw < 2 || z.bh < 2 || z.blocks < 1)
+        {
+          fprintf(stderr, "bad size list %s\n", v);
+          return 2;
+        }
+        sizes.push_back(z);
+        s += n;
+        if (*s == ',')
+          s++;
+      }
+    }
+    else if (v != nullptr && !strcmp(a, "--kernel")) only = v;
+    else if (v != nullptr && !strcmp(a, "--time")) ms = atof(v);
+    else if (v != nullptr && !strcmp(a, "--cpu")) cpuflags = (int)strtol(v, nullptr, 0);
+    else
+    {
+      fprintf(stderr, "unknown option %s, see the head of fft3dfilter_kernelbench.cpp\n", a);
+      return 2;
+    }
+    i++;
+  }
+
+  struct Variant {
+    const char *name;
+    int flags;
+  };
+  std::vector<Variant> variants = { { "C", 0 } };
+  const int sse2 = CPUF_MMX | CPUF_INTEGER_SSE | CPUF_SSE | CPUF_SSE2;
+  if ((cpuflags & sse2) == sse2)
+    variants.push_back({ "SSE2", cpuflags & (sse2 | CPUF_SSE3 | CPUF_SSSE3 | CPUF_SSE4_1 | CPUF_SSE4_2) });
+  if (cpuflags & CPUF_AVX2)
+    variants.push_back({ "AVX2", cpuflags });
+
+  std::vector<Kernel> kernels = MakeKernels();
+  printf("coefficients per ns (x: speedup against C), best of 5 runs of %.0f ms\n", ms);
+  for (const Size &s : sizes)
+  {
+    Buffers b(s);
+    printf("\nbw=%d bh=%d howmanyblocks=%d\n%-24s", s.bw, s.bh, s.blocks, "kernel");
+    for (const Variant &v : variants)
+      printf(" %9s %6s", v.name, v.flags ? "x" : "");
+    printf("\n");
+    for (const Kernel &k : kernels)
+    {
+      if (only != nullptr && strstr(k.name, only) == nullptr)
+        continue;
+      double restorens = k.restore ? Measure([&] { k.restore(b); }, ms) : 0;
+      double cns = 0;
+      printf("%-24s", k.name);
+      for (const Variant &v : variants)
+      {
+        if (v.flags != 0 && !k.simd)
+        {
+          printf(" %9s %6s", "-", "");
+          continue;
+        }
+        double ns = k.restore ? Measure([&] { k.restore(b); k.run(b, v.flags); }, ms) - restorens : Measure([&] { k.run(b, v.flags); }, ms);
+        ns = std::max(ns, 1e-3);
+        double rate = k.count(b) / ns;
+        if (v.flags == 0)
+        {
+          cns = ns;
+          printf(" %9.3f %6s", rate, "");
+        }
+        else
+          printf(" %9.3f %5.2fx", rate, cns / ns);
+      }
+      printf("\n");
+      fflush(stdout);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,560 @@
+// fft3dfilter_perfjson: machine readable throughput records for tracking the filter speed across versions.
+//
+// The filter sources are linked against the in-process host of avs_stub.cpp, as fft3dfilter_bench.
+// For every case of the matrix (resolution, bit depth, bt, bw, degrid, pfactor) FFT3DFilter is made
+// anew with stats=true on a synthetic YUV 4:2:0 noise clip and asked for all frames in order.
+// One JSON document is written per run: the machine (CPU model, detected CPU flags), the FFT backend
+// (FFTW version, planner flags) and one record per case with the kernels the filter picked, frames/s
+// and the per stage times in ns per frame of the stats frame properties. These are CPU times summed
+// over threads, they do not add up to the wall clock ns_per_frame.
+//
+// With --baseline the frames/s of every case are compared to the same case of an earlier result
+// file, slower by more than --threshold percent is reported as a regression and the exit code is 1.
+// --input compares an existing result file instead of measuring.
+//
+// usage: fft3dfilter_perfjson [options] [name=value ...]
+//   --sizes LIST               WxH, comma separated (1920x1080)
+//   --bits LIST                8, 10, 12, 14, 16, 32 (float) (8,16)
+//   --bt LIST                  (0,1,2,3)
+//   --bw LIST                  block sizes, bh=bw, ow=oh=bw/3 (32,48)
+//   --degrid LIST              (0,1)
+//   --pfactor LIST             (0,0.1)
+//   --frames N                 frames per case, after the warmup (10)
+//   --warmup N                 frames before the measured ones (3)
+//   --cpu FLAGS                CPU flags seen by the filter, e.g. 0 for the C code (detected)
+//   --json FILE                result file (standard output)
+//   --baseline FILE            compare to this earlier result
+//   --threshold PCT            frames/s drop counted as a regression (5)
+//   --input FILE               compare this result to the baseline, do not measure
+//   name=value                 any other FFT3DFilter argument, e.g. plane=4 ncpu=4 sigma=3.0
+// Progress and the comparison are printed to stderr. Exit code 0: all fine, 1: a case failed or
+// a regression, 2: bad usage or files.
+
+#include "avs_stub.h"
+#include "bench_args.h"
+#include "fftwlite.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+extern "C" const char* __stdcall AvisynthPluginInit3(IScriptEnvironment* env, const AVS_Linkage* const vectors);
+
+static const char* FormatOfBits(int bits)
+{
+  switch (bits)
+  {
+  case 8: return "YV12";
+  case 10: return "YUV420P10";
+  case 12: return "YUV420P12";
+  case 14: return "YUV420P14";
+  case 16: return "YUV420P16";
+  case 32: return "YUV420PS";
+  }
+  return nullptr;
+}
+
+//-----------------------------------------------------------------------------
+// machine and FFT backend
+
+static std::string CPUModel()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+  unsigned int regs[12] = {};
+  for (unsigned int i = 0; i < 3; i++)
+  {
+#if defined(_MSC_VER)
+    __cpuid((int*)&regs[i * 4], 0x80000002 + i);
+#else
+    __get_cpuid(0x80000002 + i, &regs[i * 4], &regs[i * 4 + 1], &regs[i * 4 + 2], &regs[i * 4 + 3]);
+#endif
+  }
+  std::string model((const char*)regs, strnlen((const char*)regs, sizeof(regs)));
+  size_t first = model.find_first_not_of(' ');
+  return first == std::string::npos ? "unknown" : model.substr(first);
+#else
+  return "unknown";
+#endif
+}
+
+static std::string CPUFlagNames(int flags)
+{
+  static const struct { int flag; const char* name; } names[] = {
+    { CPUF_MMX, "MMX" }, { CPUF_INTEGER_SSE, "ISSE" }, { CPUF_SSE, "SSE" }, { CPUF_SSE2, "SSE2" },
+    { CPUF_SSE3, "SSE3" }, { CPUF_SSSE3, "SSSE3" }, { CPUF_SSE4_1, "SSE4.1" }, { CPUF_SSE4_2, "SSE4.2" },
+    { CPUF_AVX, "AVX" }, { CPUF_AVX2, "AVX2" }, { CPUF_FMA3, "FMA3" }, { CPUF_F16C, "F16C" },
+    { CPUF_AVX512F, "AVX512F" }, { CPUF_AVX512BW, "AVX512BW" } };
+  std::string s;
+  for (auto& n : names)
+    if ((flags & n.flag) == n.flag)
+      s += (s.empty() ? "" : " ") + std::string(n.name);
+  return s;
+}
+
+struct FFTBackend {
+  std::string library;
+  std::string version;
+  bool threads = false;
+};
+
+// the library the filter loads, by the same loader
+static FFTBackend LoadFFTBackend()
+{
+  FFTBackend b;
+#ifdef _WIN32
+  b.library = "libfftw3f-3.dll";
+#else
+  b.library = "libfftw3f_threads.so.3";
+#endif
+  FFTFunctionPointers fft;
+  try
+  {
+    fft.load();
+  }
+  catch (...)
+  {
+    b.version = "not found";
+    return b;
+  }
+  const char* version = (const char*)fft.fftw3_address("fftwf_version");
+  b.version = version ? version : "unknown";
+  b.threads = fft.has_threading();
+  fft.freelib();
+  return b;
+}
+
+//-----------------------------------------------------------------------------
+// JSON
+
+static std::string Quote(const std::string& s)
+{
+  std::string q = "\"";
+  for (char c : s)
+  {
+    if (c == '"' || c == '\\')
+      q += '\\';
+    if ((unsigned char)c >= 0x20)
+      q += c;
+  }
+  return q + "\"";
+}
+
+// just enough of JSON for reading back the result files
+struct Json {
+  enum Type { Null, Bool, Number, String, Array, Object } type = Null;
+  double number = 0;
+  std::string string;
+  std::vector<Json> items;
+  std::vector<std::pair<std::string, Json>> members;
+
+  const Json* get(const char* key) const
+  {
+    for (auto& m : members)
+      if (m.first == key)
+        return &m.second;
+    return nullptr;
+  }
+  double num(const char* key, double def = 0) const
+  {
+    const Json* j = get(key);
+    return j && j->type == Number ? j->number : def;
+  }
+  std::string str(const char* key) const
+  {
+    const Json* j = get(key);
+    return j && j->type == String ? j->string : "";
+  }
+};
+
+class JsonParser {
+  const char* p;
+
+  void ws() { while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') p++; }
+  void expect(char c)
+  {
+    ws();
+    if (*p != c)
+      throw std::runtime_error(std::string("JSON: expected '") + c + "'");
+    p++;
+  }
+  std::string text()
+  {
+    expect('"');
+    std::string s;
+    while (*p && *p != '"')
+    {
+      if (*p == '\\' && p[1])
+        p++;
+      s += *p++;
+    }
+    expect('"');
+    return s;
+  }
+
+public:
+  explicit JsonParser(const char* text) : p(text) {}
+
+  Json value()
+  {
+    Json j;
+    ws();
+    if (*p == '{')
+    {
+      j.type = Json::Object;
+      p++;
+      ws();
+      if (*p == '}')
+      {
+        p++;
+        return j;
+      }
+      do
+      {
+        std::string key = text();
+        expect(':');
+        j.members.emplace_back(key, value());
+        ws();
+      } while (*p == ',' && p++);
+      expect('}');
+    }
+    else if (*p == '[')
+    {
+      j.type = Json::Array;
+      p++;
+      ws();
+      if (*p == ']')
+      {
+        p++;
+        return j;
+      }
+      do
+      {
+        j.items.push_back(value());
+        ws();
+      } while (*p == ',' && p++);
+      expect(']');
+    }
+    else if (*p == '"')
+    {
+      j.type = Json::String;
+      j.string = text();
+    }
+    else if (!strncmp(p, "true", 4) || !strncmp(p, "false", 5))
+    {
+      j.type = Json::Bool;
+      j.number = *p == 't';
+      p += *p == 't' ? 4 : 5;
+    }
+    else if (!strncmp(p, "null", 4))
+      p += 4;
+    else
+    {
+      char* end;
+      j.type = Json::Number;
+      j.number = strtod(p, &end);
+      if (end == p)
+        throw std::runtime_error("JSON: unexpected character");
+      p = end;
+    }
+    return j;
+  }
+};
+
+static bool ReadJsonFile(const char* path, Json& j)
+{
+  FILE* f = fopen(path, "rb");
+  if (f == nullptr)
+  {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string text;
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    text.append(buf, n);
+  fclose(f);
+  try
+  {
+    j = JsonParser(text.c_str()).value();
+  }
+  catch (const std::exception& e)
+  {
+    fprintf(stderr, "%s: %s\n", path, e.what());
+    return false;
+  }
+  if (j.get("records") == nullptr || j.get("records")->type != Json::Array)
+  {
+    fprintf(stderr, "%s: no records\n", path);
+    return false;
+  }
+  return true;
+}
+
+//-----------------------------------------------------------------------------
+// measuring
+
+struct Case {
+  int width, height, bits, bt, bw;
+  float degrid, pfactor;
+
+  std::string key() const
+  {
+    char s[128];
+    snprintf(s, sizeof(s), "%dx%d bits=%d bt=%d bw=%d degrid=%g pfactor=%g", width, height, bits, bt, bw, degrid, pfactor);
+    return s;
+  }
+};
+
+// stage times of the stats frame properties, ns per frame. CPU time summed over the pool and pipeline
+// threads, not a breakdown of the wall clock ns_per_frame: with ncpu>1 or the pipeline their sum is larger.
+static const char* const stage_props[] = { "FFT3D_OverlapTime", "FFT3D_FFTTime", "FFT3D_KernelTime", "FFT3D_DecodeTime" };
+static const char* const stage_names[] = { "overlap", "fft", "kernel", "decode" };
+static const int stage_count = 4;
+
+// the JSON record of one case, an "error" member if it failed
+static std::string RunCase(IScriptEnvironment* env, const Case& c, int frames, int warmup, const std::vector<NamedArg>& extra, bool& failed)
+{
+  std::string head = "{\"case\": " + Quote(c.key());
+  char s[512];
+  snprintf(s, sizeof(s), ", \"width\": %d, \"height\": %d, \"bits\": %d, \"format\": \"%s\", \"bt\": %d, \"bw\": %d, \"bh\": %d, \"ow\": %d, \"oh\": %d, \"degrid\": %g, \"pfactor\": %g",
+    c.width, c.height, c.bits, FormatOfBits(c.bits), c.bt, c.bw, c.bw, c.bw / 3, c.bw / 3, c.degrid, c.pfactor);
+  head += s;
+  failed = false;
+  try
+  {
+    PClip src = avsstub::CreateNoiseClip(env, avsstub::PixelTypeFromName(FormatOfBits(c.bits)), c.width, c.height, warmup + frames, 10.0f, 1234);
+    std::vector<AVSValue> values = { src, c.bt, c.bw, c.bw, c.bw / 3, c.bw / 3, c.degrid, c.pfactor, true };
+    std::vector<const char*> names = { nullptr, "bt", "bw", "bh", "ow", "oh", "degrid", "pfactor", "stats" };
+    for (auto& a : extra)
+    {
+      values.push_back(ArgValue(a.value));
+      names.push_back(a.name.c_str());
+    }
+    PClip clip = env->Invoke("FFT3DFilter", AVSValue(values.data(), (int)values.size()), names.data()).AsClip();
+    for (int n = 0; n < warmup; n++)
+      clip->GetFrame(n, env);
+    double stagems[stage_count] = {};
+    std::string kernels;
+    auto start = std::chrono::steady_clock::now();
+    for (int n = warmup; n < warmup + frames; n++)
+    {
+      PVideoFrame f = clip->GetFrame(n, env);
+      const AVSMap* props = env->getFramePropsRO(f);
+      int err;
+      for (int i = 0; i < stage_count; i++)
+        stagems[i] += env->propGetFloat(props, stage_props[i], 0, &err);
+      const char* k = env->propGetData(props, "FFT3D_Kernels", 0, &err);
+      if (!err)
+        kernels = k;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string rec = head + ", \"kernels\": " + Quote(kernels);
+    snprintf(s, sizeof(s), ", \"frames\": %d, \"fps\": %.3f, \"ns_per_frame\": %.0f, \"stage_ns\": {", frames, frames / sec, sec * 1e9 / frames);
+    rec += s;
+    for (int i = 0; i < stage_count; i++)
+    {
+      snprintf(s, sizeof(s), "%s\"%s\": %.0f", i ? ", " : "", stage_names[i], stagems[i] * 1e6 / frames);
+      rec += s;
+    }
+    rec += "}}";
+    fprintf(stderr, "%-50s %9.2f frames/s  %s\n", c.key().c_str(), frames / sec, kernels.c_str());
+    return rec;
+  }
+  catch (const AvisynthError& e)
+  {
+    fprintf(stderr, "%-50s error: %s\n", c.key().c_str(), e.msg);
+    failed = true;
+    return head + ", \"error\": " + Quote(e.msg) + "}";
+  }
+}
+
+//-----------------------------------------------------------------------------
+// comparison
+
+// frames/s of every case of cur against base; returns the number of regressions
+static int Compare(const Json& base, const Json& cur, double threshold)
+{
+  if (base.str("cpu_model") != cur.str("cpu_model"))
+    fprintf(stderr, "warning: baseline CPU is '%s', this one '%s'\n", base.str("cpu_model").c_str(), cur.str("cpu_model").c_str());
+  if (base.str("fft_version") != cur.str("fft_version"))
+    fprintf(stderr, "warning: baseline FFT backend is '%s', this one '%s'\n", base.str("fft_version").c_str(), cur.str("fft_version").c_str());
+
+  std::map<std::string, const Json*> baserecs;
+  for (auto& r : base.get("records")->items)
+    baserecs[r.str("case")] = &r;
+
+  int regressions = 0, compared = 0;
+  fprintf(stderr, "%-50s %10s %10s %8s\n", "case", "base fps", "fps", "change");
+  for (auto& r : cur.get("records")->items)
+  {
+    auto b = baserecs.find(r.str("case"));
+    if (b == baserecs.end() || b->second->num("fps") <= 0 || r.num("fps") <= 0)
+      continue; // not in the baseline, or failed in one of them
+    double change = (r.num("fps") / b->second->num("fps") - 1) * 100;
+    bool slow = change < -threshold;
+    fprintf(stderr, "%-50s %10.2f %10.2f %+7.1f%%%s", r.str("case").c_str(), b->second->num("fps"), r.num("fps"), change, slow ? "  REGRESSION" : "");
+    if (b->second->str("kernels") != r.str("kernels"))
+      fprintf(stderr, "  kernels were %s", b->second->str("kernels").c_str());
+    fprintf(stderr, "\n");
+    regressions += slow;
+    compared++;
+  }
+  fprintf(stderr, "%d cases compared, %d regressions above %g%%\n", compared, regressions, threshold);
+  return regressions;
+}
+
+int main(int argc, char** argv)
+{
+  int frames = 10, warmup = 3, cpuflags = -1;
+  double threshold = 5;
+  const char *jsonpath = nullptr, *baselinepath = nullptr, *inputpath = nullptr;
+  std::vector<std::pair<int, int>> sizes = { { 1920, 1080 } };
+  std::vector<float> bitss = { 8, 16 }, bts = { 0, 1, 2, 3 }, bws = { 32, 48 }, degrids = { 0, 1 }, pfactors = { 0, 0.1f };
+  std::vector<NamedArg> extra;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* a = argv[i];
+    const char* v = i + 1 < argc ? argv[i + 1] : nullptr;
+    bool takes = v != nullptr && !strncmp(a, "--", 2);
+    if (takes && !strcmp(a, "--sizes"))
+    {
+      sizes.clear();
+      for (const char* s = v; *s; )
+      {
+        int w, h, len = 0;
+        if (sscanf(s, "%dx%d%n", &w, &h, &len) != 2 || w <= 0 || h <= 0)
+        {
+          fprintf(stderr, "bad --sizes %s\n", v);
+          return 2;
+        }
+        sizes.push_back({ w, h });
+        s += len;
+        if (*s == ',')
+          s++;
+      }
+    }
+    else if (takes && !strcmp(a, "--bits")) bitss = ParseList(v);
+    else if (takes && !strcmp(a, "--bt")) bts = ParseList(v);
+    else if (takes && !strcmp(a, "--bw")) bws = ParseList(v);
+    else if (takes && !strcmp(a, "--degrid")) degrids = ParseList(v);
+    else if (takes && !strcmp(a, "--pfactor")) pfactors = ParseList(v);
+    else if (takes && !strcmp(a, "--frames")) frames = atoi(v);
+    else if (takes && !strcmp(a, "--warmup")) warmup = atoi(v);
+    else if (takes && !strcmp(a, "--cpu")) cpuflags = (int)strtol(v, nullptr, 0);
+    else if (takes && !strcmp(a, "--json")) jsonpath = v;
+    else if (takes && !strcmp(a, "--baseline")) baselinepath = v;
+    else if (takes && !strcmp(a, "--threshold")) threshold = atof(v);
+    else if (takes && !strcmp(a, "--input")) inputpath = v;
+    else if (strchr(a, '=') != nullptr && strncmp(a, "--", 2))
+    {
+      const char* eq = strchr(a, '=');
+      extra.push_back({ std::string(a, eq - a), std::string(eq + 1) });
+      continue;
+    }
+    else
+    {
+      fprintf(stderr, "unknown option %s, see the head of fft3dfilter_perfjson.cpp\n", a);
+      return 2;
+    }
+    i++;
+  }
+  for (float b : bitss)
+    if (FormatOfBits((int)b) == nullptr)
+    {
+      fprintf(stderr, "bad --bits %g\n", b);
+      return 2;
+    }
+  if (frames <= 0 || warmup < 0 || (inputpath != nullptr && baselinepath == nullptr))
+  {
+    fprintf(stderr, "bad frames or warmup, or --input without --baseline\n");
+    return 2;
+  }
+
+  Json base;
+  if (baselinepath != nullptr && !ReadJsonFile(baselinepath, base))
+    return 2;
+  if (inputpath != nullptr)
+  {
+    Json cur;
+    if (!ReadJsonFile(inputpath, cur))
+      return 2;
+    return Compare(base, cur, threshold) ? 1 : 0;
+  }
+
+  IScriptEnvironment* env = avsstub::CreateEnvironment(cpuflags);
+  AvisynthPluginInit3(env, env->GetAVSLinkage());
+  int flags = env->GetCPUFlags();
+  FFTBackend fft = LoadFFTBackend();
+  bool measure = true;
+  for (auto& a : extra)
+    if (a.name == "measure")
+      measure = a.value == "true";
+  std::string extraargs;
+  for (auto& a : extra)
+    extraargs += (extraargs.empty() ? "" : " ") + a.name + "=" + a.value;
+
+  char s[256];
+  time_t now = time(nullptr);
+  strftime(s, sizeof(s), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  std::string doc = "{\n  \"tool\": \"fft3dfilter_perfjson\",\n  \"date\": " + Quote(s) + ",\n  \"cpu_model\": " + Quote(CPUModel());
+  snprintf(s, sizeof(s), ",\n  \"cpu_flags\": \"0x%x\"", flags);
+  doc += s;
+  doc += ",\n  \"cpu_flag_names\": " + Quote(CPUFlagNames(flags));
+  doc += ",\n  \"fft_library\": " + Quote(fft.library) + ",\n  \"fft_version\": " + Quote(fft.version);
+  doc += std::string(",\n  \"fft_threads\": ") + (fft.threads ? "true" : "false");
+  doc += std::string(",\n  \"fft_planner\": ") + (measure ? "\"FFTW_MEASURE\"" : "\"FFTW_ESTIMATE\"");
+  doc += ",\n  \"args\": " + Quote(extraargs);
+  snprintf(s, sizeof(s), ",\n  \"frames\": %d,\n  \"warmup\": %d,\n  \"records\": [", frames, warmup);
+  doc += s;
+
+  fprintf(stderr, "%s, CPU flags %s, %s\n", CPUModel().c_str(), CPUFlagNames(flags).c_str(), fft.version.c_str());
+  int failed = 0, count = 0;
+  for (auto& size : sizes)
+    for (float bits : bitss)
+      for (float bt : bts)
+        for (float bw : bws)
+          for (float degrid : degrids)
+            for (float pfactor : pfactors)
+            {
+              Case c = { size.first, size.second, (int)bits, (int)bt, (int)bw, degrid, pfactor };
+              bool casefailed;
+              doc += (count++ ? ",\n    " : "\n    ") + RunCase(env, c, frames, warmup, extra, casefailed);
+              failed += casefailed;
+            }
+  doc += "\n  ]\n}\n";
+  avsstub::DeleteEnvironment(env);
+
+  FILE* out = jsonpath ? fopen(jsonpath, "w") : stdout;
+  if (out == nullptr)
+  {
+    fprintf(stderr, "cannot write %s\n", jsonpath);
+    return 2;
+  }
+  fputs(doc.c_str(), out);
+  if (jsonpath)
+    fclose(out);
+
+  int regressions = 0;
+  if (baselinepath != nullptr)
+  {
+    Json cur;
+    cur = JsonParser(doc.c_str()).value();
+    regressions = Compare(base, cur, threshold);
+  }
+  return failed || regressions ? 1 : 0;
+}
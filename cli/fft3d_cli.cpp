@@ -0,0 +1,402 @@
+// fft3d-cli: YUV4MPEG2 streaming denoiser on the FFT3DFilter engine (C API), no AviSynth needed.
+//
+// Reads a Y4M stream from a file or stdin, filters it with the parameters of the
+// AviSynth function FFT3DFilter and writes the Y4M stream to stdout, e.g.
+//
+//   ffmpeg -i in.mkv -f yuv4mpegpipe - | fft3d-cli sigma=3 bt=3 plane=4 ncpu=2 | x264 --demuxer y4m -o out.264 -
+//
+// Pipeline: a reader thread parses the frames, every filtered plane has its own
+// thread and engine, the main thread writes the frames in order as soon as all of
+// their planes are done. Frames in flight are limited by --queue (at least the
+// temporal window of the filter), so memory use does not grow with the stream.
+//
+// usage: fft3d-cli [options] [name=value ...] [input.y4m | -]
+//   -o FILE          output file (stdout)
+//   --queue N        frames in flight between reader and writer (8)
+//   --cpu FLAGS      CPU flags for the filter, e.g. 0 for the C code (detected)
+//   -q               no summary on stderr
+//   name=value       FFT3DFilter arguments: sigma, beta, plane, bw, bh, bt, ow, oh, kratio, sharpen,
+//                    scutoff, svr, smin, smax, measure, interlaced, wintype, pframe, px, py, pcutoff,
+//                    pfactor, sigma2, sigma3, sigma4, degrid, dehalo, hr, ht, ncpu, numa, halfcache,
+//                    hugepages, membudget, removemean
+// At the end frames, time and frames/s go to stderr. FFTW (libfftw3f) is loaded at run time.
+
+#include "fft3d_capi.h"
+#include "y4m.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+struct ParamDef {
+  const char *name;
+  char type; // f: float, i: int, b: bool (stored as int)
+  size_t offset;
+};
+
+#define PARAM(type, field) { #field, type, offsetof(fft3d_params, field) }
+static const ParamDef paramdefs[] = {
+  PARAM('f', sigma), PARAM('f', beta), PARAM('i', bw), PARAM('i', bh), PARAM('i', bt), PARAM('i', ow), PARAM('i', oh),
+  PARAM('f', kratio), PARAM('f', sharpen), PARAM('f', scutoff), PARAM('f', svr), PARAM('f', smin), PARAM('f', smax),
+  PARAM('b', measure), PARAM('b', interlaced), PARAM('i', wintype), PARAM('i', pframe), PARAM('i', px), PARAM('i', py),
+  PARAM('f', pcutoff), PARAM('f', pfactor), PARAM('f', sigma2), PARAM('f', sigma3), PARAM('f', sigma4),
+  PARAM('f', degrid), PARAM('f', dehalo), PARAM('f', hr), PARAM('f', ht), PARAM('i', ncpu), PARAM('i', numa),
+  PARAM('b', halfcache), PARAM('i', hugepages), PARAM('i', membudget), PARAM('b', removemean),
+};
+#undef PARAM
+
+static bool SetParam(fft3d_params &p, const char *name, const char *value)
+{
+  for (const ParamDef &d : paramdefs)
+  {
+    if (strcmp(d.name, name))
+      continue;
+    char *field = (char *)&p + d.offset;
+    if (d.type == 'f')
+      *(float *)field = (float)atof(value);
+    else if (d.type == 'b')
+      *(int *)field = !strcmp(value, "true") || atoi(value) != 0;
+    else
+      *(int *)field = atoi(value);
+    return true;
+  }
+  return false;
+}
+
+// Frame of the stream: the planes as read, and the filtered ones
+struct Frame {
+  std::string header; // FRAME line with its parameters
+  std::vector<uint8_t> in[3];
+  std::vector<uint8_t> out[3];
+
+  std::mutex m;
+  std::condition_variable cv;
+  int remaining = 0; // planes still being filtered
+
+  void PlaneDone()
+  {
+    std::lock_guard<std::mutex> lock(m);
+    if (--remaining == 0)
+      cv.notify_all();
+  }
+};
+
+// First in first out between two threads. A bounded queue blocks push while it is full.
+// close() wakes everybody, then pop returns false when empty and push drops.
+template<typename T>
+class FrameQueue {
+  std::deque<T> items;
+  size_t capacity;
+  bool closed = false;
+  std::mutex m;
+  std::condition_variable cv;
+
+public:
+  explicit FrameQueue(size_t _capacity = 0) : capacity(_capacity) {}
+
+  void push(T item)
+  {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return closed || capacity == 0 || items.size() < capacity; });
+    if (closed)
+      return;
+    items.push_back(std::move(item));
+    cv.notify_all();
+  }
+
+  bool pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(m);
+    cv.wait(lock, [&] { return closed || !items.empty(); });
+    if (items.empty())
+      return false;
+    item = std::move(items.front());
+    items.pop_front();
+    cv.notify_all();
+    return true;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(m);
+    closed = true;
+    cv.notify_all();
+  }
+};
+
+typedef std::shared_ptr<Frame> FramePtr;
+
+// the first error stops the pipeline
+static std::mutex errormutex;
+static std::string errormsg;
+static std::atomic<bool> failed(false);
+
+static void Fail(const std::string &msg)
+{
+  std::lock_guard<std::mutex> lock(errormutex);
+  if (!failed)
+    errormsg = msg;
+  failed = true;
+}
+
+static bool ReadLine(FILE *f, std::string &line)
+{
+  line.clear();
+  int c;
+  while ((c = getc(f)) != EOF && c != '\n')
+    line.push_back((char)c);
+  return c != EOF;
+}
+
+// Filters plane p of every frame. A nullptr frame ends the stream.
+// Frames are delivered by the engine in order, so the ones waiting for their output are a queue too.
+static void PlaneWorker(fft3d_handle *h, int p, const Y4MFormat &format, FrameQueue<FramePtr> &queue)
+{
+  std::deque<FramePtr> waiting;
+  ptrdiff_t rowsize = (ptrdiff_t)format.PlaneWidth(p) * format.BytesPerSample();
+  auto pull = [&]() {
+    int res = FFT3D_OK;
+    while (!waiting.empty() && (res = fft3d_pull_plane(h, waiting.front()->out[p].data(), rowsize)) == FFT3D_OK)
+    {
+      waiting.front()->PlaneDone();
+      waiting.pop_front();
+    }
+    if (!waiting.empty() && res == FFT3D_ERROR)
+    {
+      Fail(fft3d_last_error(h));
+      return false;
+    }
+    return true;
+  };
+
+  FramePtr frame;
+  while (queue.pop(frame) && frame)
+  {
+    frame->out[p].resize(format.PlaneBytes(p));
+    if (fft3d_push_plane(h, frame->in[p].data(), rowsize) != FFT3D_OK)
+    {
+      Fail(fft3d_last_error(h));
+      return;
+    }
+    waiting.push_back(frame);
+    if (!pull())
+      return;
+  }
+  if (failed)
+    return;
+  fft3d_finish(h);
+  pull();
+}
+
+int main(int argc, char **argv)
+{
+  const char *inname = nullptr, *outname = nullptr;
+  int queuesize = 8, cpuflags = -1, plane = -1;
+  bool quiet = false;
+  fft3d_params params;
+  fft3d_default_params(&params);
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char *a = argv[i];
+    const char *v = i + 1 < argc ? argv[i + 1] : nullptr;
+    const char *eq = strchr(a, '=');
+    if (v && !strcmp(a, "-o")) { outname = v; i++; }
+    else if (v && !strcmp(a, "--queue")) { queuesize = atoi(v); i++; }
+    else if (v && !strcmp(a, "--cpu")) { cpuflags = (int)strtol(v, nullptr, 0); i++; }
+    else if (!strcmp(a, "-q")) quiet = true;
+    else if (eq && a[0] != '-')
+    {
+      std::string name(a, eq - a);
+      if (name == "plane")
+        plane = atoi(eq + 1);
+      else if (name == "pshow" || !SetParam(params, name.c_str(), eq + 1))
+      {
+        fprintf(stderr, "fft3d-cli: unknown parameter %s\n", name.c_str());
+        return 2;
+      }
+    }
+    else if (!inname && (a[0] != '-' || !strcmp(a, "-")))
+      inname = a;
+    else
+    {
+      fprintf(stderr, "usage: fft3d-cli [-o FILE] [--queue N] [--cpu FLAGS] [-q] [name=value ...] [input.y4m | -]\n");
+      return 2;
+    }
+  }
+
+#ifdef _WIN32
+  _setmode(_fileno(stdin), _O_BINARY);
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  FILE *in = (!inname || !strcmp(inname, "-")) ? stdin : fopen(inname, "rb");
+  FILE *out = outname ? fopen(outname, "wb") : stdout;
+  if (!in || !out)
+  {
+    fprintf(stderr, "fft3d-cli: cannot open %s\n", !in ? inname : outname);
+    return 1;
+  }
+  setvbuf(in, nullptr, _IOFBF, 1 << 20);
+  setvbuf(out, nullptr, _IOFBF, 1 << 20);
+
+  std::string header, error;
+  Y4MFormat format;
+  if (!ReadLine(in, header) || !ParseY4MHeader(header, format, error))
+  {
+    fprintf(stderr, "fft3d-cli: %s\n", error.empty() ? "empty input" : error.c_str());
+    return 1;
+  }
+
+  // planes as FFT3DFilter's plane: 0 Y, 1 U, 2 V, 3 U and V, 4 all; only Y for mono
+  if (plane == -1)
+    plane = 0;
+  if (plane < 0 || plane > 4)
+  {
+    fprintf(stderr, "fft3d-cli: plane must be from 0 to 4!\n");
+    return 2;
+  }
+  bool filtered[3] = { plane == 0 || plane == 4, plane == 1 || plane >= 3, plane == 2 || plane >= 3 };
+  if (format.planes == 1)
+    filtered[1] = filtered[2] = false;
+
+  // membudget is for the whole filter, each plane gets a part by its size
+  int budget = params.membudget, planebudget[3] = { budget, budget, budget };
+  if (plane == 3)
+    planebudget[1] = planebudget[2] = budget / 2;
+  else if (plane == 4 && format.planes == 3)
+  {
+    double chromashare = 1.0 / (1 << (format.xshift + format.yshift));
+    planebudget[0] = (int)(budget / (1 + 2 * chromashare));
+    planebudget[1] = planebudget[2] = (int)(budget * chromashare / (1 + 2 * chromashare));
+  }
+
+  fft3d_handle *handles[3] = { nullptr, nullptr, nullptr };
+  for (int p = 0; p < 3; p++)
+  {
+    if (!filtered[p])
+      continue;
+    fft3d_params pp = params;
+    pp.membudget = planebudget[p];
+    handles[p] = fft3d_create(&pp, format.PlaneWidth(p), format.PlaneHeight(p), format.bits, p != 0, cpuflags);
+    if (!handles[p])
+    {
+      fprintf(stderr, "fft3d-cli: %s\n", fft3d_last_error(nullptr));
+      return 1;
+    }
+  }
+
+  // the frames of the temporal window and the noise pattern frame must fit in the queue
+  int window = params.bt >= 2 ? (params.bt - 1) / 2 + 2 : 2;
+  if (params.pfactor != 0)
+    window = std::max(window, params.pframe + 2);
+  FrameQueue<FramePtr> writequeue(std::max(queuesize, window));
+  FrameQueue<FramePtr> planequeues[3];
+
+  std::thread workers[3];
+  for (int p = 0; p < 3; p++)
+    if (handles[p])
+      workers[p] = std::thread(PlaneWorker, handles[p], p, std::cref(format), std::ref(planequeues[p]));
+
+  std::thread reader([&]() {
+    std::string line;
+    while (!failed && ReadLine(in, line))
+    {
+      if (line.compare(0, 5, "FRAME") != 0)
+      {
+        Fail("bad YUV4MPEG2 frame header");
+        break;
+      }
+      FramePtr frame = std::make_shared<Frame>();
+      frame->header = line;
+      bool complete = true;
+      for (int p = 0; p < format.planes && complete; p++)
+      {
+        frame->in[p].resize(format.PlaneBytes(p));
+        complete = fread(frame->in[p].data(), 1, frame->in[p].size(), in) == frame->in[p].size();
+        if (handles[p])
+          frame->remaining++;
+      }
+      if (!complete)
+      {
+        Fail("truncated frame at the end of the input");
+        break;
+      }
+      writequeue.push(frame);
+      for (int p = 0; p < 3; p++)
+        if (handles[p])
+          planequeues[p].push(frame);
+    }
+    writequeue.push(nullptr);
+    for (int p = 0; p < 3; p++)
+      planequeues[p].push(nullptr);
+  });
+
+  auto start = std::chrono::steady_clock::now();
+  long long frames = 0;
+  fprintf(out, "%s\n", header.c_str());
+  FramePtr frame;
+  while (writequeue.pop(frame) && frame)
+  {
+    {
+      // failed is not signalled on the frame, checked every 100 ms
+      std::unique_lock<std::mutex> lock(frame->m);
+      while (!frame->cv.wait_for(lock, std::chrono::milliseconds(100), [&] { return frame->remaining == 0 || failed; }))
+        ;
+    }
+    if (failed)
+      break;
+    fprintf(out, "%s\n", frame->header.c_str());
+    for (int p = 0; p < format.planes; p++)
+    {
+      const std::vector<uint8_t> &plane = handles[p] ? frame->out[p] : frame->in[p];
+      fwrite(plane.data(), 1, plane.size(), out);
+    }
+    if (ferror(out))
+    {
+      Fail("write error");
+      break;
+    }
+    frames++;
+  }
+
+  // on errors the queues are closed so that blocked threads return
+  if (failed)
+  {
+    writequeue.close();
+    for (auto &q : planequeues)
+      q.close();
+  }
+  reader.join();
+  for (auto &w : workers)
+    if (w.joinable())
+      w.join();
+  for (fft3d_handle *h : handles)
+    fft3d_destroy(h);
+  fflush(out);
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  if (failed)
+  {
+    fprintf(stderr, "fft3d-cli: %s\n", errormsg.c_str());
+    return 1;
+  }
+  if (!quiet)
+    fprintf(stderr, "fft3d-cli: %dx%d %d bit, %lld frames in %.3f s, %.2f frames/s\n", format.width, format.height, format.bits,
+      frames, sec, sec > 0 ? frames / sec : 0.0);
+  return 0;
+}
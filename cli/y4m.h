@@ -0,0 +1,93 @@
+#ifndef __FFT3D_Y4M_H__
+#define __FFT3D_Y4M_H__
+
+// YUV4MPEG2 stream header, as written by ffmpeg -f yuv4mpegpipe and x264/x265.
+// "YUV4MPEG2 W<width> H<height> [F.. I.. A.. X..] [C<colorspace>]\n", then per frame
+// "FRAME[ params]\n" followed by the planes Y, U, V (mono: Y only), rows without padding,
+// samples of more than 8 bits as little endian 16 bit words.
+// Colorspaces: 420jpeg, 420mpeg2, 420paldv, 420, 422, 444, mono, with p9, p10, p12, p14, p16
+// for high bit depth (420p10, mono16, ...). The default is 420jpeg.
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string>
+
+struct Y4MFormat {
+  int width = 0, height = 0;
+  int bits = 8; // per sample
+  int xshift = 1, yshift = 1; // chroma subsampling
+  int planes = 3; // 1: mono
+
+  int PlaneWidth(int p) const { return p == 0 ? width : (width + (1 << xshift) - 1) >> xshift; }
+  int PlaneHeight(int p) const { return p == 0 ? height : (height + (1 << yshift) - 1) >> yshift; }
+  int BytesPerSample() const { return bits > 8 ? 2 : 1; }
+  size_t PlaneBytes(int p) const { return (size_t)PlaneWidth(p) * BytesPerSample() * PlaneHeight(p); }
+  size_t FrameBytes() const
+  {
+    size_t n = 0;
+    for (int p = 0; p < planes; p++)
+      n += PlaneBytes(p);
+    return n;
+  }
+};
+
+// header line without the '\n'; false with error set when it is not supported
+static inline bool ParseY4MHeader(const std::string &line, Y4MFormat &f, std::string &error)
+{
+  if (line.compare(0, 10, "YUV4MPEG2 ") != 0)
+  {
+    error = "not a YUV4MPEG2 stream";
+    return false;
+  }
+  std::string colorspace = "420jpeg";
+  size_t pos = 10;
+  while (pos < line.size())
+  {
+    size_t end = line.find(' ', pos);
+    if (end == std::string::npos)
+      end = line.size();
+    std::string token = line.substr(pos, end - pos);
+    if (!token.empty())
+    {
+      if (token[0] == 'W') f.width = atoi(token.c_str() + 1);
+      else if (token[0] == 'H') f.height = atoi(token.c_str() + 1);
+      else if (token[0] == 'C') colorspace = token.substr(1);
+    }
+    pos = end + 1;
+  }
+  if (f.width <= 0 || f.height <= 0)
+  {
+    error = "bad frame size in the YUV4MPEG2 header";
+    return false;
+  }
+
+  std::string layout = colorspace.substr(0, colorspace.compare(0, 4, "mono") == 0 ? 4 : 3);
+  std::string depth = colorspace.substr(layout.size());
+  if (layout == "420") { f.xshift = 1; f.yshift = 1; }
+  else if (layout == "422") { f.xshift = 1; f.yshift = 0; }
+  else if (layout == "444") { f.xshift = 0; f.yshift = 0; }
+  else if (layout == "mono") { f.xshift = 0; f.yshift = 0; f.planes = 1; }
+  else
+  {
+    error = "unsupported YUV4MPEG2 colorspace C" + colorspace;
+    return false;
+  }
+  f.bits = 8;
+  if (!depth.empty() && depth[0] == 'p')
+    f.bits = atoi(depth.c_str() + 1);
+  else if (layout == "mono" && !depth.empty() && depth[0] >= '0' && depth[0] <= '9')
+    f.bits = atoi(depth.c_str()); // mono16
+  else if (!depth.empty() && depth != "jpeg" && depth != "mpeg2" && depth != "paldv")
+  {
+    error = "unsupported YUV4MPEG2 colorspace C" + colorspace;
+    return false;
+  }
+  if (f.bits < 8 || f.bits > 16)
+  {
+    error = "unsupported YUV4MPEG2 bit depth C" + colorspace;
+    return false;
+  }
+  return true;
+}
+
+#endif // __FFT3D_Y4M_H__
@@ -22,3 +22,11 @@ IF( MSVC_IDE )
     # Ninja, unfortunately, seems to have some issues with using rc.exe
     LIST(APPEND FFT3DFilter_Sources "FFT3DFilter.rc")
 ENDIF()
+
+# The AviSynth filters; the other sources are the host independent engine, its kernels and C API
+set(FFT3DFilter_Avs_Sources FFT3DFilter.cpp info.cpp tune.cpp)
+set(FFT3DFilter_Engine_Sources ${FFT3DFilter_Sources})
+list(FILTER FFT3DFilter_Engine_Sources INCLUDE REGEX "\\.cpp$")
+list(REMOVE_ITEM FFT3DFilter_Engine_Sources ${FFT3DFilter_Avs_Sources})
+set(FFT3DFilter_Other_Sources ${FFT3DFilter_Sources})
+list(FILTER FFT3DFilter_Other_Sources EXCLUDE REGEX "\\.cpp$")
@@ -0,0 +1,208 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+// Places many buffers of known size into one aligned memory block.
+// The buffers are reserved first, then allocate() makes the block and sets all reserved
+// pointers into it. The block can be released and allocated again (e.g. on another thread),
+// the pointers are set again to the same offsets.
+// The block can be backed by huge pages, see set_hugepages.
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#ifdef _WIN32
+#include <malloc.h>
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+class Arena {
+  struct Request {
+    void** ptr;
+    size_t offset;
+  };
+  std::vector<Request> requests;
+  size_t total;
+  void* slab;
+  int hugepages; // requested mode
+  size_t mapped; // >0: slab is a mapping of this size (not from the heap)
+  bool explicit_huge; // mapping is of MAP_HUGETLB or Windows large pages
+  size_t hugebytes; // of the block in huge pages, counted by allocate()
+
+  static const size_t hugepage_size = 2 * 1024 * 1024;
+
+  void* map_huge(size_t bytes)
+  {
+#ifdef _WIN32
+    if (hugepages != 2) // no transparent huge pages on Windows
+      return nullptr;
+    size_t large = GetLargePageMinimum();
+    if (large == 0)
+      return nullptr;
+    bytes = (bytes + large - 1) / large * large;
+    // needs the "Lock pages in memory" privilege, fails without it
+    void* p = VirtualAlloc(NULL, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (p != nullptr)
+    {
+      mapped = bytes;
+      explicit_huge = true;
+    }
+    return p;
+#elif defined(__linux__)
+    bytes = (bytes + hugepage_size - 1) / hugepage_size * hugepage_size;
+#ifdef MAP_HUGETLB
+    if (hugepages == 2) // from the reserved pool (vm.nr_hugepages), if there are enough
+    {
+      void* p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED)
+      {
+        mapped = bytes;
+        explicit_huge = true;
+        return p;
+      }
+    }
+#endif
+    // transparent huge pages: a 2 MB aligned mapping, the unaligned ends are cut off
+    char* p = (char*)mmap(NULL, bytes + hugepage_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == (char*)MAP_FAILED)
+      return nullptr;
+    size_t head = (hugepage_size - (uintptr_t)p % hugepage_size) % hugepage_size;
+    if (head > 0)
+      munmap(p, head);
+    if (hugepage_size - head > 0)
+      munmap(p + head + bytes, hugepage_size - head);
+    p += head;
+#ifdef MADV_HUGEPAGE
+    madvise(p, bytes, MADV_HUGEPAGE); // may fail if THP is disabled, then it is a normal mapping
+#endif
+    mapped = bytes;
+    return p;
+#else
+    (void)bytes;
+    return nullptr;
+#endif
+  }
+
+  // AnonHugePages of the mappings overlapping the block in /proc/self/smaps, each at most
+  // its overlap with the block: the kernel may have merged the block with a neighbour mapping
+  size_t count_hugepages() const
+  {
+    size_t bytes = 0;
+#ifdef __linux__
+    FILE* f = fopen("/proc/self/smaps", "r");
+    if (f == NULL)
+      return 0;
+    uintptr_t from = (uintptr_t)slab, to = from + mapped;
+    size_t overlap = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f))
+    {
+      unsigned long long start, end, kb;
+      if (sscanf(line, "%llx-%llx ", &start, &end) == 2)
+        overlap = start < to && end > from ? (size_t)(std::min<uintptr_t>(end, to) - std::max<uintptr_t>(start, from)) : 0;
+      else if (overlap > 0 && sscanf(line, "AnonHugePages: %llu kB", &kb) == 1)
+        bytes += std::min((size_t)kb * 1024, overlap);
+    }
+    fclose(f);
+#endif
+    return bytes;
+  }
+
+public:
+  static const size_t alignment = 64; // cache line, enough for any SIMD load and for fftw
+
+  Arena() : total(0), slab(nullptr), hugepages(0), mapped(0), explicit_huge(false), hugebytes(0) {}
+  ~Arena() { release(); }
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // ptr will point to count elements of T after allocate()
+  template<typename T>
+  void reserve(T*& ptr, size_t count)
+  {
+    requests.push_back({ reinterpret_cast<void**>(&ptr), total });
+    total += (count * sizeof(T) + alignment - 1) / alignment * alignment;
+  }
+
+  // 0: heap, 1: transparent huge pages (Linux, heap on Windows), 2: explicit huge pages
+  // (Linux MAP_HUGETLB, Windows large pages), falling back to 1 and then to the heap.
+  // For the next allocate().
+  void set_hugepages(int mode) { hugepages = mode; }
+
+  // false if out of memory
+  bool allocate()
+  {
+    release();
+    size_t bytes = total > 0 ? total : alignment;
+    if (hugepages > 0)
+      slab = map_huge(bytes);
+    if (slab == nullptr)
+    {
+#ifdef _WIN32
+      slab = _aligned_malloc(bytes, alignment);
+#else
+      if (posix_memalign(&slab, alignment, bytes) != 0)
+        slab = nullptr;
+#endif
+    }
+    if (slab == nullptr)
+      return false;
+    for (auto& r : requests)
+      *r.ptr = static_cast<char*>(slab) + r.offset;
+    if (explicit_huge)
+      hugebytes = mapped;
+    else if (mapped > 0)
+    {
+      // transparent huge pages: touch the block now, so that the count is of all of it
+      memset(slab, 0, mapped);
+      hugebytes = count_hugepages();
+    }
+    return true;
+  }
+
+  void release()
+  {
+    if (slab == nullptr)
+      return;
+    if (mapped > 0)
+    {
+#ifdef _WIN32
+      VirtualFree(slab, 0, MEM_RELEASE);
+#elif defined(__linux__)
+      munmap(slab, mapped);
+#endif
+    }
+    else
+    {
+#ifdef _WIN32
+      _aligned_free(slab);
+#else
+      free(slab);
+#endif
+    }
+    slab = nullptr;
+    mapped = 0;
+    explicit_huge = false;
+    hugebytes = 0;
+  }
+
+  void zero()
+  {
+    if (slab != nullptr)
+      memset(slab, 0, total);
+  }
+
+  bool allocated() const { return slab != nullptr; }
+  size_t size() const { return total; }
+
+  // bytes of the block backed by huge pages, as counted when it was allocated (statistics)
+  size_t hugepage_bytes() const { return hugebytes; }
+};
+
+#endif // __ARENA_H__
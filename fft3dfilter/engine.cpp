@@ -0,0 +1,3121 @@
+//
+//	FFT3DFilter plugin for Avisynth 2.6 and Avisynth+ - 3D Frequency Domain filter
+//  host independent filtering engine - v2.11
+//	Copyright(C)2004-2006 A.G.Balakhnin aka Fizick, bag@hotmail.ru, http://avisynth.org.ru
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as published by
+//	the Free Software Foundation.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program; if not, write to the Free Software
+//	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//-----------------------------------------------------------------------------------------
+// The processing of FFT3DFilter, moved out of FFT3DFilter.cpp in v2.11: constructor setup
+// (windows, plans, patterns), overlapped block coding, spectrum cache, pipeline and the
+// GetFrame pipeline of one plane. No AviSynth headers here, see engine.h.
+
+#include <avs/config.h> // x64
+#include <avs/cpuid.h>
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#endif
+#include "engine.h"
+#include "math.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <emmintrin.h>
+#include <mmintrin.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// debug output, as in avisynth.h
+#ifdef _MSC_VER
+#include <crtdbg.h>
+#else
+#define _RPT1(a,b,c) ((void)0)
+#define _RPT2(a,b,c,d) ((void)0)
+#define _RPT3(a,b,c,d,e) ((void)0)
+#define _RPT5(a,b,c,d,e,f,g) ((void)0)
+#endif
+
+
+// FFTW is not thread-safe, need to guard around its functions (except fftw_execute).
+// http://www.fftw.org/fftw3_doc/Thread-safety.html#Thread-safety
+static std::mutex fftw_mutex; // defined as static
+
+// declarations of filtering functions:
+#ifndef X86_64
+// 3DNow
+void ApplyWiener3D4_3DNow(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+#endif
+void ApplyKalman_SSE2_simd(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float covarNoiseNormed, float kratio2);
+// SSE
+void ApplyWiener3D2_SSE_simd(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyWiener3D4_SSE_simd(fftwf_complex* outcur, fftwf_complex* outprev2, fftwf_complex* outprev, fftwf_complex* outnext, fftwf_complex* outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D2_SSE(fftwf_complex *outcur, fftwf_complex *outprev, int outwidth, int outpitch, int bh, int howmanyblocks, float * pattern3d, float beta);
+void ApplyWiener3D3_SSE(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D3_SSE(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta);
+void Sharpen_SSE(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen);
+// C
+void ApplyWiener2D_C(fftwf_complex *out, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float dehalo, float *wdehalo, float ht2n);
+void ApplyPattern2D_C(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float pfactor, float *pattern2d0, float beta);
+void ApplyWiener3D2_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D2_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta);
+void ApplyWiener3D3_C(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D3_C(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta);
+void ApplyWiener3D4_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D4_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta);
+void ApplyWiener3D5_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta);
+void ApplyPattern3D5_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta);
+void ApplyKalmanPattern_C(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float *covarNoiseNormed, float kratio2);
+void ApplyKalman_C(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float covarNoiseNormed, float kratio2);
+void Sharpen_C(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float dehalo, float *wdehalo, float ht2n);
+// degrid_C
+void ApplyWiener2D_degrid_C(fftwf_complex *out, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float degrid, fftwf_complex *gridsample, float dehalo, float *wdehalo, float ht2n);
+void ApplyWiener3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyWiener3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyWiener3D4_degrid_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyWiener3D5_degrid_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void Sharpen_degrid_C(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float degrid, fftwf_complex *gridsample, float dehalo, float *wdehalo, float ht2n);
+void ApplyPattern2D_degrid_C(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float pfactor, float *pattern2d0, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D3_degrid_C(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D4_degrid_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D5_degrid_C(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+// degrid_SSE
+void ApplyWiener3D3_degrid_SSE(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyWiener3D3_degrid_SSE_simd(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D3_degrid_SSE(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+void Sharpen_degrid_SSE_simd(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float degrid, fftwf_complex *gridsample, float dehalo, float *wdehalo, float ht2n);
+void ApplyWiener3D4_degrid_SSE(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample);
+void ApplyPattern3D4_degrid_SSE(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample);
+// FP16 cache
+void FloatToHalf_C(const float *src, uint16_t *dst, int count, float scale);
+void HalfToFloat_C(const uint16_t *src, float *dst, int count, float scale);
+void FloatToHalf_F16C(const float *src, uint16_t *dst, int count, float scale);
+void HalfToFloat_F16C(const uint16_t *src, float *dst, int count, float scale);
+// block means
+void GetAndSubtractMean_C(float *in, int howmanyblocks, int bwbh, const float *wanblock, float meannorm, float *mean);
+void RestoreMean_C(float *in, int howmanyblocks, int bwbh, const float *wanblock, float scale, const float *mean);
+void GetAndSubtractMean_SSE2(float *in, int howmanyblocks, int bwbh, const float *wanblock, float meannorm, float *mean);
+void RestoreMean_SSE2(float *in, int howmanyblocks, int bwbh, const float *wanblock, float scale, const float *mean);
+// YUY2 rows
+void YUY2ToPlaneRow_C(const uint8_t *src, uint8_t *dst, int width, int plane);
+void PlaneRowToYUY2_C(const uint8_t *src, uint8_t *dst, int width, int plane);
+void MergeYUY2Row_C(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize);
+void YUY2ToPlaneRow_SSE2(const uint8_t *src, uint8_t *dst, int width, int plane);
+void PlaneRowToYUY2_SSE2(const uint8_t *src, uint8_t *dst, int width, int plane);
+void MergeYUY2Row_SSE2(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize);
+//-------------------------------------------------------------------------------------------
+// Kernel dispatchers. FFT3D_NOINLINE: each is a named frame above its C/SSE/AVX2 implementation
+// in profiles, whatever the compiler inlines - v2.11
+FFT3D_NOINLINE void ApplyWiener2D(fftwf_complex *out, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed,
+  float beta, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float dehalo, float *wdehalo, float ht2n, int CPUFlags)
+{
+  ApplyWiener2D_C(out, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta, sharpen, sigmaSquaredSharpenMin, sigmaSquaredSharpenMax, wsharpen, dehalo, wdehalo, ht2n);
+}
+//-------------------------------------------------------------------------------------------
+// Temporal filters: the result is written to outdst, the input spectra are not changed - v2.11
+// The old x86 assembler functions still return it in place of outprev (outprev2 for bt=4),
+// for them the input is copied to outdst first.
+#ifndef X86_64
+static void CopySpectrum(fftwf_complex *outdst, const fftwf_complex *outsrc, int outpitch, int bh, int howmanyblocks)
+{
+  if (outdst != outsrc)
+    memcpy(outdst, outsrc, sizeof(fftwf_complex) * outpitch * bh * howmanyblocks);
+}
+#endif
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyWiener3D2(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2) // 170302 simd, SSE2
+    ApplyWiener3D2_SSE_simd(outcur, outprev, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta);
+  else
+    ApplyWiener3D2_C(outcur, outprev, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyPattern3D2(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, int CPUFlags)
+{
+#ifndef X86_64
+  if (CPUFlags & CPUF_SSE)
+  {
+    CopySpectrum(outdst, outprev, outpitch, bh, howmanyblocks);
+    ApplyPattern3D2_SSE(outcur, outdst, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta);
+  }
+  else
+#endif
+    ApplyPattern3D2_C(outcur, outprev, outdst, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyWiener3D3(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, int CPUFlags)
+{
+#ifndef X86_64
+  if (CPUFlags & CPUF_SSE)
+  {
+    CopySpectrum(outdst, outprev, outpitch, bh, howmanyblocks);
+    ApplyWiener3D3_SSE(out, outdst, outnext, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta);
+  }
+  else
+#endif
+    ApplyWiener3D3_C(out, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyWiener3D3_degrid(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE)
+    ApplyWiener3D3_degrid_SSE_simd(out, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample);
+  else
+    ApplyWiener3D3_degrid_C(out, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyWiener3D4_degrid(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags)
+{
+#ifndef X86_64
+  if (CPUFlags & CPUF_SSE)
+  {
+    CopySpectrum(outdst, outprev2, outpitch, bh, howmanyblocks);
+    ApplyWiener3D4_degrid_SSE(out, outdst, outprev, outnext, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample);
+  }
+  else
+#endif
+    ApplyWiener3D4_degrid_C(out, outprev2, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyPattern2D(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float pfactor, float *pattern2d0, float beta, int CPUFlags)
+{
+  ApplyPattern2D_C(outcur, outwidth, outpitch, bh, howmanyblocks, pfactor, pattern2d0, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyPattern3D3(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, int CPUFlags)
+{
+#ifndef X86_64
+  if (CPUFlags & CPUF_SSE)
+  {
+    CopySpectrum(outdst, outprev, outpitch, bh, howmanyblocks);
+    ApplyPattern3D3_SSE(out, outdst, outnext, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta);
+  }
+  else
+#endif
+    ApplyPattern3D3_C(out, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyPattern3D3_degrid(fftwf_complex *out, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags)
+{
+#ifndef X86_64
+  if (CPUFlags & CPUF_SSE)
+  {
+    CopySpectrum(outdst, outprev, outpitch, bh, howmanyblocks);
+    ApplyPattern3D3_degrid_SSE(out, outdst, outnext, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta, degrid, gridsample);
+  }
+  else
+#endif
+    ApplyPattern3D3_degrid_C(out, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta, degrid, gridsample);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyPattern3D4_degrid(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float *pattern3d, float beta, float degrid, fftwf_complex *gridsample, int CPUFlags)
+{
+#ifndef X86_64
+  if (CPUFlags & CPUF_SSE)
+  {
+    CopySpectrum(outdst, outprev2, outpitch, bh, howmanyblocks);
+    ApplyPattern3D4_degrid_SSE(out, outdst, outprev, outnext, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta, degrid, gridsample);
+  }
+  else
+#endif
+    ApplyPattern3D4_degrid_C(out, outprev2, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta, degrid, gridsample);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyWiener3D4(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2)
+    ApplyWiener3D4_SSE_simd(out, outprev2, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta);
+  else
+    ApplyWiener3D4_C(out, outprev2, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyPattern3D4(fftwf_complex *out, fftwf_complex *outprev2, fftwf_complex *outprev, fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, float* pattern3d, float beta, int CPUFlags)
+{
+  ApplyPattern3D4_C(out, outprev2, outprev, outnext, outdst, outwidth, outpitch, bh, howmanyblocks, pattern3d, beta);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyKalmanPattern(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float *covarNoiseNormed, float kratio2, int CPUFlags)
+{
+  ApplyKalmanPattern_C(outcur, outLast, covar, covarProcess, outwidth, outpitch, bh, howmanyblocks, covarNoiseNormed, kratio2);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void ApplyKalman(fftwf_complex *outcur, fftwf_complex *outLast, float *covar, float *covarProcess, int outwidth, int outpitch, int bh, int howmanyblocks, float covarNoiseNormed, float kratio2, int CPUFlags)
+{
+  // bt=0
+  // moved to SSE2 simd (though only 8 bytes internal working mode)
+  if (CPUFlags & CPUF_SSE2)
+    ApplyKalman_SSE2_simd(outcur, outLast, covar, covarProcess, outwidth, outpitch, bh, howmanyblocks, covarNoiseNormed, kratio2);
+  else
+    ApplyKalman_C(outcur, outLast, covar, covarProcess, outwidth, outpitch, bh, howmanyblocks, covarNoiseNormed, kratio2);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void Sharpen(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float dehalo, float *wdehalo, float ht2n, int CPUFlags)
+{
+#ifndef X86_64
+  if ((CPUFlags & CPUF_SSE) && dehalo == 0)
+    Sharpen_SSE(outcur, outwidth, outpitch, bh, howmanyblocks, sharpen, sigmaSquaredSharpenMin, sigmaSquaredSharpenMax, wsharpen);
+  else
+#endif
+    Sharpen_C(outcur, outwidth, outpitch, bh, howmanyblocks, sharpen, sigmaSquaredSharpenMin, sigmaSquaredSharpenMax, wsharpen, dehalo, wdehalo, ht2n);
+}
+//-------------------------------------------------------------------------------------------
+// size complex values to scaled FP16 pairs and back - v2.11
+FFT3D_NOINLINE void SpectrumToHalf(const fftwf_complex *src, uint16_t *dst, int size, float scale, int CPUFlags)
+{
+  if ((CPUFlags & CPUF_AVX2) && (CPUFlags & CPUF_F16C))
+    FloatToHalf_F16C((const float *)src, dst, size * 2, scale);
+  else
+    FloatToHalf_C((const float *)src, dst, size * 2, scale);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void HalfToSpectrum(const uint16_t *src, fftwf_complex *dst, int size, float scale, int CPUFlags)
+{
+  if ((CPUFlags & CPUF_AVX2) && (CPUFlags & CPUF_F16C))
+    HalfToFloat_F16C(src, (float *)dst, size * 2, scale);
+  else
+    HalfToFloat_C(src, (float *)dst, size * 2, scale);
+}
+//-------------------------------------------------------------------------------------------
+// window weighted block means out of the overlapped blocks and back (removemean) - v2.11
+FFT3D_NOINLINE void GetAndSubtractMean(float *in, int howmanyblocks, int bwbh, const float *wanblock, float meannorm, float *mean, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2)
+    GetAndSubtractMean_SSE2(in, howmanyblocks, bwbh, wanblock, meannorm, mean);
+  else
+    GetAndSubtractMean_C(in, howmanyblocks, bwbh, wanblock, meannorm, mean);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void RestoreMean(float *in, int howmanyblocks, int bwbh, const float *wanblock, float scale, const float *mean, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2)
+    RestoreMean_SSE2(in, howmanyblocks, bwbh, wanblock, scale, mean);
+  else
+    RestoreMean_C(in, howmanyblocks, bwbh, wanblock, scale, mean);
+}
+//-------------------------------------------------------------------------------------------
+// width pixels of YUY2 plane (0: Y, 1: U, 2: V) from a YUY2 row to a plane row and back - v2.11
+void YUY2ToPlaneRow(const uint8_t *src, uint8_t *dst, int width, int plane, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2)
+    YUY2ToPlaneRow_SSE2(src, dst, width, plane);
+  else
+    YUY2ToPlaneRow_C(src, dst, width, plane);
+}
+//-------------------------------------------------------------------------------------------
+void PlaneRowToYUY2(const uint8_t *src, uint8_t *dst, int width, int plane, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2)
+    PlaneRowToYUY2_SSE2(src, dst, width, plane);
+  else
+    PlaneRowToYUY2_C(src, dst, width, plane);
+}
+//-------------------------------------------------------------------------------------------
+// YUY2 row of Y from srcY, U from srcU and V from srcV
+void MergeYUY2Row(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize, int CPUFlags)
+{
+  if (CPUFlags & CPUF_SSE2)
+    MergeYUY2Row_SSE2(srcY, srcU, srcV, dst, rowsize);
+  else
+    MergeYUY2Row_C(srcY, srcU, srcV, dst, rowsize);
+}
+//-------------------------------------------------------------------------------------------
+FFT3D_NOINLINE void Sharpen_degrid(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int howmanyblocks, float sharpen, float sigmaSquaredSharpenMin, float sigmaSquaredSharpenMax, float *wsharpen, float degrid, fftwf_complex *gridsample, float dehalo, float *wdehalo, float ht2n, int CPUFlags)
+{
+  if ((CPUFlags & CPUF_SSE2))
+    Sharpen_degrid_SSE_simd(outcur, outwidth, outpitch, bh, howmanyblocks, sharpen, sigmaSquaredSharpenMin, sigmaSquaredSharpenMax, wsharpen, degrid, gridsample, dehalo, wdehalo, ht2n);
+  else
+    Sharpen_degrid_C(outcur, outwidth, outpitch, bh, howmanyblocks, sharpen, sigmaSquaredSharpenMin, sigmaSquaredSharpenMax, wsharpen, degrid, gridsample, dehalo, wdehalo, ht2n);
+}
+//-------------------------------------------------------------------------------------------
+//-------------------------------------------------------------------
+void fill_complex(fftwf_complex *plane, int outsize, float realvalue, float imgvalue)
+{
+  // it is not fast, but called only in constructor
+  int w;
+  for (w = 0; w < outsize; w++) {
+    plane[w][0] = realvalue;
+    plane[w][1] = imgvalue;
+  }
+}
+//-------------------------------------------------------------------
+void SigmasToPattern(float sigma, float sigma2, float sigma3, float sigma4, int bh, int outwidth, int outpitch, float norm, float *pattern2d)
+{
+  // it is not fast, but called only in constructor
+  float sigmacur;
+  float ft2 = sqrt(0.5f) / 2; // frequency for sigma2
+  float ft3 = sqrt(0.5f) / 4; // frequency for sigma3
+  for (int h = 0; h < bh; h++)
+  {
+    for (int w = 0; w < outwidth; w++)
+    {
+      float fy = (bh - 2.0f*abs(h - bh / 2)) / bh; // normalized to 1
+      float fx = (w*1.0f) / outwidth;  // normalized to 1
+      float f = sqrt((fx*fx + fy*fy)*0.5f); // normalized to 1
+      if (f < ft3)
+      { // low frequencies
+        sigmacur = sigma4 + (sigma3 - sigma4)*f / ft3;
+      }
+      else if (f < ft2)
+      { // middle frequencies
+        sigmacur = sigma3 + (sigma2 - sigma3)*(f - ft3) / (ft2 - ft3);
+      }
+      else
+      {// high frequencies
+        sigmacur = sigma + (sigma2 - sigma)*(1 - f) / (1 - ft2);
+      }
+      pattern2d[w] = sigmacur*sigmacur / norm;
+    }
+    pattern2d += outpitch;
+  }
+}
+
+
+//-------------------------------------------------------------------------------------------
+void ShowIn(float *in0, int nox, int noy, int bw, int bh, uint8_t* srcp0, int src_width, int src_height, int src_pitch)
+{
+  float *in = in0;
+  uint8_t *srcp = srcp0;
+  int in_pitch = nox*bw*bh;
+  int noxmax = src_width / bw;
+  int noymax = src_height / bh;
+  for (int by = 0; by < noymax; by++)
+  {
+    srcp = srcp0 + src_pitch*bh*by;
+    in = in0 + in_pitch*by;
+    for (int bx = 0; bx < noxmax; bx++)
+    {
+      for (int h = 0; h < bh; h++)
+      {
+        for (int w = 0; w < bw; w++)
+        {
+          srcp[w] = (int)in[w];
+        }
+        srcp += src_pitch;
+        in += bw;
+      }
+      srcp -= src_pitch*bh;
+      srcp += bw;
+    }
+  }
+}
+//-------------------------------------------------------------------------------------------
+void FindPatternBlock(fftwf_complex *outcur0, int outwidth, int outpitch, int bh, int nox, int noy, int &px, int &py, float *pwin, float degrid, fftwf_complex *gridsample)
+{
+  // since v1.7 outwidth must be really an outpitch
+  int h;
+  int w;
+  fftwf_complex *outcur;
+  float psd;
+  float sigmaSquaredcur;
+  float sigmaSquared;
+  sigmaSquared = 1e15f;
+
+  for (int by = 2; by < noy - 2; by++)
+  {
+    for (int bx = 2; bx < nox - 2; bx++)
+    {
+      outcur = outcur0 + nox*by*bh*outpitch + bx*bh*outpitch;
+      sigmaSquaredcur = 0;
+      float gcur = degrid*outcur[0][0] / gridsample[0][0]; // grid (windowing) correction factor
+      for (h = 0; h < bh; h++)
+      {
+        for (w = 0; w < outwidth; w++)
+        {
+          //					psd = outcur[w][0]*outcur[w][0] + outcur[w][1]*outcur[w][1];
+          float grid0 = gcur*gridsample[w][0];
+          float grid1 = gcur*gridsample[w][1];
+          float corrected0 = outcur[w][0] - grid0;
+          float corrected1 = outcur[w][1] - grid1;
+          psd = corrected0*corrected0 + corrected1*corrected1;
+          sigmaSquaredcur += psd*pwin[w]; // windowing
+        }
+        outcur += outpitch;
+        pwin += outpitch;
+        gridsample += outpitch;
+      }
+      pwin -= outpitch*bh; // restore
+      gridsample -= outpitch*bh; // restore - v2.11: was read past the grid block for all but the first one
+      if (sigmaSquaredcur < sigmaSquared)
+      {
+        px = bx;
+        py = by;
+        sigmaSquared = sigmaSquaredcur;
+      }
+    }
+  }
+}
+//-------------------------------------------------------------------------------------------
+void SetPattern(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int nox, int noy, int px, int py, float *pwin, float *pattern2d, float &psigma, float degrid, fftwf_complex *gridsample)
+{
+  int h;
+  int w;
+  outcur += nox*py*bh*outpitch + px*bh*outpitch;
+  float psd;
+  float sigmaSquared = 0;
+  float weight = 0;
+
+  for (h = 0; h < bh; h++)
+  {
+    for (w = 0; w < outwidth; w++)
+    {
+      weight += pwin[w];
+    }
+    pwin += outpitch;
+  }
+  pwin -= outpitch*bh; // restore
+
+  float gcur = degrid*outcur[0][0] / gridsample[0][0]; // grid (windowing) correction factor
+
+  for (h = 0; h < bh; h++)
+  {
+    for (w = 0; w < outwidth; w++)
+    {
+      float grid0 = gcur*gridsample[w][0];
+      float grid1 = gcur*gridsample[w][1];
+      float corrected0 = outcur[w][0] - grid0;
+      float corrected1 = outcur[w][1] - grid1;
+      psd = corrected0*corrected0 + corrected1*corrected1;
+      //			psd = outcur[w][0]*outcur[w][0] + outcur[w][1]*outcur[w][1];
+      pattern2d[w] = psd*pwin[w]; // windowing
+      sigmaSquared += pattern2d[w]; // sum
+    }
+    outcur += outpitch;
+    pattern2d += outpitch;
+    pwin += outpitch;
+    gridsample += outpitch;
+  }
+  psigma = sqrt(sigmaSquared / (weight*bh*outwidth)); // mean std deviation (sigma)
+}
+//-------------------------------------------------------------------------------------------
+void PutPatternOnly(fftwf_complex *outcur, int outwidth, int outpitch, int bh, int nox, int noy, int px, int py)
+{
+  int h, w;
+  int block;
+  int pblock = py*nox + px;
+  int blocks = nox*noy;
+
+  for (block = 0; block < pblock; block++)
+  {
+    for (h = 0; h < bh; h++)
+    {
+      for (w = 0; w < outwidth; w++)
+      {
+        outcur[w][0] = 0;
+        outcur[w][1] = 0;
+      }
+      outcur += outpitch;
+    }
+  }
+
+  outcur += bh*outpitch;
+
+  for (block = pblock + 1; block < blocks; block++)
+  {
+    for (h = 0; h < bh; h++)
+    {
+      for (w = 0; w < outwidth; w++)
+      {
+        outcur[w][0] = 0;
+        outcur[w][1] = 0;
+      }
+      outcur += outpitch;
+    }
+  }
+
+}
+//-------------------------------------------------------------------------------------------
+void Pattern2Dto3D(float *pattern2d, int bh, int outwidth, int outpitch, float mult, float *pattern3d)
+{
+  // slow, but executed once only per clip
+  int size = bh*outpitch;
+  for (int i = 0; i < size; i++)
+  { // get 3D pattern
+    pattern3d[i] = pattern2d[i] * mult;
+  }
+}
+//-------------------------------------------------------------------------------------------
+
+namespace fft3d {
+
+//-------------------------------------------------------------------------------------------
+// CPU flags for hosts without AviSynth's GetCPUFlags - v2.11
+int DetectCPUFlags()
+{
+  int flags = CPUF_FPU;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("mmx")) flags |= CPUF_MMX;
+  if (__builtin_cpu_supports("sse")) flags |= CPUF_SSE | CPUF_INTEGER_SSE;
+  if (__builtin_cpu_supports("sse2")) flags |= CPUF_SSE2;
+  if (__builtin_cpu_supports("sse3")) flags |= CPUF_SSE3;
+  if (__builtin_cpu_supports("ssse3")) flags |= CPUF_SSSE3;
+  if (__builtin_cpu_supports("sse4.1")) flags |= CPUF_SSE4_1;
+  if (__builtin_cpu_supports("sse4.2")) flags |= CPUF_SSE4_2;
+  if (__builtin_cpu_supports("avx")) flags |= CPUF_AVX;
+  if (__builtin_cpu_supports("avx2")) flags |= CPUF_AVX2;
+  if (__builtin_cpu_supports("fma")) flags |= CPUF_FMA3;
+  if (__builtin_cpu_supports("avx512f")) flags |= CPUF_AVX512F;
+  if (__builtin_cpu_supports("avx512bw")) flags |= CPUF_AVX512BW;
+#if defined(__x86_64__)
+  flags |= CPUF_X86_64;
+#endif
+  {
+    // F16C: CPUID.1:ECX bit 29
+    unsigned int eax, ebx, ecx, edx;
+    __asm__ __volatile__("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1), "c"(0));
+    if ((ecx & (1u << 29)) && (flags & CPUF_AVX)) flags |= CPUF_F16C;
+  }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  int info[4];
+  __cpuid(info, 1);
+  if (info[3] & (1 << 23)) flags |= CPUF_MMX;
+  if (info[3] & (1 << 25)) flags |= CPUF_SSE | CPUF_INTEGER_SSE;
+  if (info[3] & (1 << 26)) flags |= CPUF_SSE2;
+  if (info[2] & (1 << 0)) flags |= CPUF_SSE3;
+  if (info[2] & (1 << 9)) flags |= CPUF_SSSE3;
+  if (info[2] & (1 << 19)) flags |= CPUF_SSE4_1;
+  if (info[2] & (1 << 20)) flags |= CPUF_SSE4_2;
+  const bool avx = (info[2] & (1 << 28)) && (info[2] & (1 << 27)) && ((_xgetbv(0) & 6) == 6);
+  if (avx) flags |= CPUF_AVX;
+  if (avx && (info[2] & (1 << 12))) flags |= CPUF_FMA3;
+  if (avx && (info[2] & (1 << 29))) flags |= CPUF_F16C;
+  __cpuidex(info, 7, 0);
+  if (avx && (info[1] & (1 << 5))) flags |= CPUF_AVX2;
+#if defined(_M_X64)
+  flags |= CPUF_X86_64;
+#endif
+#endif
+  return flags;
+}
+
+//-------------------------------------------------------------------
+
+Engine::Engine(const Params &p, const Format &_format, FrameSource *_source, int cpuflags) :
+  sigma(p.sigma), beta(p.beta), bw(p.bw), bh(p.bh), bt(p.bt), ow(p.ow), oh(p.oh),
+  kratio(p.kratio), sharpen(p.sharpen), scutoff(p.scutoff), svr(p.svr), smin(p.smin), smax(p.smax),
+  measure(p.measure), interlaced(p.interlaced), wintype(p.wintype),
+  pframe(p.pframe), px(p.px), py(p.py), pshow(p.pshow), pcutoff(p.pcutoff), pfactor(p.pfactor),
+  sigma2(p.sigma2), sigma3(p.sigma3), sigma4(p.sigma4), degrid(p.degrid),
+  dehalo(p.dehalo), hr(p.hr), ht(p.ht), ncpu(p.ncpu), numa(p.numa), hugepages(p.hugepages), membudget(p.membudget),
+  format(_format), source(_source), removemean(p.removemean), stats(p.stats), halfcache(p.halfcache) {
+
+  static int id = 0; _instance_id = id++;
+  _RPT1(0, "FFT3DFilter engine create instance_id=%d\n", _instance_id);
+  pool = nullptr;
+  planrow = nullptr;
+  planinvrow = nullptr;
+  planframe = nullptr;
+  stage1 = nullptr;
+  pipeframe = -1;
+  pipefftns = 0;
+  pipeoverlapns = 0;
+  striprows = 0;
+  footprintbytes = 0;
+  outLast = nullptr;
+  covar = covarProcess = nullptr;
+  mean = meanpipe = nullptr;
+  frame_buffers_ready = false;
+  halfsize = 0;
+
+  int i, j;
+
+  bits_per_pixel = format.bits_per_pixel;
+  pixelsize = bits_per_pixel == 8 ? 1 : bits_per_pixel == 32 ? 4 : 2;
+
+  float factor;
+  if (pixelsize == 1) factor = 1.0f;
+  else if (pixelsize == 2) factor = float(1 << (bits_per_pixel-8));
+  else // float
+    factor = 1 / 255.0f;
+
+  sigma = sigma * factor;
+  sigma2 = sigma2 * factor;
+  sigma3 = sigma3 * factor;
+  sigma4 = sigma4 * factor;
+  smin = smin * factor;
+  smax = smax * factor;
+
+#ifndef X86_64
+  _mm_empty(); // _asm emms;
+#endif
+
+  //		if (bw%2 !=0 ) env->ThrowError("FFT3DFilter: Block width must be even"); //  I forget why even, so removed in v 1.2
+  //		if (bh%2 !=0 ) env->ThrowError("FFT3DFilter: Block height must be even");
+  if (ow * 2 > bw) throw Error("FFT3DFilter: Must not be 2*ow > bw");
+  if (oh * 2 > bh) throw Error("FFT3DFilter: Must not be 2*oh > bh");
+  if (ow < 0) ow = bw / 3; // changed from bw/4 to bw/3 in v.1.2
+  if (oh < 0) oh = bh / 3; // changed from bh/4 to bh/3 in v.1.2
+
+  if (bt < -1 || bt >5) throw Error("FFT3DFilter: bt must be -1(Sharpen), 0(Kalman), 1,2,3,4,5(Wiener)");
+  if (numa < 0 || numa > 2) throw Error("FFT3DFilter: numa must be 0, 1 or 2");
+  if (hugepages < 0 || hugepages > 2) throw Error("FFT3DFilter: hugepages must be 0, 1 or 2");
+
+/*
+    (Parameter bt = 1) 
+      2D(spatial) Wiener filter for spectrum data. Use current frame data only.
+      Reduce weak frequencies(with small power spectral density) by optimal Wiener filter with some 
+      given noise value. Sharpening and denoising are simultaneous in this mode.
+    (Parameter bt = 2) 
+      3D Wiener filter for spectrum data.
+      Add third dimension to FFT by using previous and current frame data. 
+      Reduce weak frequencies (with small power spectral density) by optimal Wiener filter with some 
+      given noise value.
+    (Parameter bt = 3) 
+      Also 3D Wiener filter for spectrum data with previous, current and next frame data.
+    (Parameter bt = 4) 
+      Also 3D Wiener filter for spectrum data with two previous, current and next frame data.
+    (Parameter bt = 5) 
+      Also 3D Wiener filter for spectrum data with two previous, current and two next frames data.
+    (Parameter bt = 0) 
+      Temporal Kalman filter for spectrum data.
+      Use all previous frames data to get estimation of cleaned current data with optimal recursive 
+      data process algorithm.
+      The filter starts work with small(= 1) gain(degree of noise reducing), and than gradually(in frames sequence) increases the gain 
+      if inter - frame local spectrum(noise) variation is small.
+      So, Kalman filter can provide stronger noise reduction than Wiener filter.
+      The Kalman filter gain is limited by some given noise value.
+      The local gain(and filter work) is reset to 1 when local variation exceeds the given threshold
+      (due to motion, scene change, etc).
+      So, the Kalman filter output is history - dependent(on frame taken as a start filtered frame).
+
+      PF: bt==0 have to be MT_SERIALIZED because it maintains internal history
+*/
+
+  // the plane of the engine: luma, chroma (with subsampling) or one plane of YUY2 - v2.11
+  // multiplanes are handled in FFT3DFilterMulti constructor by an engine per plane
+  if (format.width <= 0 || format.height <= 0)
+    throw Error("FFT3DFilter: empty plane");
+  if (pixelsize == 2 ? (bits_per_pixel < 10 || bits_per_pixel > 16) : (bits_per_pixel != 8 && bits_per_pixel != 32))
+    throw Error("FFT3DFilter: bits per pixel must be 8, 10, 12, 14, 16 or 32");
+  if (format.yuy2plane >= 0 && bits_per_pixel != 8)
+    throw Error("FFT3DFilter: YUY2 is 8 bit");
+  nox = (format.width - ow + (bw - ow - 1)) / (bw - ow);
+  noy = (format.height - oh + (bh - oh - 1)) / (bh - oh);
+
+  // padding by 1 block per side
+  nox += 2;
+  noy += 2;
+  mirw = bw - ow; // set mirror size as block interval
+  mirh = bh - oh;
+
+  if (beta < 1)
+    throw Error("FFT3DFilter: beta must be not less 1.0");
+
+  int istat;
+
+  try {
+    fftfp.load();
+  }
+  catch (const std::exception& e)
+  {
+    throw Error(e.what());
+  }
+
+
+  coverwidth = nox*(bw - ow) + ow;
+  coverheight = noy*(bh - oh) + oh;
+  int insize = bw * bh * nox * noy;
+  outwidth = bw / 2 + 1; // width (pitch) of complex fft block
+  outpitch = ((outwidth + 1) / 2) * 2; // must be even for SSE - v1.7
+  outsize = outpitch * bh * nox * noy; // replace outwidth to outpitch here and below in v1.7
+
+  // v2.11: bt=0 with ncpu>1 processes the frame by block rows (see the plans below)
+  // rows of nox blocks keep the SIMD alignment of the first one
+  bool rowaligned = (nox*bw*bh) % 8 == 0 && (nox*outpitch*bh) % 4 == 0;
+  bool rowparallel = bt == 0 && ncpu > 1 && noy > 1 && rowaligned;
+  pipeline = !rowparallel;
+  bool batchfill = bt >= 2 && ncpu > 1; // parallel cache refill after seeks
+  if (bt < 2)
+    halfcache = false;
+
+  // v2.11: memory budget. Estimated bytes of the buffers below (without the small tables),
+  // while over the budget, give up in this order: parallel refill after seeks, pipeline,
+  // float cache of the past frames (halfcache), whole frame processing (strips of block rows).
+  size_t inrow = (size_t)nox * bw * bh;
+  size_t outrow = (size_t)nox * outpitch * bh;
+  size_t inbytes = insize * sizeof(float);
+  size_t outbytes = (size_t)outsize * sizeof(fftwf_complex);
+  size_t batchbytes = bt * inbytes;
+  auto footprint = [&]() {
+    size_t bytes = outbytes; // gridsample
+    if (striprows > 0)
+      bytes += (striprows + 3) * inrow * sizeof(float) + striprows * outrow * sizeof(fftwf_complex);
+    else
+      bytes += inbytes + outbytes;
+    if (halfcache)
+      bytes += ((bt - 1) / 2 + 1) * outbytes + (bt / 2) * (outbytes / 2 + outrow * sizeof(fftwf_complex));
+    else if (bt >= 2)
+      bytes += bt * outbytes;
+    if (bt == 0)
+      bytes += outbytes + 2 * outsize * sizeof(float);
+    if (pipeline)
+      bytes += inbytes + outbytes;
+    if (batchfill)
+      bytes += batchbytes;
+    return bytes;
+  };
+  if (membudget > 0)
+  {
+    if (footprint() > membudget)
+      batchfill = false;
+    if (footprint() > membudget)
+      pipeline = false;
+    if (footprint() > membudget && bt >= 2)
+      halfcache = true;
+    // noise pattern estimation and pshow work on the whole frame spectrum
+    if (footprint() > membudget && rowaligned && noy > 1 && pfactor == 0 && !pshow)
+    {
+      rowparallel = false;
+      striprows = noy;
+      while (striprows > 1 && footprint() > membudget)
+        striprows--;
+    }
+  }
+  footprintbytes = footprint();
+
+  // fft cache - added in v1.8
+  cachesize = bt >= 2 ? bt : 0; // only the 3D modes use it
+  if (halfcache) // v2.11
+  {
+    cachesize = (bt - 1) / 2 + 1;
+    halfsize = bt / 2;
+    // max. spectrum value is bw*bh*(max. pixel value), FP16 max. is 65504
+    float maxpixel = pixelsize == 4 ? 1.0f : (float)((1 << bits_per_pixel) - 1);
+    int exponent;
+    frexpf(16384.0f / (bw * bh * maxpixel), &exponent);
+    halfscale = ldexpf(1.0f, exponent - 1);
+  }
+
+  // v2.11: all buffers are sized here and placed in two blocks
+  arena.reserve(wanxl, ow);
+  arena.reserve(wanxr, ow);
+  arena.reserve(wanyl, oh);
+  arena.reserve(wanyr, oh);
+  arena.reserve(wsynxl, ow);
+  arena.reserve(wsynxr, ow);
+  arena.reserve(wsynyl, oh);
+  arena.reserve(wsynyr, oh);
+  arena.reserve(wsharpen, bh * outpitch);
+  arena.reserve(wdehalo, bh * outpitch);
+  arena.reserve(wanblock, bw * bh);
+  arena.reserve(pwin, bh * outpitch); // pattern window array
+  arena.reserve(pattern2d, bh * outpitch); // noise pattern window array
+  arena.reserve(pattern3d, bh * outpitch);
+  arena.reserve(gridsample, outsize); //v1.8
+  arena.reserve(cachefft, cachesize);
+  arena.reserve(cachewhat, cachesize);
+  arena.reserve(cachemean, cachesize);
+  arena.reserve(cachehalf, halfsize);
+  arena.reserve(halfwork, halfsize);
+  arena.reserve(halfwhat, halfsize);
+  if (!arena.allocate())
+    throw Error("FFT3DFilter: out of memory");
+
+  for (i = 0; i < cachesize; i++)
+    cachewhat[i] = -1; // init as notexistant
+  for (i = 0; i < halfsize; i++)
+    halfwhat[i] = -1;
+
+  // with numa>0 this block is made again at the first GetFrame, see InitFrameBuffers
+  if (striprows > 0)
+  {
+    framearena.reserve(in, (striprows + 2) * inrow);
+    framearena.reserve(inrowsave, inrow);
+    framearena.reserve(outrez, striprows * outrow);
+  }
+  else
+  {
+    framearena.reserve(in, insize);
+    framearena.reserve(outrez, outsize); //v1.8
+  }
+  for (i = 0; i < cachesize; i++)
+  {
+    framearena.reserve(cachefft[i], outsize);
+    framearena.reserve(cachemean[i], nox * noy);
+  }
+  framearena.reserve(mean, nox * noy);
+  for (i = 0; i < halfsize; i++)
+  {
+    framearena.reserve(cachehalf[i], 2 * outsize);
+    framearena.reserve(halfwork[i], nox * outpitch * bh);
+  }
+  if (bt == 0) // Kalman
+  {
+    framearena.reserve(outLast, outsize);
+    framearena.reserve(covar, outsize);
+    framearena.reserve(covarProcess, outsize);
+  }
+  if (pipeline)
+  {
+    framearena.reserve(inpipe, insize);
+    framearena.reserve(outpipe, outsize);
+    framearena.reserve(meanpipe, nox * noy);
+  }
+  framearena.set_hugepages(hugepages); // falls back to normal pages when not available
+  if (!framearena.allocate())
+    throw Error("FFT3DFilter: out of memory");
+
+  _RPT5(0, "FFT3DFilter instance_id=%d: buffers %u bytes (pipeline=%d halfcache=%d striprows=%d)\n", _instance_id,
+    (unsigned)(arena.size() + framearena.size() + (batchfill ? batchbytes : 0)), (int)pipeline, (int)halfcache, striprows);
+  if (membudget > 0 && footprintbytes > membudget)
+    _RPT2(0, "FFT3DFilter instance_id=%d: buffers do not fit in membudget even with the smallest setup (%u bytes)\n",
+      _instance_id, (unsigned)membudget);
+
+  int planFlags;
+  // use FFTW_ESTIMATE or FFTW_MEASURE (more optimal plan, but with time calculation at load stage)
+  if (measure)
+    planFlags = FFTW_MEASURE;
+  else
+    planFlags = FFTW_ESTIMATE;
+
+  int rank = 2; // 2d
+  ndim[0] = bh; // size of block along height
+  ndim[1] = bw; // size of block along width
+  int istride = 1;
+  int ostride = 1;
+  int idist = bw*bh;
+  int odist = outpitch*bh;//  v1.7 (was outwidth)
+  inembed[0] = bh;
+  inembed[1] = bw;
+  onembed[0] = bh;
+  onembed[1] = outpitch;//  v1.7 (was outwidth)
+  howmanyblocks = nox*noy;
+
+  //	*inembed = NULL;
+  //	*onembed = NULL;
+
+  {
+    std::lock_guard<std::mutex> lock(fftw_mutex);
+
+    if (fftfp.has_threading())
+      fftfp.fftwf_init_threads();
+
+    if (ncpu > 1 && fftfp.has_threading()) {
+      fftfp.fftwf_plan_with_nthreads(ncpu);
+    }
+
+    if (striprows > 0)
+    {
+      // v2.11: 'in' and outrez are smaller than a frame, there are only block row plans
+      plan = planinv = NULL;
+      planrow = fftfp.fftwf_plan_many_dft_r2c(rank, ndim, nox,
+        in, inembed, istride, idist, outrez, onembed, ostride, odist, planFlags);
+      planinvrow = fftfp.fftwf_plan_many_dft_c2r(rank, ndim, nox,
+        outrez, onembed, ostride, odist, in, inembed, istride, idist, planFlags);
+      if (planrow == NULL || planinvrow == NULL)
+        throw Error("FFT3DFilter: FFTW plan error");
+    }
+    else
+    {
+      plan = fftfp.fftwf_plan_many_dft_r2c(rank, ndim, howmanyblocks,
+        in, inembed, istride, idist, outrez, onembed, ostride, odist, planFlags);
+      if (plan == NULL)
+        throw Error("FFT3DFilter: FFTW plan error");
+
+      planinv = fftfp.fftwf_plan_many_dft_c2r(rank, ndim, howmanyblocks,
+        outrez, onembed, ostride, odist, in, inembed, istride, idist, planFlags);
+      if (planinv == NULL)
+        throw Error("FFT3DFilter: FFTW plan error");
+    }
+
+    if (fftfp.has_threading())
+      fftfp.fftwf_plan_with_nthreads(1);
+
+    // v2.11: Kalman is serialized in time, so instead of relying on fftw threads
+    // we spread one frame over ncpu threads by block rows (each row: nox blocks).
+    // Row arrays are used with the new-array execute functions,
+    // they have to keep the SIMD alignment of the first row.
+    if (rowparallel)
+    {
+      planrow = fftfp.fftwf_plan_many_dft_r2c(rank, ndim, nox,
+        in, inembed, istride, idist, outrez, onembed, ostride, odist, planFlags);
+      planinvrow = fftfp.fftwf_plan_many_dft_c2r(rank, ndim, nox,
+        outrez, onembed, ostride, odist, in, inembed, istride, idist, planFlags);
+      if (planrow == NULL || planinvrow == NULL)
+        throw Error("FFT3DFilter: FFTW plan error");
+    }
+    // v2.11: after a seek up to bt spectra are missing from the cache, they are made
+    // at once, one frame per thread
+    if (batchfill)
+    {
+      planframe = fftfp.fftwf_plan_many_dft_r2c(rank, ndim, howmanyblocks,
+        in, inembed, istride, idist, outrez, onembed, ostride, odist, planFlags);
+      if (planframe == NULL)
+        throw Error("FFT3DFilter: FFTW plan error");
+    }
+  }
+
+  if (rowparallel || planframe != NULL)
+    pool = new ThreadPool(ncpu);
+
+  // define analysis and synthesis windows
+  // combining window (analize mult by synthesis) is raised cosine (Hanning)
+
+  float pi = 3.1415926535897932384626433832795f;
+  if (wintype == 0) // window type
+  { // , used in all version up to 1.3
+    // half-cosine, the same for analysis and synthesis
+    // define analysis windows
+    for (i = 0; i < ow; i++)
+    {
+      wanxl[i] = cosf(pi*(i - ow + 0.5f) / (ow * 2)); // left analize window (half-cosine)
+      wanxr[i] = cosf(pi*(i + 0.5f) / (ow * 2)); // right analize window (half-cosine)
+    }
+    for (i = 0; i < oh; i++)
+    {
+      wanyl[i] = cosf(pi*(i - oh + 0.5f) / (oh * 2));
+      wanyr[i] = cosf(pi*(i + 0.5f) / (oh * 2));
+    }
+    // use the same windows for synthesis too.
+    for (i = 0; i < ow; i++)
+    {
+      wsynxl[i] = wanxl[i]; // left  window (half-cosine)
+
+      wsynxr[i] = wanxr[i]; // right  window (half-cosine)
+    }
+    for (i = 0; i < oh; i++)
+    {
+      wsynyl[i] = wanyl[i];
+      wsynyr[i] = wanyr[i];
+    }
+  }
+  else if (wintype == 1) // added in v.1.4
+  {
+    // define analysis windows as more flat (to decrease grid)
+    for (i = 0; i < ow; i++)
+    {
+      wanxl[i] = sqrt(cosf(pi*(i - ow + 0.5f) / (ow * 2)));
+      wanxr[i] = sqrt(cosf(pi*(i + 0.5f) / (oh * 2)));
+    }
+    for (i = 0; i < oh; i++)
+    {
+      wanyl[i] = sqrt(cosf(pi*(i - oh + 0.5f) / (oh * 2)));
+      wanyr[i] = sqrt(cosf(pi*(i + 0.5f) / (oh * 2)));
+    }
+    // define synthesis as supplenent to rised cosine (Hanning)
+    for (i = 0; i < ow; i++)
+    {
+      wsynxl[i] = wanxl[i] * wanxl[i] * wanxl[i]; // left window
+      wsynxr[i] = wanxr[i] * wanxr[i] * wanxr[i]; // right window
+    }
+    for (i = 0; i < oh; i++)
+    {
+      wsynyl[i] = wanyl[i] * wanyl[i] * wanyl[i];
+      wsynyr[i] = wanyr[i] * wanyr[i] * wanyr[i];
+    }
+  }
+  else //  (wintype==2) - added in v.1.4
+  {
+    // define analysis windows as flat (to prevent grid)
+    for (i = 0; i < ow; i++)
+    {
+      wanxl[i] = 1;
+      wanxr[i] = 1;
+    }
+    for (i = 0; i < oh; i++)
+    {
+      wanyl[i] = 1;
+      wanyr[i] = 1;
+    }
+    // define synthesis as rised cosine (Hanning)
+    for (i = 0; i < ow; i++)
+    {
+      wsynxl[i] = cosf(pi*(i - ow + 0.5f) / (ow * 2));
+      wsynxl[i] = wsynxl[i] * wsynxl[i];// left window (rised cosine)
+      wsynxr[i] = cosf(pi*(i + 0.5f) / (ow * 2));
+      wsynxr[i] = wsynxr[i] * wsynxr[i]; // right window (falled cosine)
+    }
+    for (i = 0; i < oh; i++)
+    {
+      wsynyl[i] = cosf(pi*(i - oh + 0.5f) / (oh * 2));
+      wsynyl[i] = wsynyl[i] * wsynyl[i];
+      wsynyr[i] = cosf(pi*(i + 0.5f) / (oh * 2));
+      wsynyr[i] = wsynyr[i] * wsynyr[i];
+    }
+  }
+
+  // window for sharpen
+  for (j = 0; j < bh; j++)
+  {
+    int dj = j;
+    if (j >= bh / 2)
+      dj = bh - j;
+    float d2v = float(dj*dj)*(svr*svr) / ((bh / 2)*(bh / 2)); // v1.7
+    for (i = 0; i < outwidth; i++)
+    {
+      float d2 = d2v + float(i*i) / ((bw / 2)*(bw / 2)); // distance_2 - v1.7
+      wsharpen[i] = 1 - exp(-d2 / (2 * scutoff*scutoff));
+    }
+    wsharpen += outpitch;
+  }
+  wsharpen -= outpitch*bh; // restore pointer
+
+  // window for dehalo - added in v1.9
+  float wmax = 0;
+  for (j = 0; j < bh; j++)
+  {
+    int dj = j;
+    if (j >= bh / 2)
+      dj = bh - j;
+    float d2v = float(dj*dj)*(svr*svr) / ((bh / 2)*(bh / 2));
+    for (i = 0; i < outwidth; i++)
+    {
+      float d2 = d2v + float(i*i) / ((bw / 2)*(bw / 2)); // squared distance in frequency domain
+      float d1 = sqrt(d2);
+      wdehalo[i] = exp(-0.7f*d2*hr*hr) - exp(-d2*hr*hr); // some window with max around 1/hr, small at low and high frequencies
+      if (wdehalo[i] > wmax) wmax = wdehalo[i]; // for normalization
+    }
+    wdehalo += outpitch;
+  }
+  wdehalo -= outpitch*bh; // restore pointer
+
+  for (j = 0; j < bh; j++)
+  {
+    for (i = 0; i < outwidth; i++)
+    {
+      wdehalo[i] /= wmax; // normalize
+    }
+    wdehalo += outpitch;
+  }
+  wdehalo -= outpitch*bh; // restore pointer
+
+  // init nlast
+  nlast = -999; // init as nonexistant
+  btcurlast = -999; // init as nonexistant
+
+  norm = 1.0f / (bw*bh); // do not forget set FFT normalization factor
+
+  // analysis window of a whole block, for the block means - v2.11
+  float wansum = 0;
+  for (j = 0; j < bh; j++)
+  {
+    float wy = j < oh ? wanyl[j] : (j >= bh - oh ? wanyr[j - bh + oh] : 1.0f);
+    for (i = 0; i < bw; i++)
+    {
+      float wx = i < ow ? wanxl[i] : (i >= bw - ow ? wanxr[i - bw + ow] : 1.0f);
+      wanblock[j * bw + i] = wx * wy;
+      wansum += wx * wy;
+    }
+  }
+  meannorm = 1.0f / wansum;
+
+  sigmaSquaredNoiseNormed2D = sigma*sigma / norm;
+  sigmaNoiseNormed2D = sigma / sqrtf(norm);
+  sigmaMotionNormed = sigma*kratio / sqrtf(norm);
+  sigmaSquaredSharpenMinNormed = smin*smin / norm;
+  sigmaSquaredSharpenMaxNormed = smax*smax / norm;
+  ht2n = ht*ht / norm; // halo threshold squared and normed - v1.9
+
+  if (numa == 0)
+    InitFrameBuffers(false); // else at first GetFrame - v2.11
+
+  CPUFlags = cpuflags; //re-enabled in v.1.9
+
+  float fw2, fh2;
+  for (j = 0; j < bh; j++)
+  {
+    if (j < bh / 2)
+      fh2 = (j*2.0f / bh)*(j*2.0f / bh);
+    else
+      fh2 = ((bh - 1 - j)*2.0f / bh)*((bh - 1 - j)*2.0f / bh);
+    for (i = 0; i < outwidth; i++)
+    {
+      fw2 = (i*2.0f / bw)*(j*2.0f / bw);
+      pwin[i] = (fh2 + fw2) / (fh2 + fw2 + pcutoff*pcutoff);
+    }
+    pwin += outpitch;
+  }
+  pwin -= outpitch*bh; // restore pointer
+
+  if ((sigma2 != sigma || sigma3 != sigma || sigma4 != sigma) && pfactor == 0)
+  {// we have different sigmas, so create pattern from sigmas
+    SigmasToPattern(sigma, sigma2, sigma3, sigma4, bh, outwidth, outpitch, norm, pattern2d);
+    isPatternSet = true;
+    pfactor = 1;
+  }
+  else
+  {
+    isPatternSet = false; // pattern must be estimated
+  }
+
+  // prepare  window compensation array gridsample
+  // allocate large array for simplicity :)
+  // but use one block only for speed
+  // Attention: other block could be the same, but we do not calculate them!
+  {
+    std::lock_guard<std::mutex> lock(fftw_mutex);
+    plan1 = fftfp.fftwf_plan_many_dft_r2c(rank, ndim, 1,
+      in, inembed, istride, idist, outrez, onembed, ostride, odist, planFlags); // 1 block
+  }
+
+  // avs+
+  // v2.11: plane of constant rows (pitch 0)
+  std::vector<uint8_t> constrow((size_t)coverwidth * pixelsize);
+  switch (pixelsize) {
+  case 1: memset(constrow.data(), 255, coverwidth); 
+    break;
+  case 2: std::fill_n((uint16_t *)constrow.data(), coverwidth, (1 << bits_per_pixel) - 1); 
+    break; // 255 
+  case 4: std::fill_n((float *)constrow.data(), coverwidth, 1.0f); 
+    break; // 255 
+  }
+  CoverPlane constplane = { constrow.data(), 0, coverwidth, coverheight, false, -1 };
+  if (striprows > 0) // block row 0 is made by stripes 0 and 1, it is the second row of the strip
+  {
+    Engine::InitOverlapPlane(in + nox*bw*bh, constplane, false, 0, 1);
+    fftfp.fftwf_execute_dft_r2c(plan1, in + nox*bw*bh, gridsample);
+  }
+  else
+  {
+    Engine::InitOverlapPlane(in, constplane, false);
+    // make FFT 2D
+    fftfp.fftwf_execute_dft_r2c(plan1, in, gridsample);
+  }
+
+//	fullwinan = (float *)fftwf_malloc(sizeof(float) * insize);
+//	Engine::InitFullWin(fullwinan, wanxl, wanxr, wanyl, wanyr);
+//	fullwinsyn = (float *)fftwf_malloc(sizeof(float) * insize);
+//	Engine::InitFullWin(fullwinsyn, wsynxl, wsynxr, wsynyl, wsynyr);
+
+}
+//-------------------------------------------------------------------------------------------
+
+// This is where any actual destructor code used goes
+Engine::~Engine() {
+  // This is where you can deallocate any memory you might have used.
+  delete pool; // stop the workers before their buffers are freed
+  delete stage1; // finishes the pending job
+#ifdef FFT3D_PROFILE
+  if (profile.samples() > 0)
+    PrintProfile(stderr);
+#endif
+  if (hugepages != 0)
+    _RPT3(0, "FFT3DFilter instance_id=%d: %u of %u frame buffer bytes were in huge pages\n",
+      _instance_id, (unsigned)framearena.hugepage_bytes(), (unsigned)framearena.size());
+  {
+    std::lock_guard<std::mutex> lock(fftw_mutex);
+    if (plan != NULL) // not made for strips
+    {
+      fftfp.fftwf_destroy_plan(plan);
+      fftfp.fftwf_destroy_plan(planinv);
+    }
+    fftfp.fftwf_destroy_plan(plan1);
+    if (planrow != NULL)
+    {
+      fftfp.fftwf_destroy_plan(planrow);
+      fftfp.fftwf_destroy_plan(planinvrow);
+    }
+    if (planframe != NULL)
+      fftfp.fftwf_destroy_plan(planframe);
+    // the buffers are freed by the arenas
+  //	fftwf_free(fullwinan);
+  //	fftwf_free(fullwinsyn);
+  //	fftwf_free(shiftedprev);
+  //	fftwf_free(shiftedprev2);
+  //	fftwf_free(shiftednext);
+  //	fftwf_free(shiftednext2);
+  //	fftwf_free(fftcorrel);
+  //	fftwf_free(correl);
+  //	free(xshifts);
+  //	free(yshifts);
+  }
+  fftfp.freelib();
+}
+
+#ifdef FFT3D_PROFILE
+void Engine::PrintProfile(FILE *f) const
+{
+  char title[160];
+  snprintf(title, sizeof(title), "FFT3DFilter profile instance_id=%d plane=%dx%d bt=%d bw=%d bh=%d, %dx%d blocks, ncpu=%d",
+    _instance_id, format.width, format.height, bt, bw, bh, nox, noy, ncpu);
+  profile.print(f, title);
+}
+#endif
+//-----------------------------------------------------------------------
+// Cover planes - v2.11
+
+// Index i of a row (or column) of n pixels, mirrored at the borders like the cover
+static inline int MirrorIndex(int i, int n)
+{
+  if (n <= 1)
+    return 0;
+  while (i < 0 || i >= n)
+    i = i < 0 ? -i : 2 * (n - 1) - i;
+  return i;
+}
+
+// Row of the plane at row y of the cover
+static inline int CoverRow(const CoverPlane &cover, int y, int mirh)
+{
+  int j = MirrorIndex(y - mirh, cover.height);
+  if (cover.interlaced) // first field, then the second one flipped
+  {
+    int half = cover.height / 2;
+    j = j < half ? 2 * j : std::max(0, 2 * half - 1 - 2 * (j - half));
+  }
+  return j;
+}
+
+// Source plane
+CoverPlane Engine::CoverIn(const Plane &src)
+{
+  return { const_cast<uint8_t *>(src.ptr), format.yuy2plane >= 0 ? src.pitch : src.pitch / pixelsize,
+    format.width, format.height, interlaced, format.yuy2plane };
+}
+
+// Destination plane
+CoverPlane Engine::CoverOut(uint8_t *dstp, int dst_pitch)
+{
+  return { dstp, format.yuy2plane >= 0 ? dst_pitch : dst_pitch / pixelsize,
+    format.width, format.height, interlaced, format.yuy2plane };
+}
+
+// First block column (1..nox) reaching over the right border of the plane, nox+1 if none.
+// Its pixels and the ones after it are in the edge buffer, after the mirw pixels of the left border.
+// For YUY2 it is 1: the whole cover row is in the edge buffer.
+int Engine::CoverTail(const CoverPlane &cover)
+{
+  if (cover.yuy2plane >= 0)
+    return 1;
+  for (int ihx = 1; ihx <= nox; ihx++)
+    if (ihx * (bw - ow) + (ihx < nox ? bw - ow : ow) > mirw + cover.width)
+      return ihx;
+  return nox + 1;
+}
+
+// Cover row y for reading. The body is the plane row (mirw = bw-ow), the borders are mirrored to edge.
+template<typename pixel_t>
+CoverLine<pixel_t> Engine::GetCoverLine(const CoverPlane &cover, int y, int tailblock, pixel_t *edge)
+{
+  pixel_t *row = reinterpret_cast<pixel_t *>(cover.ptr) + (size_t)CoverRow(cover, y, mirh) * cover.pitch;
+  if (cover.yuy2plane >= 0)
+  {
+    YUY2ToPlaneRow(reinterpret_cast<uint8_t *>(row), reinterpret_cast<uint8_t *>(edge + mirw), cover.width, cover.yuy2plane, CPUFlags);
+    for (int x = 0; x < mirw; x++)
+      edge[x] = edge[mirw + MirrorIndex(x - mirw, cover.width)];
+    for (int x = mirw + cover.width; x < coverwidth; x++)
+      edge[x] = edge[mirw + MirrorIndex(x - mirw, cover.width)];
+    return { edge, edge + mirw, edge + mirw };
+  }
+  int tailx = tailblock * (bw - ow);
+  for (int x = 0; x < mirw; x++)
+    edge[x] = row[MirrorIndex(x - mirw, cover.width)];
+  for (int x = tailx; x < coverwidth; x++)
+    edge[mirw + x - tailx] = row[MirrorIndex(x - mirw, cover.width)];
+  return { edge, row, edge + mirw };
+}
+
+// Cover row y for writing, all nullptr if it is a row of the mirrored borders.
+// The border pixels go to edge, the part of the tail inside the plane is stored by PutCoverTail.
+// For YUY2 body is the frame row, the whole row is written to edge (the tail from block 1 on).
+template<typename pixel_t>
+CoverLine<pixel_t> Engine::PutCoverLine(const CoverPlane &cover, int y, pixel_t *edge)
+{
+  if (y < mirh || y >= mirh + cover.height)
+    return { nullptr, nullptr, nullptr };
+  pixel_t *row = reinterpret_cast<pixel_t *>(cover.ptr) + (size_t)CoverRow(cover, y, mirh) * cover.pitch;
+  return { edge, row, edge + mirw };
+}
+
+template<typename pixel_t>
+void Engine::PutCoverTail(const CoverPlane &cover, const CoverLine<pixel_t> &line, int tailblock, pixel_t *edge)
+{
+  if (cover.yuy2plane >= 0)
+  {
+    PlaneRowToYUY2(reinterpret_cast<uint8_t *>(edge + mirw), reinterpret_cast<uint8_t *>(line.body), cover.width, cover.yuy2plane, CPUFlags);
+    return;
+  }
+  int tailx = tailblock * (bw - ow);
+  std::copy_n(line.tail, mirw + cover.width - tailx, line.body + tailx - mirw);
+}
+
+//-----------------------------------------------------------------------
+// put source bytes to float array of overlapped blocks
+// use analysis windows
+//
+
+FFT3D_NOINLINE void Engine::InitOverlapPlane(float * inp0, const CoverPlane &src, bool chroma, int ihy_from, int ihy_to, std::atomic<int64_t> *overlaptime)
+{
+  PROFILE_STAGE(STAGE_OVERLAP);
+  ScopedTimer timer(StatTimer(overlaptime ? *overlaptime : fstats.overlapns));
+  if (ihy_to < 0)
+    ihy_to = noy;
+  // for float: chroma center is also 0.0
+  if (chroma) {
+    switch (bits_per_pixel) {
+    case 8: do_InitOverlapPlane<uint8_t, 8, true>(inp0, src, ihy_from, ihy_to); break;
+    case 10: do_InitOverlapPlane<uint16_t, 10, true>(inp0, src, ihy_from, ihy_to); break;
+    case 12: do_InitOverlapPlane<uint16_t, 12, true>(inp0, src, ihy_from, ihy_to); break;
+    case 14: do_InitOverlapPlane<uint16_t, 14, true>(inp0, src, ihy_from, ihy_to); break;
+    case 16: do_InitOverlapPlane<uint16_t, 16, true>(inp0, src, ihy_from, ihy_to); break;
+    case 32: do_InitOverlapPlane<float, 8 /*n/a*/, true>(inp0, src, ihy_from, ihy_to); break;
+    }
+  }
+  else {
+    switch (bits_per_pixel) {
+    case 8: do_InitOverlapPlane<uint8_t, 8, false>(inp0, src, ihy_from, ihy_to); break;
+    case 10: do_InitOverlapPlane<uint16_t, 10, false>(inp0, src, ihy_from, ihy_to); break;
+    case 12: do_InitOverlapPlane<uint16_t, 12, false>(inp0, src, ihy_from, ihy_to); break;
+    case 14: do_InitOverlapPlane<uint16_t, 14, false>(inp0, src, ihy_from, ihy_to); break;
+    case 16: do_InitOverlapPlane<uint16_t, 16, false>(inp0, src, ihy_from, ihy_to); break;
+    case 32: do_InitOverlapPlane<float, 8 /*n/a*/, false>(inp0, src, ihy_from, ihy_to); break;
+    }
+  }
+}
+
+template<typename pixel_t, int bits_per_pixel, bool chroma>
+void Engine::do_InitOverlapPlane(float * inp0, const CoverPlane &src, int ihy_from, int ihy_to)
+{
+  int w, h;
+  int ihx, ihy;
+  const pixel_t *srcp;
+  // v2.11: the source rows are fetched by cover row, the mirrored border pixels come from 'edge'
+  int y = ihy_from * (bh - oh); // first line of the first requested stripe
+  int tailblock = CoverTail(src);
+  std::vector<pixel_t> edge(mirw + std::max(0, coverwidth - tailblock * (bw - ow)));
+  CoverLine<pixel_t> line;
+  float ftmp;
+  int xoffset = bh*bw - (bw - ow); // skip frames
+  int yoffset = bw*nox*bh - bw*(bh - oh); // vertical offset of same block (overlap)
+
+  float *inp = inp0;
+  //	char debugbuf[1536];
+  //	sprintf(debugbuf,"FFT3DFilter: InitOverlapPlane");
+  //	OutputDebugString(debugbuf);
+  using cast_t = typename std::conditional<sizeof(pixel_t) == 4, float, int>::type;
+  // for float: chroma center is also 0.0
+  constexpr cast_t planeBase = sizeof(pixel_t) == 4 ? 0 : cast_t(chroma ? (1 << (bits_per_pixel - 1)) : 0); // anti warning
+
+  if (ihy_from == 0) // first top (big non-overlapped) part
+  {
+    for (h = 0; h < oh; h++)
+    {
+      inp = inp0 + h*bw;
+      line = GetCoverLine(src, y++, tailblock, edge.data());
+      srcp = line.head;
+      for (w = 0; w < ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(wanxl[w] * wanyl[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw - ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(wanyl[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+      }
+      inp += bw - ow;
+      srcp = line.body;
+      for (ihx = 1; ihx < nox; ihx += 1) // middle horizontal blocks
+      {
+        if (ihx == tailblock)
+          srcp = line.tail;
+        for (w = 0; w < ow; w++)   // first part (overlapped) row of block
+        {
+          ftmp = float(wanyl[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w]; // cur block
+          inp[w + xoffset] = ftmp *wanxl[w];   // overlapped Copy - next block
+        }
+        inp += ow;
+        inp += xoffset;
+        srcp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // center part  (non-overlapped) row of first block
+        {
+          inp[w] = float(wanyl[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+        }
+        inp += bw - ow - ow;
+        srcp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        srcp = line.tail;
+      for (w = 0; w < ow; w++)   // last part (non-overlapped) of line of last block
+      {
+        inp[w] = float(wanxr[w] * wanyl[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+      }
+      inp += ow;
+    }
+    for (h = oh; h < bh - oh; h++)
+    {
+      inp = inp0 + h*bw;
+      line = GetCoverLine(src, y++, tailblock, edge.data());
+      srcp = line.head;
+      for (w = 0; w < ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(wanxl[w] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw - ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+      }
+      inp += bw - ow;
+      srcp = line.body;
+      for (ihx = 1; ihx < nox; ihx += 1) // middle horizontal blocks
+      {
+        if (ihx == tailblock)
+          srcp = line.tail;
+        for (w = 0; w < ow; w++)   // first part (overlapped) row of block
+        {
+          ftmp = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w]; // cur block
+          inp[w + xoffset] = ftmp *wanxl[w];   // overlapped Copy - next block
+        }
+        inp += ow;
+        inp += xoffset;
+        srcp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // center part  (non-overlapped) row of first block
+        {
+          inp[w] = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+        }
+        inp += bw - ow - ow;
+        srcp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        srcp = line.tail;
+      for (w = 0; w < ow; w++)   // last part (non-overlapped) line of last block
+      {
+        inp[w] = float(wanxr[w] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+      }
+      inp += ow;
+
+    }
+  }
+
+  for (ihy = std::max(ihy_from, 1); ihy < noy && ihy <= ihy_to; ihy += 1) // middle vertical
+  {
+    for (h = 0; h < oh; h++) // top overlapped part
+    {
+      inp = inp0 + (ihy - 1)*(yoffset + (bh - oh)*bw) + (bh - oh)*bw + h*bw;
+      line = GetCoverLine(src, y++, tailblock, edge.data());
+      srcp = line.head;
+      for (w = 0; w < ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanxl[w] * (srcp[w] - planeBase));
+        inp[w] = ftmp*wanyr[h];   // Copy each byte from source to float array
+        inp[w + yoffset] = ftmp*wanyl[h];   // y overlapped
+      }
+      for (w = ow; w < bw - ow; w++)   // first half line of first block
+      {
+        ftmp = float((srcp[w] - planeBase));
+        inp[w] = ftmp*wanyr[h];   // Copy each byte from source to float array
+        inp[w + yoffset] = ftmp*wanyl[h];   // y overlapped
+      }
+      inp += bw - ow;
+      srcp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle blocks
+      {
+        if (ihx == tailblock)
+          srcp = line.tail;
+        for (w = 0; w < ow; w++)   // half overlapped line of block
+        {
+          ftmp = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w] * wanyr[h];
+          inp[w + xoffset] = ftmp *wanxl[w] * wanyr[h];   // x overlapped
+          inp[w + yoffset] = ftmp * wanxr[w] * wanyl[h];
+          inp[w + xoffset + yoffset] = ftmp *wanxl[w] * wanyl[h];   // x overlapped
+        }
+        inp += ow;
+        inp += xoffset;
+        srcp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // half non-overlapped line of block
+        {
+          ftmp = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp * wanyr[h];
+          inp[w + yoffset] = ftmp * wanyl[h];
+        }
+        inp += bw - ow - ow;
+        srcp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        srcp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        ftmp = float(wanxr[w] * (srcp[w] - planeBase));// Copy each byte from source to float array
+        inp[w] = ftmp*wanyr[h];
+        inp[w + yoffset] = ftmp*wanyl[h];
+      }
+      inp += ow;
+
+    }
+    // middle  vertical nonovelapped part
+    for (h = 0; h < bh - oh - oh; h++)
+    {
+      inp = inp0 + (ihy - 1)*(yoffset + (bh - oh)*bw) + (bh)*bw + h*bw + yoffset;
+      line = GetCoverLine(src, y++, tailblock, edge.data());
+      srcp = line.head;
+      for (w = 0; w < ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanxl[w] * (srcp[w] - planeBase));
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw - ow; w++)   // first half line of first block
+      {
+        ftmp = float((srcp[w] - planeBase));
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      inp += bw - ow;
+      srcp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle blocks
+      {
+        if (ihx == tailblock)
+          srcp = line.tail;
+        for (w = 0; w < ow; w++)   // half overlapped line of block
+        {
+          ftmp = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w];
+          inp[w + xoffset] = ftmp *wanxl[w];   // x overlapped
+        }
+        inp += ow;
+        inp += xoffset;
+        srcp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // half non-overlapped line of block
+        {
+          ftmp = float((srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp;
+        }
+        inp += bw - ow - ow;
+        srcp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        srcp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        ftmp = float(wanxr[w] * (srcp[w] - planeBase));// Copy each byte from source to float array
+        inp[w] = ftmp;
+      }
+      inp += ow;
+
+    }
+
+  }
+
+  if (ihy_to >= noy) // last bottom  part
+  {
+    ihy = noy;
+    for (h = 0; h < oh; h++)
+    {
+      inp = inp0 + (ihy - 1)*(yoffset + (bh - oh)*bw) + (bh - oh)*bw + h*bw;
+      line = GetCoverLine(src, y++, tailblock, edge.data());
+      srcp = line.head;
+      for (w = 0; w < ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanxl[w] * wanyr[h] * (srcp[w] - planeBase));
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw - ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanyr[h] * (srcp[w] - planeBase));
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      inp += bw - ow;
+      srcp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle blocks
+      {
+        if (ihx == tailblock)
+          srcp = line.tail;
+        for (w = 0; w < ow; w++)   // half line of block
+        {
+          float ftmp = float(wanyr[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w];
+          inp[w + xoffset] = ftmp *wanxl[w];   // overlapped Copy
+        }
+        inp += ow;
+        inp += xoffset;
+        srcp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // center part  (non-overlapped) row of first block
+        {
+          inp[w] = float(wanyr[h] * (srcp[w] - planeBase));   // Copy each byte from source to float array
+        }
+        inp += bw - ow - ow;
+        srcp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        srcp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        ftmp = float(wanxr[w] * wanyr[h] * (srcp[w] - planeBase));
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      inp += ow;
+
+    }
+
+  }
+}
+/*
+//-----------------------------------------------------------------------
+// create multiple windows for overlapped blocks
+//
+void Engine::InitFullWin(float * inp0, float *wanxl, float *wanxr, float *wanyl, float *wanyr)
+{
+  int w,h;
+  int ihx,ihy;
+  float ftmp;
+  int xoffset = bh*bw - (bw-ow); // skip frames
+  int yoffset = bw*nox*bh - bw*(bh-oh); // vertical offset of same block (overlap)
+
+  float *inp = inp0;
+//	char debugbuf[1536];
+//	sprintf(debugbuf,"FFT3DFilter: InitOverlapPlane");
+//	OutputDebugString(debugbuf);
+
+  ihy =0; // first top (big non-overlapped) part
+  {
+    for (h=0; h < oh; h++)
+    {
+      inp = inp0 + h*bw;
+      for (w = 0; w < ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(wanxl[w]*wanyl[h]);   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw-ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(wanyl[h]);   // Copy each byte from source to float array
+      }
+      inp += bw-ow;
+      for (ihx =1; ihx < nox; ihx+=1) // middle horizontal blocks
+      {
+        for (w = 0; w < ow; w++)   // first part (overlapped) row of block
+        {
+          ftmp = float(wanyl[h]);   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w]; // cur block
+          inp[w+xoffset] = ftmp *wanxl[w];   // overlapped Copy - next block
+        }
+        inp += ow;
+        inp += xoffset;
+        for (w = 0; w < bw-ow-ow; w++)   // center part  (non-overlapped) row of first block
+        {
+          inp[w] = float(wanyl[h]);   // Copy each byte from source to float array
+        }
+        inp += bw-ow-ow;
+      }
+      for (w = 0; w < ow; w++)   // last part (non-overlapped) of line of last block
+      {
+        inp[w] = float(wanxr[w]*wanyl[h]);   // Copy each byte from source to float array
+      }
+      inp += ow;
+    }
+    for (h=oh; h < bh-oh; h++)
+    {
+      inp = inp0 + h*bw;
+      for (w = 0; w < ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(wanxl[w]);   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw-ow; w++)   // left part  (non-overlapped) row of first block
+      {
+        inp[w] = float(1);   // Copy each byte from source to float array
+      }
+      inp += bw-ow;
+      for (ihx =1; ihx < nox; ihx+=1) // middle horizontal blocks
+      {
+        for (w = 0; w < ow; w++)   // first part (overlapped) row of block
+        {
+          ftmp = float(1);   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w]; // cur block
+          inp[w+xoffset] = ftmp *wanxl[w];   // overlapped Copy - next block
+        }
+        inp += ow;
+        inp += xoffset;
+        for (w = 0; w < bw-ow-ow; w++)   // center part  (non-overlapped) row of first block
+        {
+          inp[w] = float(1);   // Copy each byte from source to float array
+        }
+        inp += bw-ow-ow;
+      }
+      for (w = 0; w < ow; w++)   // last part (non-overlapped) line of last block
+      {
+        inp[w] = float(wanxr[w]);   // Copy each byte from source to float array
+      }
+      inp += ow;
+
+    }
+  }
+
+  for (ihy =1; ihy < noy; ihy+=1 ) // middle vertical
+  {
+    for (h=0; h < oh; h++) // top overlapped part
+    {
+      inp = inp0 + (ihy-1)*(yoffset + (bh-oh)*bw) + (bh-oh)*bw + h*bw;
+      for (w = 0; w < ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanxl[w]);
+        inp[w] = ftmp*wanyr[h];   // Copy each byte from source to float array
+        inp[w+yoffset] = ftmp*wanyl[h];   // y overlapped
+      }
+      for (w = ow; w < bw-ow; w++)   // first half line of first block
+      {
+        ftmp = float(1);
+        inp[w] = ftmp*wanyr[h];   // Copy each byte from source to float array
+        inp[w+yoffset] = ftmp*wanyl[h];   // y overlapped
+      }
+      inp += bw-ow;
+      for (ihx =1; ihx < nox; ihx++) // middle blocks
+      {
+        for (w = 0; w < ow; w++)   // half overlapped line of block
+        {
+          ftmp = float(1);   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w]*wanyr[h];
+          inp[w+xoffset] = ftmp *wanxl[w]*wanyr[h];   // x overlapped
+          inp[w+yoffset] = ftmp * wanxr[w]*wanyl[h];
+          inp[w+xoffset+yoffset] = ftmp *wanxl[w]*wanyl[h];   // x overlapped
+        }
+        inp += ow;
+        inp += xoffset;
+        for (w = 0; w < bw-ow-ow; w++)   // half non-overlapped line of block
+        {
+          ftmp = float(1);   // Copy each byte from source to float array
+          inp[w] = ftmp * wanyr[h];
+          inp[w+yoffset] = ftmp * wanyl[h];
+        }
+        inp +=  bw-ow-ow;
+      }
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        ftmp = float(wanxr[w]);// Copy each byte from source to float array
+        inp[w] = ftmp*wanyr[h];
+        inp[w+yoffset] = ftmp*wanyl[h];
+      }
+      inp += ow;
+    }
+    // middle  vertical nonovelapped part
+    for (h=0; h < bh-oh-oh; h++)
+    {
+      inp = inp0 + (ihy-1)*(yoffset + (bh-oh)*bw) + (bh)*bw + h*bw +yoffset;
+      for (w = 0; w < ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanxl[w]);
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw-ow; w++)   // first half line of first block
+      {
+        ftmp = float(1);
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      inp += bw-ow;
+      for (ihx =1; ihx < nox; ihx++) // middle blocks
+      {
+        for (w = 0; w < ow; w++)   // half overlapped line of block
+        {
+          ftmp = float(1);   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w];
+          inp[w+xoffset] = ftmp *wanxl[w];   // x overlapped
+        }
+        inp += ow;
+        inp += xoffset;
+        for (w = 0; w < bw-ow-ow; w++)   // half non-overlapped line of block
+        {
+          ftmp = float(1);   // Copy each byte from source to float array
+          inp[w] = ftmp ;
+        }
+        inp +=  bw-ow-ow;
+      }
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        ftmp = float(wanxr[w]);// Copy each byte from source to float array
+        inp[w] = ftmp;
+      }
+      inp += ow;
+    }
+
+  }
+
+  ihy = noy ; // last bottom  part
+  {
+    for (h=0; h < oh; h++)
+    {
+      inp = inp0 + (ihy-1)*(yoffset + (bh-oh)*bw) + (bh-oh)*bw + h*bw ;
+      for (w = 0; w < ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanxl[w]*wanyr[h]);
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      for (w = ow; w < bw-ow; w++)   // first half line of first block
+      {
+        ftmp = float(wanyr[h]);
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      inp += bw-ow;
+      for (ihx =1; ihx < nox; ihx++) // middle blocks
+      {
+        for (w = 0; w < ow; w++)   // half line of block
+        {
+          float ftmp = float(wanyr[h]);   // Copy each byte from source to float array
+          inp[w] = ftmp * wanxr[w];
+          inp[w+xoffset] = ftmp *wanxl[w];   // overlapped Copy
+        }
+        inp += ow;
+        inp += xoffset;
+        for (w = 0; w < bw-ow-ow; w++)   // center part  (non-overlapped) row of first block
+        {
+          inp[w] = float(wanyr[h]);   // Copy each byte from source to float array
+        }
+        inp += bw-ow-ow;
+      }
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        ftmp = float(wanxr[w]*wanyr[h]);
+        inp[w] = ftmp;   // Copy each byte from source to float array
+      }
+      inp += ow;
+    }
+
+  }
+}
+
+void FillBlock(float * inp, float * fullwin, const BYTE *srcp, int bw, int bh, int src_pitch, int planeBase)
+{
+  for (int h=0; h < bh; h++)
+  {
+    for (int w = 0; w < bw; w++)
+    {
+      // Copy each byte from source to float array and multiply by window
+      inp[w] =  fullwin[w]*float((srcp[w]-planeBase));
+    }
+    inp += bw;
+    fullwin += bw;
+    srcp += src_pitch;
+  }
+}
+
+void FillBlock_sse(float * inp, float * fullwin, const BYTE *srcp, int bw, int blockh, int src_pitch, int planeBase)
+{
+//	int w, h;
+//	for (h=0; h < bh; h++)
+//	{
+//		for (w = 0; w < bw; w++)
+//		{
+  _asm
+  {
+    pxor mm7, mm7; // 0
+    movd mm6, planeBase;
+    cvtpi2ps xmm7, mm6; // convert 2 int to 2 float to low qword
+    shufps xmm7, xmm7, 0 // form 4 doubleword
+    mov esi, srcp;
+    mov edx, fullwin;
+    mov edi, inp;
+    mov ecx, bw;
+    mov ebx, blockh;
+    mov eax, 0;
+
+
+align 16
+next4bytes:
+      movd mm0, [esi]; // read 4 source bytes
+      punpcklbw mm0, mm7; // to 4 words
+      movq mm1, mm0; // copy
+      punpcklbw mm0, mm7; // first 2 bytes to 2 integer
+      punpckhbw mm1, mm7; // second 2 bytes to 2 integer
+      cvtpi2ps xmm0, mm0; // convert 2 int to 2 float to low qword
+      cvtpi2ps xmm1, mm1; // convert 2 int to 2 float to low qword
+      shufps xmm0, xmm1, 4+64; // form 4 doubleword
+      subps xmm0, xmm7; // subtract planebase
+      movaps xmm1, [edx]; // 4 fullwin
+      mulps xmm0, xmm1;
+      movaps [edi], xmm0;
+      add eax, 4;
+      cmp eax, ecx;
+      jg nextline;
+      add edx, 16;
+      add edi, 16;
+      add esi, 4;
+      jmp next4bytes
+nextline:
+      dec ebx;
+      jz finish;
+      mov eax, src_pitch;
+      add esi, eax;
+      sub esi, ecx;
+      mov eax, 0;
+      jmp next4bytes
+
+//			inp[w] =  fullwin[w]*float((srcp[w]-planeBase));
+      // Copy each byte from source to float array and multiply by window
+//		}
+//		inp += bw;
+//		fullwin += bw;
+//		srcp += src_pitch;
+finish:
+  }
+}
+
+//-----------------------------------------------------------------------
+// put source bytes to float array of overlapped blocks
+// use analysis windows
+//
+void Engine::InitOverlapPlaneWin(float * inp, const BYTE *srcp, int src_pitch, int planeBase, float * fullwin)
+{
+  int ihx,ihy;
+
+  int bwbh = bw*bh;
+
+    if ((CPUFlags & CPUF_SSE) && (bw%4 == 0) && (bwbh%16 == 0))
+    {
+        for (ihy =0; ihy < noy; ihy+=1 ) //  vertical
+        {
+            for (ihx =0; ihx < nox; ihx++) //  blocks
+            {
+                FillBlock_sse(inp, fullwin, srcp, bw, bh, src_pitch, planeBase);
+                inp += bwbh;
+                fullwin += bwbh;
+                srcp += bw-ow;
+            }
+            srcp += (bh-oh)*src_pitch - nox*(bw-ow);
+        }
+        _asm emms;
+  }
+  else
+    {
+        for (ihy =0; ihy < noy; ihy+=1 ) //  vertical
+        {
+            for (ihx =0; ihx < nox; ihx++) //  blocks
+            {
+                FillBlock(inp, fullwin, srcp, bw, bh, src_pitch, planeBase);
+                inp += bwbh;
+                fullwin += bwbh;
+                srcp += bw-ow;
+            }
+            srcp += (bh-oh)*src_pitch - nox*(bw-ow);
+        }
+    }
+}
+*/
+//
+//-----------------------------------------------------------------------------------------
+// make destination frame plane from overlaped blocks
+// use synthesis windows wsynxl, wsynxr, wsynyl, wsynyr
+FFT3D_NOINLINE void Engine::DecodeOverlapPlane(float *inp0, float norm, const CoverPlane &dst, bool chroma, int ihy_from, int ihy_to)
+{
+  PROFILE_STAGE(STAGE_DECODE);
+  ScopedTimer timer(StatTimer(fstats.decodens));
+  if (ihy_to < 0)
+    ihy_to = noy;
+  if (chroma) {
+    switch (bits_per_pixel) {
+    case 8: do_DecodeOverlapPlane<uint8_t, 8, true>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 10: do_DecodeOverlapPlane<uint16_t, 10, true>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 12: do_DecodeOverlapPlane<uint16_t, 12, true>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 14: do_DecodeOverlapPlane<uint16_t, 14, true>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 16: do_DecodeOverlapPlane<uint16_t, 16, true>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 32: do_DecodeOverlapPlane<float, 8 /*n/a*/, true>(inp0, norm, dst, ihy_from, ihy_to); break;
+    }
+  }
+  else {
+    switch (bits_per_pixel) {
+    case 8: do_DecodeOverlapPlane<uint8_t, 8, false>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 10: do_DecodeOverlapPlane<uint16_t, 10, false>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 12: do_DecodeOverlapPlane<uint16_t, 12, false>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 14: do_DecodeOverlapPlane<uint16_t, 14, false>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 16: do_DecodeOverlapPlane<uint16_t, 16, false>(inp0, norm, dst, ihy_from, ihy_to); break;
+    case 32: do_DecodeOverlapPlane<float, 8 /*n/a*/, false>(inp0, norm, dst, ihy_from, ihy_to); break;
+    }
+  }
+}
+
+template<typename pixel_t, int bits_per_pixel, bool chroma>
+void Engine::do_DecodeOverlapPlane(float *inp0, float norm, const CoverPlane &dst, int ihy_from, int ihy_to)
+{
+  int w, h;
+  int ihx, ihy;
+  pixel_t *dstp;
+  // v2.11: the destination rows are fetched by cover row, rows and pixels of the mirrored borders are not stored
+  int y = ihy_from * (bh - oh); // first line of the first requested stripe
+  int tailblock = CoverTail(dst);
+  std::vector<pixel_t> edge(mirw + std::max(0, coverwidth - tailblock * (bw - ow)));
+  CoverLine<pixel_t> line;
+  float *inp = inp0;
+  int xoffset = bh*bw - (bw - ow);
+  int yoffset = bw*nox*bh - bw*(bh - oh); // vertical offset of same block (overlap)
+  using cast_t = typename std::conditional<sizeof(pixel_t) == 4, float, int>::type;
+
+  constexpr float rounder = sizeof(pixel_t) == 4 ? 0.0f : 0.5f; // v2.6
+
+  // for float: chroma center is also 0.0
+  constexpr cast_t planeBase = sizeof(pixel_t) == 4 ? cast_t(0) : cast_t(chroma ? (1 << (bits_per_pixel-1)) : 0); // anti warning
+
+  // Though float is not clamped.
+  constexpr cast_t min_pixel_value = sizeof(pixel_t) == 4 ? cast_t(chroma ? -0.5f : 0.0f) : (cast_t)(0);
+  constexpr cast_t max_pixel_value = sizeof(pixel_t) == 4 ? cast_t(chroma ? 0.5f : 1.0f) : (cast_t)((1 << bits_per_pixel) - 1);
+
+  if (ihy_from == 0) // first top big non-overlapped) part
+  {
+    for (h = 0; h < bh - oh; h++)
+    {
+      inp = inp0 + h*bw;
+      line = PutCoverLine(dst, y++, edge.data());
+      if (line.head == nullptr) // outside of the plane
+        continue;
+      dstp = line.head;
+      for (w = 0; w < bw - ow; w++)   // first half line of first block
+      {
+        // Copy each byte from float array to dest with windows
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * norm;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w] * norm + rounder + planeBase)));
+      }
+      inp += bw - ow;
+      dstp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle horizontal half-blocks
+      {
+        if (ihx == tailblock)
+          dstp = line.tail;
+        for (w = 0; w < ow; w++)   // half line of block
+        { 
+          // overlapped Copy
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = (inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w]) * norm;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)((inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w])*norm + rounder + planeBase)));   // overlapped Copy
+        }
+        inp += xoffset + ow;
+        dstp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // first half line of first block
+        {
+          // Copy each byte from float array to dest with windows
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = inp[w] * norm;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w] * norm + rounder + planeBase)));
+        }
+        inp += bw - ow - ow;
+        dstp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        dstp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * norm;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w] * norm + rounder + planeBase)));
+      }
+      inp += ow;
+      PutCoverTail(dst, line, tailblock, edge.data());
+    }
+  }
+
+  for (ihy = std::max(ihy_from, 1); ihy < noy && ihy <= ihy_to; ihy += 1) // middle vertical
+  {
+    for (h = 0; h < oh; h++) // top overlapped part
+    {
+      inp = inp0 + (ihy - 1)*(yoffset + (bh - oh)*bw) + (bh - oh)*bw + h*bw;
+      line = PutCoverLine(dst, y++, edge.data());
+      if (line.head == nullptr) // outside of the plane
+        continue;
+      dstp = line.head;
+
+      float wsynyrh = wsynyr[h] * norm; // remove from cycle for speed
+      float wsynylh = wsynyl[h] * norm;
+
+      for (w = 0; w < bw - ow; w++)   // first half line of first block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * wsynyrh + inp[w + yoffset] * wsynylh;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)((inp[w] * wsynyrh + inp[w + yoffset] * wsynylh) + rounder)+ planeBase));   // y overlapped
+      }
+      inp += bw - ow;
+      dstp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle blocks
+      {
+        if (ihx == tailblock)
+          dstp = line.tail;
+        for (w = 0; w < ow; w++)   // half overlapped line of block
+        {
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = (inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w]) * wsynyrh
+              + (inp[w + yoffset] * wsynxr[w] + inp[w + xoffset + yoffset] * wsynxl[w]) * wsynylh;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(((inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w])*wsynyrh
+            + (inp[w + yoffset] * wsynxr[w] + inp[w + xoffset + yoffset] * wsynxl[w])*wsynylh) + rounder + planeBase)));   // x overlapped
+        }
+        inp += xoffset + ow;
+        dstp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // double minus - half non-overlapped line of block
+        {
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = inp[w] * wsynyrh + inp[w + yoffset] * wsynylh;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)((inp[w] * wsynyrh + inp[w + yoffset] * wsynylh) + rounder + planeBase)));
+        }
+        inp += bw - ow - ow;
+        dstp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        dstp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * wsynyrh + inp[w + yoffset] * wsynylh;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(0, (cast_t)((inp[w] * wsynyrh + inp[w + yoffset] * wsynylh) + rounder + planeBase)));
+      }
+      inp += ow;
+      PutCoverTail(dst, line, tailblock, edge.data());
+    }
+    // middle  vertical non-ovelapped part
+    for (h = 0; h < (bh - oh - oh); h++)
+    {
+      inp = inp0 + (ihy - 1)*(yoffset + (bh - oh)*bw) + (bh)*bw + h*bw + yoffset;
+      line = PutCoverLine(dst, y++, edge.data());
+      if (line.head == nullptr) // outside of the plane
+        continue;
+      dstp = line.head;
+      for (w = 0; w < bw - ow; w++)   // first half line of first block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * norm;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)((inp[w])*norm + rounder + planeBase)));
+      }
+      inp += bw - ow;
+      dstp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle blocks
+      {
+        if (ihx == tailblock)
+          dstp = line.tail;
+        for (w = 0; w < ow; w++)   // half overlapped line of block
+        {
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = (inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w]) * norm;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)((inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w])*norm + rounder + planeBase)));   // x overlapped
+        }
+        inp += xoffset + ow;
+        dstp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // half non-overlapped line of block
+        {
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = inp[w] * norm;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w]*norm + rounder + planeBase)));
+        }
+        inp += bw - ow - ow;
+        dstp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        dstp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * norm;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w]*norm + rounder + planeBase)));
+      }
+      inp += ow;
+      PutCoverTail(dst, line, tailblock, edge.data());
+    }
+
+  }
+
+  if (ihy_to >= noy) // last bottom part
+  {
+    ihy = noy;
+    for (h = 0; h < oh; h++)
+    {
+      inp = inp0 + (ihy - 1)*(yoffset + (bh - oh)*bw) + (bh - oh)*bw + h*bw;
+      line = PutCoverLine(dst, y++, edge.data());
+      if (line.head == nullptr) // outside of the plane
+        continue;
+      dstp = line.head;
+      for (w = 0; w < bw - ow; w++)   // first half line of first block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * norm;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w] * norm + rounder + planeBase)));
+      }
+      inp += bw - ow;
+      dstp = line.body;
+      for (ihx = 1; ihx < nox; ihx++) // middle blocks
+      {
+        if (ihx == tailblock)
+          dstp = line.tail;
+        for (w = 0; w < ow; w++)   // half line of block
+        {
+          // overlapped Copy
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = (inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w]) * norm;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)((inp[w] * wsynxr[w] + inp[w + xoffset] * wsynxl[w])*norm + rounder + planeBase)));
+        }
+        inp += xoffset + ow;
+        dstp += ow;
+        for (w = 0; w < bw - ow - ow; w++)   // half line of block
+        {
+          if constexpr (sizeof(pixel_t) == 4)
+            dstp[w] = inp[w] * norm;
+          else
+            dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w]*norm + rounder + planeBase)));
+        }
+        inp += bw - ow - ow;
+        dstp += bw - ow - ow;
+      }
+      if (tailblock == nox)
+        dstp = line.tail;
+      for (w = 0; w < ow; w++)   // last half line of last block
+      {
+        if constexpr (sizeof(pixel_t) == 4)
+          dstp[w] = inp[w] * norm;
+        else
+          dstp[w] = std::min(max_pixel_value, std::max(min_pixel_value, (cast_t)(inp[w] * norm + rounder + planeBase)));
+      }
+      inp += ow;
+      PutCoverTail(dst, line, tailblock, edge.data());
+    }
+  }
+}
+
+//-------------------------------------------------------------------------------------------
+// FFT of the current frame, timed with stats=true - v2.11
+FFT3D_NOINLINE void Engine::ForwardFFT(fftwf_plan p, float *src, fftwf_complex *dst)
+{
+  PROFILE_STAGE(STAGE_FFT);
+  ScopedTimer timer(StatTimer(fstats.fftns));
+  fftfp.fftwf_execute_dft_r2c(p, src, dst);
+}
+
+FFT3D_NOINLINE void Engine::InverseFFT(fftwf_plan p, fftwf_complex *src, float *dst)
+{
+  PROFILE_STAGE(STAGE_IFFT);
+  ScopedTimer timer(StatTimer(fstats.fftns));
+  fftfp.fftwf_execute_dft_c2r(p, src, dst);
+}
+
+// Frame k of the source - v2.11
+FFT3D_NOINLINE Plane Engine::Source(int k)
+{
+  PROFILE_STAGE(STAGE_SOURCE);
+  return source->GetPlane(k);
+}
+
+// Sharpen or Sharpen_degrid of 'blocks' blocks - v2.11
+FFT3D_NOINLINE void Engine::SharpenBlocks(fftwf_complex *outp, int blocks)
+{
+  PROFILE_STAGE(STAGE_SHARPEN);
+  if (degrid != 0)
+    Sharpen_degrid(outp, outwidth, outpitch, bh, blocks, sharpen, sigmaSquaredSharpenMinNormed, sigmaSquaredSharpenMaxNormed, wsharpen, degrid, gridsample, dehalo, wdehalo, ht2n, CPUFlags);
+  else
+    Sharpen(outp, outwidth, outpitch, bh, blocks, sharpen, sigmaSquaredSharpenMinNormed, sigmaSquaredSharpenMaxNormed, wsharpen, dehalo, wdehalo, ht2n, CPUFlags);
+}
+
+//-------------------------------------------------------------------------------------------
+// removemean: window weighted block means of 'blocks' blocks at inp to blockmean, before the forward FFT - v2.11
+void Engine::SubtractMeans(float *inp, int blocks, float *blockmean)
+{
+  if (removemean)
+    GetAndSubtractMean(inp, blocks, bw * bh, wanblock, meannorm, blockmean, CPUFlags);
+}
+
+// and back after the inverse FFT, which scales by bw*bh
+void Engine::RestoreMeans(float *inp, int blocks, const float *blockmean)
+{
+  if (removemean)
+    RestoreMean(inp, blocks, bw * bh, wanblock, (float)(bw * bh), blockmean, CPUFlags);
+}
+
+//-------------------------------------------------------------------------------------------
+// bt=0 (Kalman) processing of a frame plane, using all threads of the pool - v2.11
+// Stripes of the cover are independent for the overlap coding, block rows are independent
+// for FFT, Kalman, sharpen and inverse FFT. Must not use the source, only the main thread may.
+void Engine::KalmanRowParallel(const CoverPlane &src, const CoverPlane &dst, bool plane_is_chroma)
+{
+  // put source bytes to float array of overlapped blocks
+  pool->parallel_for(noy + 1, [&](int ihy) {
+    InitOverlapPlane(in, src, plane_is_chroma, ihy, ihy);
+  });
+
+  pool->parallel_for(noy, [&](int row) {
+    float *inrow = in + row * nox * bw * bh;
+    int offset = row * nox * outpitch * bh;
+    fftwf_complex *outrezrow = outrez + offset;
+    SubtractMeans(inrow, nox, mean + row * nox);
+    // make FFT 2D
+    ForwardFFT(planrow, inrow, outrezrow);
+    {
+      ScopedTimer timer(StatTimer(fstats.kernelns));
+      {
+        PROFILE_STAGE(STAGE_KERNEL);
+        if (pfactor != 0)
+          ApplyKalmanPattern(outrezrow, outLast + offset, covar + offset, covarProcess + offset, outwidth, outpitch, bh, nox, pattern2d, kratio*kratio, CPUFlags);
+        else
+          ApplyKalman(outrezrow, outLast + offset, covar + offset, covarProcess + offset, outwidth, outpitch, bh, nox, sigmaSquaredNoiseNormed2D, kratio*kratio, CPUFlags);
+        // copy outLast to outrez
+        memcpy(outrezrow, outLast + offset, nox * outpitch * bh * sizeof(fftwf_complex));
+      }
+      SharpenBlocks(outrezrow, nox);
+    }
+    // do inverse FFT 2D, get filtered 'in' array
+    InverseFFT(planinvrow, outrezrow, inrow);
+    RestoreMeans(inrow, nox, mean + row * nox);
+  });
+
+  // make destination frame plane from current overlaped blocks
+  pool->parallel_for(noy + 1, [&](int ihy) {
+    DecodeOverlapPlane(in, norm, dst, plane_is_chroma, ihy, ihy);
+  });
+}
+
+//-------------------------------------------------------------------------------------------
+// Processing by strips of block rows (membudget) - v2.11
+// Block row r of the strip starting at row r0 is row 1+r-r0 of 'in'.
+
+// Spectrum of block rows r0..r1-1 of the src plane to dst, their block means to dstmean.
+// Stripe r0 also writes a part of row r0-1 of 'in', stripe r1 a part of row r1.
+void Engine::StripSpectrum(const CoverPlane &src, int r0, int r1, fftwf_complex *dst, float *dstmean, bool plane_is_chroma)
+{
+  int inrow = nox * bw * bh;
+  float *inp0 = in + (1 - r0) * inrow; // position of block row 0
+  InitOverlapPlane(inp0, src, plane_is_chroma, r0, r1);
+  for (int row = r0; row < r1; row++)
+  {
+    SubtractMeans(inp0 + row * inrow, nox, dstmean + (row - r0) * nox);
+    ForwardFFT(planrow, inp0 + row * inrow, dst + (row - r0) * nox * outpitch * bh);
+  }
+}
+
+// For each strip filter(r0, r1) has to leave the filtered spectrum of block rows r0..r1-1
+// in outrez, it is transformed back and decoded to the dst plane stripe by stripe.
+// Stripe r is decoded from block rows r-1 and r, so the last row of a strip is kept for the next one.
+// means: block means of the whole frame.
+void Engine::ProcessStrips(const CoverPlane &dst, const float *means, bool plane_is_chroma, const std::function<void(int, int)>& filter)
+{
+  int inrow = nox * bw * bh;
+  for (int r0 = 0; r0 < noy; r0 += striprows)
+  {
+    int r1 = std::min(r0 + striprows, noy);
+    float *inp0 = in + (1 - r0) * inrow;
+    filter(r0, r1);
+    for (int row = r0; row < r1; row++)
+    {
+      InverseFFT(planinvrow, outrez + (row - r0) * nox * outpitch * bh, inp0 + row * inrow);
+      RestoreMeans(inp0 + row * inrow, nox, means + row * nox);
+    }
+    if (r0 > 0)
+      memcpy(inp0 + (r0 - 1) * inrow, inrowsave, inrow * sizeof(float));
+    DecodeOverlapPlane(inp0, norm, dst, plane_is_chroma, r0, r1 < noy ? r1 - 1 : noy);
+    memcpy(inrowsave, inp0 + (r1 - 1) * inrow, inrow * sizeof(float));
+  }
+}
+
+//-------------------------------------------------------------------------------------------
+// Makes all spectra of the temporal window n-btcur/2..n+(btcur-1)/2 which are missing
+// from the ring cache - v2.11
+// Frames are fetched one by one on the calling thread, then windowing and FFT of the frames
+// run in parallel. On sequential access at most one spectrum is missing, that is left to
+// the usual code (which uses the fftw threads of the whole frame plan).
+void Engine::FillCacheBatch(int n, int btcur, const Plane &src, bool plane_is_chroma)
+{
+  int missing[5];
+  int count = 0;
+  for (int k = halfcache ? n : n - btcur / 2; k <= n + (btcur - 1) / 2; k++) // halfcache: not the past frames
+    if (cachewhat[k % cachesize] != k)
+      missing[count++] = k;
+  if (count < 2)
+    return;
+
+  if (!batcharena.allocated()) // only needed after seeks
+  {
+    for (int i = 0; i < bt; i++)
+      batcharena.reserve(inbatch[i], bw * bh * nox * noy);
+    batcharena.set_hugepages(hugepages);
+    if (!batcharena.allocate())
+      throw Error("FFT3DFilter: out of memory");
+  }
+
+  Plane frames[5];
+  CoverPlane covers[5];
+  for (int i = 0; i < count; i++)
+  {
+    frames[i] = missing[i] == n ? src : Source(missing[i]);
+    covers[i] = CoverIn(frames[i]);
+  }
+
+  pool->parallel_for(count, [&](int i) {
+    InitOverlapPlane(inbatch[i], covers[i], plane_is_chroma);
+    SubtractMeans(inbatch[i], howmanyblocks, cachemean[missing[i] % cachesize]);
+    ForwardFFT(planframe, inbatch[i], cachefft[missing[i] % cachesize]);
+  });
+
+  for (int i = 0; i < count; i++)
+    cachewhat[missing[i] % cachesize] = missing[i];
+}
+
+// Spectrum of frame k from the ring cache, made if it is not there - v2.11
+// k is in the temporal window of the current frame n, whose source frame is src.
+fftwf_complex *Engine::CachedSpectrum(int k, int n, const Plane &src, bool plane_is_chroma)
+{
+  int slot = k % cachesize;
+  if (cachewhat[slot] != k)
+  {
+    Plane frame = k == n ? src : Source(k);
+    CoverPlane cover = CoverIn(frame);
+    if (striprows > 0)
+    {
+      for (int r0 = 0; r0 < noy; r0 += striprows)
+        StripSpectrum(cover, r0, std::min(r0 + striprows, noy), cachefft[slot] + r0 * nox * outpitch * bh, cachemean[slot] + r0 * nox, plane_is_chroma);
+    }
+    else
+    {
+      Engine::InitOverlapPlane(in, cover, plane_is_chroma);
+      SubtractMeans(in, howmanyblocks, cachemean[slot]);
+      // make FFT 2D
+      ForwardFFT(plan, in, cachefft[slot]);
+    }
+    cachewhat[slot] = k;
+  }
+  return cachefft[slot];
+}
+
+// FP16 spectrum of the past frame k (k < current frame) from the half cache - v2.11
+// If it is not there, it is packed from the float ring or made anew. Must be called before
+// the float ring is updated for the current frame, which may reuse the slot of frame k.
+const uint16_t *Engine::CachedHalf(int k, bool plane_is_chroma)
+{
+  int slot = k % halfsize;
+  if (halfwhat[slot] != k)
+  {
+    if (cachewhat[k % cachesize] == k)
+      SpectrumToHalf(cachefft[k % cachesize], cachehalf[slot], outsize, halfscale, CPUFlags);
+    else
+    {
+      // outrez is free until the filtering
+      Plane frame = Source(k);
+      CoverPlane cover = CoverIn(frame);
+      if (striprows > 0)
+      {
+        int outrow = nox * outpitch * bh;
+        for (int r0 = 0; r0 < noy; r0 += striprows)
+        {
+          int r1 = std::min(r0 + striprows, noy);
+          StripSpectrum(cover, r0, r1, outrez, mean + r0 * nox, plane_is_chroma);
+          SpectrumToHalf(outrez, cachehalf[slot] + 2 * r0 * outrow, (r1 - r0) * outrow, halfscale, CPUFlags);
+        }
+      }
+      else
+      {
+        Engine::InitOverlapPlane(in, cover, plane_is_chroma);
+        SubtractMeans(in, howmanyblocks, mean); // the means of past frames are not needed
+        ForwardFFT(plan, in, outrez);
+        SpectrumToHalf(outrez, cachehalf[slot], outsize, halfscale, CPUFlags);
+      }
+    }
+    halfwhat[slot] = k;
+  }
+  return cachehalf[slot];
+}
+
+// Temporal filtering of 'blocks' blocks, win: spectra of the window from the oldest frame - v2.11
+void Engine::ApplyFilter3D(int btcur, fftwf_complex **win, fftwf_complex *outdst, int blocks)
+{
+  if (btcur == 2) // 3D2
+  {
+    if (degrid != 0)
+    {
+      if (pfactor != 0)
+        ApplyPattern3D2_degrid_C(win[1], win[0], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, degrid, gridsample);
+      else
+        ApplyWiener3D2_degrid_C(win[1], win[0], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample);
+    }
+    else
+    {
+      if (pfactor != 0)
+        ApplyPattern3D2(win[1], win[0], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, CPUFlags);
+      else
+        ApplyWiener3D2(win[1], win[0], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, CPUFlags);
+    }
+  }
+  else if (btcur == 3) // 3D3
+  {
+    if (degrid != 0)
+    {
+      if (pfactor != 0)
+        ApplyPattern3D3_degrid(win[1], win[0], win[2], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, degrid, gridsample, CPUFlags);
+      else
+        ApplyWiener3D3_degrid(win[1], win[0], win[2], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample, CPUFlags);
+    }
+    else
+    {
+      if (pfactor != 0)
+        ApplyPattern3D3(win[1], win[0], win[2], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, CPUFlags);
+      else
+        ApplyWiener3D3(win[1], win[0], win[2], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, CPUFlags);
+    }
+  }
+  else if (btcur == 4) // 3D4
+  {
+    if (degrid != 0)
+    {
+      if (pfactor != 0)
+        ApplyPattern3D4_degrid(win[2], win[0], win[1], win[3], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, degrid, gridsample, CPUFlags);
+      else
+        ApplyWiener3D4_degrid(win[2], win[0], win[1], win[3], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample, CPUFlags);
+    }
+    else
+    {
+      if (pfactor != 0)
+        ApplyPattern3D4(win[2], win[0], win[1], win[3], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, CPUFlags);
+      else
+        ApplyWiener3D4(win[2], win[0], win[1], win[3], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, CPUFlags);
+    }
+  }
+  else // 3D5
+  {
+    if (degrid != 0)
+    {
+      if (pfactor != 0)
+        ApplyPattern3D5_degrid_C(win[2], win[0], win[1], win[3], win[4], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta, degrid, gridsample);
+      else
+        ApplyWiener3D5_degrid_C(win[2], win[0], win[1], win[3], win[4], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, degrid, gridsample);
+    }
+    else
+    {
+      if (pfactor != 0)
+        ApplyPattern3D5_C(win[2], win[0], win[1], win[3], win[4], outdst, outwidth, outpitch, bh, blocks, pattern3d, beta);
+      else
+        ApplyWiener3D5_C(win[2], win[0], win[1], win[3], win[4], outdst, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta);
+    }
+  }
+}
+
+// Implementations picked by the dispatchers above for this bt, degrid, pfactor and CPU flags - v2.11
+std::string Engine::KernelNames() const
+{
+  const bool sse = (CPUFlags & CPUF_SSE) != 0, sse2 = (CPUFlags & CPUF_SSE2) != 0;
+#ifdef X86_64
+  const bool sse_asm = false; // the SSE assembler kernels are x86 32 bit only
+#else
+  const bool sse_asm = sse;
+#endif
+  const bool grid = degrid != 0, pattern = pfactor != 0;
+  std::string filter;
+  switch (bt)
+  {
+  case 0:
+    filter = pattern ? "ApplyKalmanPattern_C" : sse2 ? "ApplyKalman_SSE2_simd" : "ApplyKalman_C";
+    break;
+  case 1:
+    if (grid)
+      filter = pattern ? "ApplyPattern2D_degrid_C" : "ApplyWiener2D_degrid_C";
+    else
+      filter = pattern ? "ApplyPattern2D_C" : "ApplyWiener2D_C";
+    break;
+  case 2:
+    if (grid)
+      filter = pattern ? "ApplyPattern3D2_degrid_C" : "ApplyWiener3D2_degrid_C";
+    else
+      filter = pattern ? (sse_asm ? "ApplyPattern3D2_SSE" : "ApplyPattern3D2_C") : (sse2 ? "ApplyWiener3D2_SSE_simd" : "ApplyWiener3D2_C");
+    break;
+  case 3:
+    if (grid)
+      filter = pattern ? (sse_asm ? "ApplyPattern3D3_degrid_SSE" : "ApplyPattern3D3_degrid_C") : (sse ? "ApplyWiener3D3_degrid_SSE_simd" : "ApplyWiener3D3_degrid_C");
+    else
+      filter = pattern ? (sse_asm ? "ApplyPattern3D3_SSE" : "ApplyPattern3D3_C") : (sse_asm ? "ApplyWiener3D3_SSE" : "ApplyWiener3D3_C");
+    break;
+  case 4:
+    if (grid)
+      filter = pattern ? (sse_asm ? "ApplyPattern3D4_degrid_SSE" : "ApplyPattern3D4_degrid_C") : (sse_asm ? "ApplyWiener3D4_degrid_SSE" : "ApplyWiener3D4_degrid_C");
+    else
+      filter = pattern ? "ApplyPattern3D4_C" : (sse2 ? "ApplyWiener3D4_SSE_simd" : "ApplyWiener3D4_C");
+    break;
+  case 5:
+    if (grid)
+      filter = pattern ? "ApplyPattern3D5_degrid_C" : "ApplyWiener3D5_degrid_C";
+    else
+      filter = pattern ? "ApplyPattern3D5_C" : "ApplyWiener3D5_C";
+    break;
+  }
+  if (bt == 1 && !pattern) // the 2D Wiener filter sharpens by itself
+    return filter;
+  const char *sharpener;
+  if (grid)
+    sharpener = sse2 ? "Sharpen_degrid_SSE_simd" : "Sharpen_degrid_C";
+  else
+    sharpener = sse_asm && dehalo == 0 ? "Sharpen_SSE" : "Sharpen_C";
+  return filter.empty() ? sharpener : filter + "+" + sharpener;
+}
+
+// Modes left on by the membudget rules of the constructor and the estimated bytes of their buffers - v2.11
+std::string Engine::SetupNames() const
+{
+  char buf[128];
+  snprintf(buf, sizeof(buf), "pipeline=%d batchfill=%d halfcache=%d striprows=%d bytes=%zu membudget=%zu",
+    (int)pipeline, (int)(planframe != nullptr), (int)halfcache, striprows, footprintbytes, membudget);
+  return buf;
+}
+
+// Buffers written on every frame: cache spectra and Kalman state - v2.11
+// With numa>0 this is called at the first GetFrame: the block of these buffers is made again
+// and all of it is written here, so that its pages are placed on the NUMA node of the thread
+// running the filter, not of the one which created it.
+void Engine::InitFrameBuffers(bool first_touch)
+{
+  if (first_touch)
+  {
+    framearena.release();
+    if (!framearena.allocate())
+      throw Error("FFT3DFilter: out of memory");
+    framearena.zero();
+  }
+
+  frame_buffers_ready = true;
+
+  // init Kalman
+  if (bt == 0) // Kalman
+  {
+    fill_complex(outLast, outsize, 0, 0);
+    std::fill_n(covar, outsize, sigmaSquaredNoiseNormed2D); // fixed bug in v.1.1
+    std::fill_n(covarProcess, outsize, sigmaSquaredNoiseNormed2D);// fixed bug in v.1.1
+  }
+}
+
+// Pipeline stage 1 for frame k: get it from the source and make its spectrum in background - v2.11
+// The source is only used here, on the calling thread.
+void Engine::PipeSubmit(int k, bool plane_is_chroma)
+{
+  if (stage1 == nullptr)
+  {
+    stage1 = new SerialWorker();
+    if (numa == 2)
+      stage1->bind_to_caller_node();
+  }
+
+  pipesrc = Source(k); // kept until PipeTake
+  CoverPlane cover = CoverIn(pipesrc);
+
+  pipeframe = k;
+  pipedone = stage1->submit([this, cover, plane_is_chroma]() {
+    InitOverlapPlane(inpipe, cover, plane_is_chroma, 0, -1, &pipeoverlapns);
+    SubtractMeans(inpipe, howmanyblocks, meanpipe);
+    PROFILE_STAGE(STAGE_FFT);
+    ScopedTimer timer(StatTimer(pipefftns));
+    fftfp.fftwf_execute_dft_r2c(plan, inpipe, outpipe);
+  });
+}
+
+// Empties the pipeline. If it was holding frame k, its spectrum is swapped into dest, its block means into destmean.
+bool Engine::PipeTake(int k, fftwf_complex *&dest, float *&destmean)
+{
+  if (pipeframe < 0)
+    return false;
+  pipedone.get();
+  pipesrc = Plane();
+  bool found = (pipeframe == k);
+  if (stats)
+  {
+    fstats.fftns += pipefftns.exchange(0);
+    fstats.overlapns += pipeoverlapns.exchange(0);
+    if (found)
+      fstats.pipehits++;
+    else
+      fstats.pipemisses++;
+  }
+  if (found)
+  {
+    std::swap(dest, outpipe);
+    std::swap(destmean, meanpipe);
+  }
+  pipeframe = -1;
+  return found;
+}
+
+// Per frame setup of Process and ShowPattern - v2.11
+void Engine::BeginFrame()
+{
+#ifndef X86_64
+  _mm_empty(); // _asm emms;
+#endif
+
+  if (stats)
+    fstats.clear();
+
+  if (numa != 0 && !frame_buffers_ready) // first call - v2.11
+  {
+    InitFrameBuffers(true);
+    if (numa == 2 && pool != nullptr)
+      pool->bind_to_caller_node();
+  }
+}
+
+//-------------------------------------------------------------------------------------------
+// pshow=true: show noise pattern window
+void Engine::ShowPattern(int n, const Plane &src, uint8_t *dstp, int dst_pitch, int &pxf, int &pyf, float &patternsigma)
+{
+  int i;
+  BeginFrame();
+
+  const bool plane_is_chroma = format.chroma;
+
+  // put source bytes to float array of overlapped blocks
+  Engine::InitOverlapPlane(in, CoverIn(src), plane_is_chroma);
+  // make FFT 2D
+  fftfp.fftwf_execute_dft_r2c(plan, in, outrez);
+  if (px == 0 && py == 0) // try find pattern block with minimal noise sigma
+    FindPatternBlock(outrez, outwidth, outpitch, bh, nox, noy, pxf, pyf, pwin, degrid, gridsample);
+  else
+  {
+    pxf = px; // fixed bug in v1.6
+    pyf = py;
+  }
+  SetPattern(outrez, outwidth, outpitch, bh, nox, noy, pxf, pyf, pwin, pattern2d, psigma, degrid, gridsample);
+
+  // change analysis and synthesis window to constant to show
+  for (i = 0; i < ow; i++)
+  {
+    wanxl[i] = 1;	wanxr[i] = 1;	wsynxl[i] = 1;	wsynxr[i] = 1;
+  }
+  for (i = 0; i < oh; i++)
+  {
+    wanyl[i] = 1;	wanyr[i] = 1;	wsynyl[i] = 1;	wsynyr[i] = 1;
+  }
+
+  const bool plane_is_chroma2 = !format.rgb;
+
+  // put source bytes to float array of overlapped blocks
+  // cur frame
+  Engine::InitOverlapPlane(in, CoverIn(src), plane_is_chroma2);
+  // make FFT 2D
+  fftfp.fftwf_execute_dft_r2c(plan, in, outrez);
+
+  PutPatternOnly(outrez, outwidth, outpitch, bh, nox, noy, pxf, pyf);
+  // do inverse 2D FFT, get filtered 'in' array
+  fftfp.fftwf_execute_dft_c2r(planinv, outrez, in);
+
+  // make destination frame plane from current overlaped blocks
+  CoverPlane out = CoverOut(dstp, dst_pitch);
+  Engine::DecodeOverlapPlane(in, norm, out, plane_is_chroma2);
+  patternsigma = psigma;
+}
+
+//-------------------------------------------------------------------------------------------
+bool Engine::Process(int n, const Plane &src, uint8_t *dstp, int dst_pitch)
+{
+  int i;
+  _RPT2(0, "FFT3DFilter engine Process, frame=%d instance_id=%d\n", n, _instance_id);
+  BeginFrame();
+
+  const bool plane_is_chroma = format.chroma;
+
+  if (pfactor != 0 && isPatternSet == false && pshow == false) // get noise pattern
+  {
+    Plane psrc = Source(pframe); // get noise pattern frame
+
+    // put source bytes to float array of overlapped blocks
+    Engine::InitOverlapPlane(in, CoverIn(psrc), plane_is_chroma);
+    SubtractMeans(in, howmanyblocks, mean); // as the filtered spectra
+    // make FFT 2D
+    ForwardFFT(plan, in, outrez);
+    if (px == 0 && py == 0) // try find pattern block with minimal noise sigma
+      FindPatternBlock(outrez, outwidth, outpitch, bh, nox, noy, px, py, pwin, degrid, gridsample);
+    SetPattern(outrez, outwidth, outpitch, bh, nox, noy, px, py, pwin, pattern2d, psigma, degrid, gridsample);
+    isPatternSet = true;
+  }
+
+  CoverPlane out = CoverOut(dstp, dst_pitch); // v2.11: the blocks are decoded to it
+
+
+  int btcur = bt; // bt used for current frame
+//	if ( (bt/2 > n) || bt==3 && n==vi.num_frames-1 )
+  if ((bt / 2 > n) || (bt - 1) / 2 > (format.num_frames - 1 - n))
+  {
+    btcur = 1; //	do 2D filter for first and last frames
+  }
+  // return src //first  frame was not processed prior v.0.7
+
+  // v2.11 pipeline: pick up the spectrum made in background during the previous call,
+  // then start the one the next call will need.
+  // bt>=2: the only new spectrum is frame n+(bt-1)/2, its ring slot holds a frame just left the window
+  // other modes: spectrum of frame n itself
+  bool sequential = (n == nlast + 1 && btcur == bt);
+  bool have_outrez = false; // spectrum of the current frame is already in outrez
+  int lookahead = bt >= 2 ? (bt - 1) / 2 : 0;
+  if (bt >= 2)
+  {
+    int slot = (n + lookahead) % cachesize;
+    if (PipeTake(sequential ? n + lookahead : -1, cachefft[slot], cachemean[slot]))
+      cachewhat[slot] = n + lookahead;
+  }
+  else
+    have_outrez = PipeTake(sequential ? n : -1, outrez, mean);
+  if (sequential && pipeline && n + lookahead + 1 < format.num_frames)
+    PipeSubmit(n + lookahead + 1, plane_is_chroma);
+
+  if (btcur > 0) // Wiener
+  {
+    sigmaSquaredNoiseNormed = btcur*sigma*sigma / norm; // normalized variation=sigma^2
+
+    if (btcur != btcurlast) // !! global state, multithreading warning
+      Pattern2Dto3D(pattern2d, bh, outwidth, outpitch, (float)btcur, pattern3d);
+
+    // get power spectral density (abs quadrat) for every block and apply filter
+
+//		env->MakeWritable(&src);
+
+    // put source bytes to float array of overlapped blocks
+
+    if (btcur == 1) // 2D
+    {
+      auto filter2d = [&](fftwf_complex *outp, int blocks) {
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        {
+          PROFILE_STAGE(STAGE_KERNEL);
+          if (degrid != 0)
+          {
+            if (pfactor != 0)
+              ApplyPattern2D_degrid_C(outp, outwidth, outpitch, bh, blocks, pfactor, pattern2d, beta, degrid, gridsample);
+            else
+              ApplyWiener2D_degrid_C(outp, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, sharpen, sigmaSquaredSharpenMinNormed, sigmaSquaredSharpenMaxNormed, wsharpen, degrid, gridsample, dehalo, wdehalo, ht2n);
+          }
+          else
+          {
+            if (pfactor != 0)
+              ApplyPattern2D(outp, outwidth, outpitch, bh, blocks, pfactor, pattern2d, beta, CPUFlags);
+            else
+              ApplyWiener2D(outp, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed, beta, sharpen, sigmaSquaredSharpenMinNormed, sigmaSquaredSharpenMaxNormed, wsharpen, dehalo, wdehalo, ht2n, CPUFlags);
+          }
+        }
+        if (pfactor != 0) // the Wiener filter sharpens by itself
+          SharpenBlocks(outp, blocks);
+      };
+
+      if (striprows > 0) // v2.11
+      {
+        CoverPlane cover = CoverIn(src);
+        ProcessStrips(out, mean, plane_is_chroma, [&](int r0, int r1) {
+          StripSpectrum(cover, r0, r1, outrez, mean + r0 * nox, plane_is_chroma);
+          filter2d(outrez, nox * (r1 - r0));
+        });
+      }
+      else
+      {
+        if (!have_outrez)
+        {
+          // cur frame
+          Engine::InitOverlapPlane(in, CoverIn(src), plane_is_chroma);
+          //			Engine::InitOverlapPlaneWin(in, coverbuf,  coverpitch, planeBase, fullwinan); // slower
+          SubtractMeans(in, howmanyblocks, mean);
+          // make FFT 2D
+          ForwardFFT(plan, in, outrez);
+        }
+        filter2d(outrez, howmanyblocks);
+
+        // do inverse FFT 2D, get filtered 'in' array
+        InverseFFT(planinv, outrez, in);
+        RestoreMeans(in, howmanyblocks, mean);
+      }
+    }
+    else // 3D, btcur = bt = 2..5
+    {
+      // v2.11: spectra of frames n-btcur/2 .. n+(btcur-1)/2 are taken from the ring cache,
+      // the filters write the result to outrez and leave them unchanged
+      fftwf_complex *win[5]; // prev2, prev, cur, next, next2 (as many as btcur)
+      const uint16_t *winhalf[2]; // halfcache: prev2, prev
+      int past = btcur / 2; // number of frames before n
+      if (stats)
+        for (i = 0; i < btcur; i++)
+        {
+          int k = n - past + i;
+          bool cached = cachewhat[k % cachesize] == k || (halfcache && i < past && halfwhat[k % halfsize] == k);
+          if (cached)
+            fstats.cachehits++;
+          else
+            fstats.cachemisses++;
+        }
+      if (halfcache)
+        for (i = 0; i < past; i++)
+          winhalf[i] = CachedHalf(n - past + i, plane_is_chroma);
+      if (pool != nullptr)
+        FillCacheBatch(n, btcur, src, plane_is_chroma);
+      for (i = halfcache ? past : 0; i < btcur; i++)
+        win[i] = CachedSpectrum(n - past + i, n, src, plane_is_chroma);
+
+      // filtered spectrum of block rows r0..r1-1 to dst
+      auto filter3d = [&](int r0, int r1, fftwf_complex *dst) {
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        PROFILE_STAGE(STAGE_KERNEL);
+        int rowsize = nox * outpitch * bh;
+        fftwf_complex *winrow[5];
+        if (!halfcache)
+        {
+          for (int j = 0; j < btcur; j++)
+            winrow[j] = win[j] + r0 * rowsize;
+          ApplyFilter3D(btcur, winrow, dst, nox * (r1 - r0));
+          return;
+        }
+        // filter by block rows, the past frames are expanded to float for one row at a time
+        for (int row = r0; row < r1; row++)
+        {
+          for (int j = 0; j < btcur; j++)
+          {
+            if (j < past)
+            {
+              HalfToSpectrum(winhalf[j] + 2 * row * rowsize, halfwork[j], rowsize, 1.0f / halfscale, CPUFlags);
+              winrow[j] = halfwork[j];
+            }
+            else
+              winrow[j] = win[j] + row * rowsize;
+          }
+          ApplyFilter3D(btcur, winrow, dst + (row - r0) * rowsize, nox);
+        }
+      };
+      auto sharpen3d = [&](fftwf_complex *outp, int blocks) {
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        SharpenBlocks(outp, blocks);
+      };
+
+      if (striprows > 0) // v2.11
+      {
+        ProcessStrips(out, cachemean[n % cachesize], plane_is_chroma, [&](int r0, int r1) {
+          filter3d(r0, r1, outrez);
+          sharpen3d(outrez, nox * (r1 - r0));
+        });
+      }
+      else
+      {
+        filter3d(0, noy, outrez);
+        sharpen3d(outrez, howmanyblocks);
+        // do inverse FFT 3D, get filtered 'in' array
+        // note: input "outrez" array is destroyed by execute algo.
+        InverseFFT(planinv, outrez, in);
+        RestoreMeans(in, howmanyblocks, cachemean[n % cachesize]);
+      }
+      if (halfcache) // for the next frames the current one is a past frame
+      {
+        SpectrumToHalf(win[past], cachehalf[n % halfsize], outsize, halfscale, CPUFlags);
+        halfwhat[n % halfsize] = n;
+      }
+    }
+    // make destination frame plane from current overlaped blocks
+    if (striprows == 0) // else already done by strips
+      Engine::DecodeOverlapPlane(in, norm, out, plane_is_chroma);
+
+  }
+  else if (bt == 0) //Kalman filter
+  {
+    // get power spectral density (abs quadrat) for every block and apply filter
+
+    if (n == 0)
+      return false; // first frame  not processed
+    /* PF 170302 comment: accumulated error?
+      orig = BlankClip(...)
+      new = orig.FFT3DFilter(sigma = 3, plane = 4, bt = 0, degrid = 0)
+      Subtract(orig,new).Levels(120, 1, 255 - 120, 0, 255, coring = false)
+    */
+
+    if (pool != nullptr)
+    {
+      // v2.11: the same steps, spread over the block rows
+      KalmanRowParallel(CoverIn(src), out, plane_is_chroma);
+    }
+    else if (striprows > 0) // v2.11
+    {
+      CoverPlane cover = CoverIn(src);
+      ProcessStrips(out, mean, plane_is_chroma, [&](int r0, int r1) {
+        StripSpectrum(cover, r0, r1, outrez, mean + r0 * nox, plane_is_chroma);
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        int offset = r0 * nox * outpitch * bh;
+        int blocks = nox * (r1 - r0);
+        {
+          PROFILE_STAGE(STAGE_KERNEL);
+          if (pfactor != 0)
+            ApplyKalmanPattern(outrez, outLast + offset, covar + offset, covarProcess + offset, outwidth, outpitch, bh, blocks, pattern2d, kratio*kratio, CPUFlags);
+          else
+            ApplyKalman(outrez, outLast + offset, covar + offset, covarProcess + offset, outwidth, outpitch, bh, blocks, sigmaSquaredNoiseNormed2D, kratio*kratio, CPUFlags);
+          // copy outLast to outrez
+          memcpy(outrez, outLast + offset, blocks * outpitch * bh * sizeof(fftwf_complex));
+        }
+        SharpenBlocks(outrez, blocks);
+      });
+    }
+    else
+    {
+      if (!have_outrez)
+      {
+        Engine::InitOverlapPlane(in, CoverIn(src), plane_is_chroma);
+        SubtractMeans(in, howmanyblocks, mean);
+        // make FFT 2D
+        ForwardFFT(plan, in, outrez);
+      }
+      {
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        {
+          PROFILE_STAGE(STAGE_KERNEL);
+          if (pfactor != 0)
+            ApplyKalmanPattern(outrez, outLast, covar, covarProcess, outwidth, outpitch, bh, howmanyblocks, pattern2d, kratio*kratio, CPUFlags);
+          else
+            ApplyKalman(outrez, outLast, covar, covarProcess, outwidth, outpitch, bh, howmanyblocks, sigmaSquaredNoiseNormed2D, kratio*kratio, CPUFlags);
+
+          // copy outLast to outrez
+          memcpy(outrez, outLast, outsize * sizeof(fftwf_complex));  //v.0.9.2
+        }
+        SharpenBlocks(outrez, howmanyblocks);
+      }
+      // do inverse FFT 2D, get filtered 'in' array
+      // note: input "out" array is destroyed by execute algo.
+      // that is why we must have its copy in "outLast" array
+      InverseFFT(planinv, outrez, in);
+      RestoreMeans(in, howmanyblocks, mean);
+      // make destination frame plane from current overlaped blocks
+      Engine::DecodeOverlapPlane(in, norm, out, plane_is_chroma);
+    }
+
+  }
+  else if (bt == -1) /// sharpen only
+  {
+    //		env->MakeWritable(&src);
+    if (striprows > 0) // v2.11
+    {
+      CoverPlane cover = CoverIn(src);
+      ProcessStrips(out, mean, plane_is_chroma, [&](int r0, int r1) {
+        StripSpectrum(cover, r0, r1, outrez, mean + r0 * nox, plane_is_chroma);
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        SharpenBlocks(outrez, nox * (r1 - r0));
+      });
+    }
+    else
+    {
+      if (!have_outrez)
+      {
+        // put source bytes to float array of overlapped blocks
+        Engine::InitOverlapPlane(in, CoverIn(src), plane_is_chroma);
+        SubtractMeans(in, howmanyblocks, mean);
+        // make FFT 2D
+        ForwardFFT(plan, in, outrez);
+      }
+      {
+        ScopedTimer timer(StatTimer(fstats.kernelns));
+        SharpenBlocks(outrez, howmanyblocks);
+      }
+      // do inverse FFT 2D, get filtered 'in' array
+      InverseFFT(planinv, outrez, in);
+      RestoreMeans(in, howmanyblocks, mean);
+      // make destination frame plane from current overlaped blocks
+      Engine::DecodeOverlapPlane(in, norm, out, plane_is_chroma);
+    }
+  }
+
+  if (btcur == bt)
+  {// for normal step
+    nlast = n; // set last frame to current
+  }
+  btcurlast = btcur;
+
+  return true;
+}
+
+
+} // namespace fft3d
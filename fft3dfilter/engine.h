@@ -0,0 +1,398 @@
+//
+//	FFT3DFilter plugin for Avisynth 2.6 and Avisynth+ - 3D Frequency Domain filter
+//  host independent filtering engine - v2.11
+//	Copyright(C)2004-2006 A.G.Balakhnin aka Fizick, bag@hotmail.ru, http://avisynth.org.ru
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as published by
+//	the Free Software Foundation.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program; if not, write to the Free Software
+//	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//-----------------------------------------------------------------------------------------
+#ifndef __FFT3D_ENGINE_H__
+#define __FFT3D_ENGINE_H__
+
+// fft3d::Engine filters one plane of a clip: windows, FFTW plans and noise patterns are
+// made by the constructor, Process() does what FFT3DFilter::GetFrame did for the plane.
+// It knows nothing of AviSynth. Frames are plane buffers, the frames of the temporal window
+// other than the current one are asked from a FrameSource. The AviSynth filter (FFT3DFilter.cpp)
+// and the C API (fft3d_capi.h) are thin adapters on top of it.
+
+#include "fftwlite.h"
+#include "threadpool.h"
+#include "arena.h"
+#include "framestats.h"
+#include "stageprofile.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stddef.h>
+#include <stdexcept>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+namespace fft3d {
+
+// Thrown by the engine for bad parameters, FFTW errors and out of memory.
+// The message is the one of the AviSynth filter ("FFT3DFilter: ...").
+class Error : public std::runtime_error {
+public:
+  explicit Error(const char *msg) : std::runtime_error(msg) {}
+};
+
+// Filter parameters, the same as the ones of the AviSynth function. The defaults are the
+// AviSynth defaults, except sigma2..sigma4, which are there the value of sigma.
+struct Params {
+  float sigma = 2.0f; // noise level (std deviation) for high frequencies, in 8 bit units
+  float beta = 1.0f; // relative noise margin for Wiener filter
+  int bw = 32, bh = 32; // block size
+  int bt = 3; // -1: sharpen only, 0: Kalman, 1..5: Wiener with bt frames
+  int ow = -1, oh = -1; // overlap, -1: bw/3, bh/3
+  float kratio = 2.0f; // threshold to sigma ratio for Kalman filter
+  float sharpen = 0.0f;
+  float scutoff = 0.3f; // sharpen cutoff frequency (relative to max)
+  float svr = 1.0f; // sharpen vertical ratio
+  float smin = 4.0f, smax = 20.0f; // sharpen limits, 8 bit units
+  bool measure = true; // FFTW_MEASURE plans
+  bool interlaced = false;
+  int wintype = 0;
+  int pframe = 0, px = 0, py = 0; // noise pattern frame and block, px=py=0: searched
+  bool pshow = false;
+  float pcutoff = 0.1f;
+  float pfactor = 0.0f; // noise pattern denoise strength
+  float sigma2 = 2.0f, sigma3 = 2.0f, sigma4 = 2.0f; // noise levels of middle, low and lowest frequencies
+  float degrid = 1.0f;
+  float dehalo = 0.0f, hr = 2.0f, ht = 50.0f;
+  int ncpu = 1;
+  int numa = 0;
+  bool halfcache = false;
+  int hugepages = 0;
+  size_t membudget = 0; // bytes, 0: no limit
+  bool removemean = false;
+  bool stats = false; // LastFrameStats() is filled
+};
+
+// The plane filtered by an engine
+struct Format {
+  int width = 0, height = 0; // of the plane, pixels
+  int bits_per_pixel = 8; // 8, 10, 12, 14, 16: integer samples, 32: float
+  bool chroma = false; // U or V plane of a YUV clip: centered at half range (float: at 0)
+  bool rgb = false; // plane of an RGB clip (pshow only)
+  int yuy2plane = -1; // -1: planar buffers, 0, 1, 2: Y, U or V of packed YUY2 rows
+  int num_frames = 0; // of the clip, may be updated by SetFrameCount
+};
+
+// Source plane of a frame: ptr to its first row, pitch in bytes (YUY2: of the packed rows).
+// hold keeps the buffer alive while the engine reads it, it may be empty.
+struct Plane {
+  const uint8_t *ptr = nullptr;
+  int pitch = 0;
+  std::shared_ptr<const void> hold;
+};
+
+// Frames of the clip which are read besides the current one: the other frames of the
+// temporal window, the next one for the pipeline and the noise pattern frame.
+// Called only on the thread calling Process().
+class FrameSource {
+public:
+  virtual ~FrameSource() {}
+  virtual Plane GetPlane(int k) = 0;
+};
+
+// CPU flags (CPUF_* of avs/cpuid.h) of the running processor
+int DetectCPUFlags();
+
+//-------------------------------------------------------------------------------------------
+// Plane read or written by the overlapped block coding - v2.11
+// The blocks cover coverwidth x coverheight pixels: the plane with mirrored borders of mirw, mirh.
+// This is the frame plane itself, the cover rows and border pixels are mapped to it on the fly,
+// the plane is not copied. YUY2 rows are deinterleaved to the edge buffer and interleaved back.
+struct CoverPlane {
+  uint8_t *ptr;
+  int pitch; // pixel_t granularity (YUY2: bytes), 0: every row is the same
+  int width, height; // of the plane
+  bool interlaced; // rows of the second field are flipped after the first field
+  int yuy2plane; // -1: planar, 0, 1, 2: Y, U or V of the YUY2 frame at ptr
+};
+
+// Cover row pointers: head for the first bw-ow pixels, body for the next ones, tail from block column tailblock on
+template<typename pixel_t>
+struct CoverLine {
+  pixel_t *head, *body, *tail;
+};
+
+//-------------------------------------------------------------------------------------------
+class Engine {
+  //  parameters
+  float sigma; // noise level (std deviation) for high frequncies ***
+  float beta; // relative noise margin for Wiener filter
+  int bw;// block width
+  int bh;// block height
+  int bt;// block size  along time (mumber of frames), =0 for Kalman, >0 for Wiener
+  int ow; // overlap width - v.0.9
+  int oh; // overlap height - v.0.9
+  float kratio; // threshold to sigma ratio for Kalman filter
+  float sharpen; // sharpen factor (0 to 1 and above)
+  float scutoff; // sharpen cufoff frequency (relative to max) - v1.7
+  float svr; // sharpen vertical ratio (0 to 1 and above) - v.1.0
+  float smin; // minimum limit for sharpen (prevent noise amplifying) - v.1.1  ***
+  float smax; // maximum limit for sharpen (prevent oversharping) - v.1.1      ***
+  bool measure; // fft optimal method
+  bool interlaced;
+  int wintype; // window type
+  int pframe; // noise pattern frame number
+  int px; // noise pattern window x-position
+  int py; // noise pattern window y-position
+  bool pshow; // show noise pattern
+  float pcutoff; // pattern cutoff frequency (relative to max)
+  float pfactor; // noise pattern denoise strength
+  float sigma2; // noise level for middle frequencies           ***
+  float sigma3; // noise level for low frequencies              ***
+  float sigma4; // noise level for lowest (zero) frequencies    ***
+  float degrid; // decrease grid
+  float dehalo; // remove halo strength - v.1.9
+  float hr; // halo radius - v1.9
+  float ht; // halo threshold - v1.9
+//	bool mc; // motion compensation - v2.0
+  int ncpu; // number of threads - v2.0
+  int numa; // 1: work buffers are placed at first GetFrame, 2: also bind worker threads there - v2.11
+  int hugepages; // frame buffers in 1: transparent huge pages, 2: explicit huge pages - v2.11
+  size_t membudget; // bytes, 0: no limit - v2.11
+  bool frame_buffers_ready;
+
+  Format format; // of the plane
+  FrameSource *source; // the other frames of the clip
+
+  // additional parameterss
+  float *in;
+  fftwf_complex *outrez, *gridsample; //v1.8
+  fftwf_plan plan, planinv, plan1;
+  int nox, noy;
+  int outwidth;
+  int outpitch; //v.1.7
+
+  int outsize;
+  int howmanyblocks;
+
+  int ndim[2];
+  int inembed[2];
+  int onembed[2];
+
+  float *wanxl; // analysis
+  float *wanxr;
+  float *wanyl;
+  float *wanyr;
+
+  float *wsynxl; // synthesis
+  float *wsynxr;
+  float *wsynyl;
+  float *wsynyr;
+
+  float *wsharpen;
+  float *wdehalo;
+
+  int nlast;// frame number at last step, PF: multithread warning, used for cacheing when sequential access detected
+  int btcurlast;  //v1.7 to prevent multiple Pattern2Dto3D for the same btcurrent. btcurrent can change and may differ from bt for e.g. first/last frame
+
+  fftwf_complex *outLast;
+  float *covar, *covarProcess; // the same for re and im, kept once - v2.11
+  float sigmaSquaredNoiseNormed;
+  float sigmaSquaredNoiseNormed2D;
+  float sigmaNoiseNormed2D;
+  float sigmaMotionNormed;
+  float sigmaSquaredSharpenMinNormed;
+  float sigmaSquaredSharpenMaxNormed;
+  float ht2n; // halo threshold squared normed
+  float norm; // normalization factor
+
+  int coverwidth; // blocks cover the frame without remainders (with sufficient width and heigth)
+  int coverheight;
+
+  int mirw; // mirror width for padding
+  int mirh; // mirror height for padding
+
+  // removemean=true: the window weighted mean of each block is subtracted before the forward FFT
+  // and added back after the inverse one, the filters get blocks without DC - v2.11
+  bool removemean;
+  float *mean; // block means of the current frame (bt<2), scratch for bt>=2
+  float *wanblock; // analysis window of a whole block, bw*bh
+  float meannorm; // 1 / sum of wanblock
+  float **cachemean; // block means of the spectra in cachefft
+  float *meanpipe; // block means of outpipe
+
+  float *pwin;
+  float *pattern2d;
+  float *pattern3d;
+  bool isPatternSet;
+  float psigma;
+
+  FFTFunctionPointers fftfp;
+
+  // bt=0 with ncpu>1: one frame is processed by block rows in parallel - v2.11
+  // bt>=2 with ncpu>1: missing spectra of the temporal window are made in parallel
+  ThreadPool *pool;
+  fftwf_plan planrow, planinvrow; // plans for a single row of nox blocks
+  fftwf_plan planframe; // single threaded forward plan of a whole frame, for the pool threads
+  float *inbatch[5]; // bt arrays of overlapped blocks, allocated at first use
+
+  // two stage pipeline on sequential access - v2.11
+  // stage 1 (frame to spectrum) of the next needed frame runs on the 'stage1' thread
+  // while Process does stage 2 (filter, inverse FFT, decode) of the current one.
+  SerialWorker *stage1;
+  float *inpipe;
+  Plane pipesrc; // source plane of the pipeline, read by stage 1
+  fftwf_complex *outpipe; // spectrum of frame pipeframe
+  int pipeframe; // -1 if empty
+  std::future<void> pipedone;
+  bool pipeline; // false: not used (bt=0 with ncpu>1, or membudget)
+
+  // processing by strips of block rows, chosen by membudget - v2.11
+  // 'in' holds striprows+2 block rows (the rows before and after the strip are touched
+  // by the overlapping stripes), outrez striprows rows. 0: whole frame.
+  int striprows;
+  size_t footprintbytes; // estimated buffer bytes of the chosen setup
+  float *inrowsave; // filtered last block row of the previous strip, for decoding
+
+  // all buffers are placed in a few aligned blocks - v2.11
+  Arena arena; // buffers made by the constructor: windows, patterns, cache indexes
+  Arena framearena; // buffers written on every frame: 'in', spectra, cover buffers, Kalman state
+  Arena batcharena; // inbatch, at first use
+
+  // stats=true: counters and timings of the current frame - v2.11
+  bool stats;
+  FrameStats fstats;
+  std::atomic<int64_t> pipefftns; // FFT time of the pipeline job, added to fstats when it is taken
+  std::atomic<int64_t> pipeoverlapns; // and its overlapped blocks time
+  std::atomic<int64_t> *StatTimer(std::atomic<int64_t> &acc) { return stats ? &acc : nullptr; }
+  void ForwardFFT(fftwf_plan p, float *src, fftwf_complex *dst);
+  void InverseFFT(fftwf_plan p, fftwf_complex *src, float *dst);
+
+  // FFT3D_PROFILE builds: per stage timing histograms over the life of the instance - v2.11
+#ifdef FFT3D_PROFILE
+  StageProfile profile;
+#endif
+  void SharpenBlocks(fftwf_complex *outp, int blocks);
+
+  int CPUFlags;
+
+  int pixelsize;
+  int bits_per_pixel;
+
+  // spectrum cache - v1.8, ring buffer since v2.11
+  // frame k is kept in slot k % cachesize. cachesize = bt, so the bt frames of the temporal
+  // window of the current frame have distinct slots: they stay pinned while it is processed.
+  fftwf_complex ** cachefft; //v1.8
+  int * cachewhat;//v1.8 frame number in the slot, -1 if none
+  int cachesize;//v1.8
+
+  // halfcache=true: the float ring keeps only frames n..n+(bt-1)/2 (cachesize = (bt-1)/2+1),
+  // the past frames of the window are kept in 'cachehalf' as FP16, slot k % halfsize - v2.11
+  bool halfcache;
+  uint16_t ** cachehalf; // 2*outsize values (re, im), multiplied by halfscale
+  int * halfwhat;
+  int halfsize; // bt/2
+  float halfscale; // power of 2, puts the largest possible spectrum value near 2^14
+  fftwf_complex ** halfwork; // past frames expanded to float, one block row (nox blocks) each
+
+  int _instance_id; // debug unique id
+
+  CoverPlane CoverIn(const Plane &src);
+  CoverPlane CoverOut(uint8_t *dstp, int dst_pitch);
+  int CoverTail(const CoverPlane &cover);
+  template<typename pixel_t>
+  CoverLine<pixel_t> GetCoverLine(const CoverPlane &cover, int y, int tailblock, pixel_t *edge);
+  template<typename pixel_t>
+  CoverLine<pixel_t> PutCoverLine(const CoverPlane &cover, int y, pixel_t *edge);
+  template<typename pixel_t>
+  void PutCoverTail(const CoverPlane &cover, const CoverLine<pixel_t> &line, int tailblock, pixel_t *edge);
+
+  // ihy_from..ihy_to: range of horizontal stripes (0..noy) to process, -1 means up to the last one
+  template<typename pixel_t, int bits_per_pixel, bool chroma>
+  void do_InitOverlapPlane(float * inp, const CoverPlane &src, int ihy_from, int ihy_to);
+
+  // timed with stats=true to 'overlaptime', fstats.overlapns if null
+  void InitOverlapPlane(float * inp, const CoverPlane &src, bool chroma, int ihy_from = 0, int ihy_to = -1, std::atomic<int64_t> *overlaptime = nullptr);
+
+  template<typename pixel_t, int bits_per_pixel, bool chroma>
+  void do_DecodeOverlapPlane(float *in, float norm, const CoverPlane &dst, int ihy_from, int ihy_to);
+
+  void DecodeOverlapPlane(float *in, float norm, const CoverPlane &dst, bool chroma, int ihy_from = 0, int ihy_to = -1);
+
+  void SubtractMeans(float *inp, int blocks, float *blockmean);
+  void RestoreMeans(float *inp, int blocks, const float *blockmean);
+
+  void KalmanRowParallel(const CoverPlane &src, const CoverPlane &dst, bool plane_is_chroma);
+  void StripSpectrum(const CoverPlane &src, int r0, int r1, fftwf_complex *dst, float *dstmean, bool plane_is_chroma);
+  void ProcessStrips(const CoverPlane &dst, const float *means, bool plane_is_chroma, const std::function<void(int, int)>& filter);
+
+  void PipeSubmit(int k, bool plane_is_chroma);
+  bool PipeTake(int k, fftwf_complex *&dest, float *&destmean);
+  void FillCacheBatch(int n, int btcur, const Plane &src, bool plane_is_chroma);
+  fftwf_complex *CachedSpectrum(int k, int n, const Plane &src, bool plane_is_chroma);
+  const uint16_t *CachedHalf(int k, bool plane_is_chroma);
+  void ApplyFilter3D(int btcur, fftwf_complex **win, fftwf_complex *outdst, int blocks);
+
+  void InitFrameBuffers(bool first_touch);
+  void BeginFrame();
+
+public:
+  // cpuflags: CPUF_* flags of the kernels which may be used, e.g. DetectCPUFlags()
+  Engine(const Params &params, const Format &format, FrameSource *source, int cpuflags);
+  ~Engine();
+
+  Engine(const Engine &) = delete;
+  Engine &operator=(const Engine &) = delete;
+
+  // Filters frame n, whose plane is src, to the plane at dstp. The frames of its temporal window
+  // n-Past()..n+Lookahead() and the pattern frame are read from the source if they are not cached.
+  // Returns false if frame n is passed through unfiltered (the first frame for Kalman), dst is not written then.
+  bool Process(int n, const Plane &src, uint8_t *dstp, int dst_pitch);
+
+  // pshow=true: the noise pattern block of frame n alone, to the plane at dstp (instead of Process).
+  // Its position and the sigma of the pattern are returned for the caption.
+  void ShowPattern(int n, const Plane &src, uint8_t *dstp, int dst_pitch, int &patternx, int &patterny, float &patternsigma);
+  bool ShowsPattern() const { return pfactor != 0 && pshow; }
+
+  // Frame k of the source, timed as the source stage by FFT3D_PROFILE builds
+  Plane Source(int k);
+
+  // for sources of unknown length: the last frames are filtered as the last ones only
+  // when the frame count is known before they are processed
+  void SetFrameCount(int num_frames) { format.num_frames = num_frames; }
+  // frames before and after frame n read by Process(n), the pipeline reads one more after
+  int Past() const { return bt >= 2 ? bt / 2 : 0; }
+  int Lookahead() const { return bt >= 2 ? (bt - 1) / 2 : 0; }
+  // the noise pattern is estimated from frame PatternFrame() by the next Process
+  bool NeedsPatternFrame() const { return pfactor != 0 && !isPatternSet && !pshow; }
+  int PatternFrame() const { return pframe; }
+  int InstanceId() const { return _instance_id; }
+
+  // stats=true: of the last Process - v2.11
+  const FrameStats &LastFrameStats() const { return fstats; }
+  size_t AllocatedBytes() const { return arena.size() + framearena.size() + (batcharena.allocated() ? batcharena.size() : 0); }
+  // of them backed by huge pages (hugepages=1/2), counted when the buffers were allocated
+  size_t HugePageBytes() const { return framearena.hugepage_bytes() + batcharena.hugepage_bytes(); }
+  // the filter and sharpen kernels Process calls with these CPU flags, "filter+sharpen" - v2.11
+  std::string KernelNames() const;
+  // the setup chosen for membudget, "pipeline=1 batchfill=0 halfcache=0 striprows=0 bytes=N membudget=M" - v2.11
+  std::string SetupNames() const;
+#ifdef FFT3D_PROFILE
+  // stage timings so far, also printed to stderr by the destructor - v2.11
+  const StageProfile &Profile() const { return profile; }
+  void PrintProfile(FILE *f) const;
+#endif
+};
+
+} // namespace fft3d
+
+#endif // __FFT3D_ENGINE_H__
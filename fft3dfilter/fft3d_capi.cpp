@@ -0,0 +1,266 @@
+//
+//	FFT3DFilter plugin for Avisynth 2.6 and Avisynth+ - 3D Frequency Domain filter
+//  C API on top of fft3d::Engine - v2.11
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as published by
+//	the Free Software Foundation.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program; if not, write to the Free Software
+//	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//-----------------------------------------------------------------------------------------
+
+#define FFT3D_CAPI_EXPORTS
+#include "fft3d_capi.h"
+#include "engine.h"
+#include <limits.h>
+#include <map>
+#include <memory>
+#include <new>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Pushed frames, kept while a frame still to be delivered may read them.
+// The engine asks them back through GetPlane.
+struct fft3d_handle : public fft3d::FrameSource {
+  std::unique_ptr<fft3d::Engine> engine;
+  int rowsize; // bytes
+  int height;
+  int pushed; // frames pushed
+  int next; // next frame to deliver
+  bool finished;
+  std::map<int, std::shared_ptr<std::vector<uint8_t>>> frames;
+  std::string error;
+
+  fft3d::Plane GetPlane(int k) override
+  {
+    auto f = frames.find(k);
+    if (f == frames.end())
+      throw fft3d::Error("FFT3DFilter: frame is no more available");
+    fft3d::Plane p;
+    p.ptr = f->second->data();
+    p.pitch = rowsize;
+    p.hold = f->second;
+    return p;
+  }
+
+  // the window of frame next, the frame the pipeline reads after it and the pattern frame are there
+  bool Ready() const
+  {
+    int last = next + engine->Lookahead() + 1;
+    if (!finished && pushed <= last)
+      return false;
+    if (engine->NeedsPatternFrame() && !finished && engine->PatternFrame() >= pushed)
+      return false;
+    return true;
+  }
+
+  void Forget()
+  {
+    int first = next - engine->Past();
+    for (auto f = frames.begin(); f != frames.end(); )
+    {
+      bool pattern = f->first == engine->PatternFrame() && engine->NeedsPatternFrame();
+      if (f->first < first && !pattern)
+        f = frames.erase(f);
+      else
+        ++f;
+    }
+  }
+};
+
+static thread_local std::string create_error;
+
+extern "C" {
+
+void fft3d_default_params(fft3d_params *params)
+{
+  fft3d::Params d;
+  params->sigma = d.sigma;
+  params->beta = d.beta;
+  params->bw = d.bw;
+  params->bh = d.bh;
+  params->bt = d.bt;
+  params->ow = d.ow;
+  params->oh = d.oh;
+  params->kratio = d.kratio;
+  params->sharpen = d.sharpen;
+  params->scutoff = d.scutoff;
+  params->svr = d.svr;
+  params->smin = d.smin;
+  params->smax = d.smax;
+  params->measure = d.measure;
+  params->interlaced = d.interlaced;
+  params->wintype = d.wintype;
+  params->pframe = d.pframe;
+  params->px = d.px;
+  params->py = d.py;
+  params->pshow = 0;
+  params->pcutoff = d.pcutoff;
+  params->pfactor = d.pfactor;
+  params->sigma2 = params->sigma3 = params->sigma4 = -1; // as sigma
+  params->degrid = d.degrid;
+  params->dehalo = d.dehalo;
+  params->hr = d.hr;
+  params->ht = d.ht;
+  params->ncpu = d.ncpu;
+  params->numa = d.numa;
+  params->halfcache = d.halfcache;
+  params->hugepages = d.hugepages;
+  params->membudget = 0;
+  params->removemean = d.removemean;
+}
+
+fft3d_handle *fft3d_create(const fft3d_params *params, int width, int height, int bits_per_pixel, int chroma, int cpuflags)
+{
+  fft3d::Params p;
+  p.sigma = params->sigma;
+  p.beta = params->beta;
+  p.bw = params->bw;
+  p.bh = params->bh;
+  p.bt = params->bt;
+  p.ow = params->ow;
+  p.oh = params->oh;
+  p.kratio = params->kratio;
+  p.sharpen = params->sharpen;
+  p.scutoff = params->scutoff;
+  p.svr = params->svr;
+  p.smin = params->smin;
+  p.smax = params->smax;
+  p.measure = params->measure != 0;
+  p.interlaced = params->interlaced != 0;
+  p.wintype = params->wintype;
+  p.pframe = params->pframe;
+  p.px = params->px;
+  p.py = params->py;
+  p.pcutoff = params->pcutoff;
+  p.pfactor = params->pfactor;
+  p.sigma2 = params->sigma2 < 0 ? params->sigma : params->sigma2;
+  p.sigma3 = params->sigma3 < 0 ? params->sigma : params->sigma3;
+  p.sigma4 = params->sigma4 < 0 ? params->sigma : params->sigma4;
+  p.degrid = params->degrid;
+  p.dehalo = params->dehalo;
+  p.hr = params->hr;
+  p.ht = params->ht;
+  p.ncpu = params->ncpu;
+  p.numa = params->numa;
+  p.halfcache = params->halfcache != 0;
+  p.hugepages = params->hugepages;
+  p.membudget = (size_t)(params->membudget > 0 ? params->membudget : 0) << 20;
+  p.removemean = params->removemean != 0;
+
+  if (params->pshow)
+  {
+    create_error = "FFT3DFilter: pshow is not supported by the C API";
+    return nullptr;
+  }
+
+  fft3d::Format format;
+  format.width = width;
+  format.height = height;
+  format.bits_per_pixel = bits_per_pixel;
+  format.chroma = chroma != 0;
+  format.num_frames = INT_MAX / 2; // until fft3d_finish
+
+  fft3d_handle *h = new (std::nothrow) fft3d_handle;
+  if (h == nullptr)
+  {
+    create_error = "FFT3DFilter: out of memory";
+    return nullptr;
+  }
+  try {
+    h->engine.reset(new fft3d::Engine(p, format, h, cpuflags == -1 ? fft3d::DetectCPUFlags() : cpuflags));
+  }
+  catch (const std::exception &e) // fft3d::Error, std::bad_alloc
+  {
+    create_error = e.what();
+    delete h;
+    return nullptr;
+  }
+  h->rowsize = width * (bits_per_pixel == 8 ? 1 : bits_per_pixel == 32 ? 4 : 2);
+  h->height = height;
+  h->pushed = 0;
+  h->next = 0;
+  h->finished = false;
+  return h;
+}
+
+int fft3d_push_plane(fft3d_handle *h, const void *src, ptrdiff_t pitch)
+{
+  if (h->finished)
+  {
+    h->error = "FFT3DFilter: frame pushed after fft3d_finish";
+    return FFT3D_ERROR;
+  }
+  try {
+    auto buf = std::make_shared<std::vector<uint8_t>>((size_t)h->rowsize * h->height);
+    const uint8_t *srcp = (const uint8_t *)src;
+    for (int y = 0; y < h->height; y++)
+      memcpy(buf->data() + (size_t)y * h->rowsize, srcp + y * pitch, h->rowsize);
+    h->frames[h->pushed++] = buf;
+  }
+  catch (const std::bad_alloc &)
+  {
+    h->error = "FFT3DFilter: out of memory";
+    return FFT3D_ERROR;
+  }
+  return FFT3D_OK;
+}
+
+int fft3d_finish(fft3d_handle *h)
+{
+  h->finished = true;
+  h->engine->SetFrameCount(h->pushed);
+  return FFT3D_OK;
+}
+
+int fft3d_pull_plane(fft3d_handle *h, void *dst, ptrdiff_t pitch)
+{
+  if (h->finished && h->next >= h->pushed)
+    return FFT3D_END_OF_STREAM;
+  if (!h->Ready())
+    return FFT3D_NEED_MORE_INPUT;
+  if (h->engine->NeedsPatternFrame() && h->engine->PatternFrame() >= h->pushed)
+  {
+    h->error = "FFT3DFilter: pframe is beyond the last frame";
+    return FFT3D_ERROR;
+  }
+  try {
+    int n = h->next;
+    fft3d::Plane src = h->GetPlane(n);
+    if (!h->engine->Process(n, src, (uint8_t *)dst, (int)pitch))
+    {
+      // passed through (the first frame for Kalman)
+      for (int y = 0; y < h->height; y++)
+        memcpy((uint8_t *)dst + y * pitch, src.ptr + (size_t)y * h->rowsize, h->rowsize);
+    }
+  }
+  catch (const std::exception &e)
+  {
+    h->error = e.what();
+    return FFT3D_ERROR;
+  }
+  h->next++;
+  h->Forget();
+  return FFT3D_OK;
+}
+
+const char *fft3d_last_error(const fft3d_handle *h)
+{
+  return h ? h->error.c_str() : create_error.c_str();
+}
+
+void fft3d_destroy(fft3d_handle *h)
+{
+  delete h;
+}
+
+} // extern "C"
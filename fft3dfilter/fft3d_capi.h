@@ -0,0 +1,99 @@
+/*
+  FFT3DFilter C API - v2.11
+
+  Denoises a stream of planes with the FFT3DFilter engine, without AviSynth.
+  One handle filters one plane of a clip (e.g. the luma); use one handle per plane to filter
+  all planes. Frames are pushed in order and filtered frames are pulled in the same order,
+  a frame is delivered as soon as the frames of its temporal window have been pushed.
+
+    fft3d_params p;
+    fft3d_default_params(&p);
+    p.sigma = 3;
+    fft3d_handle *h = fft3d_create(&p, width, height, 8, 0, -1);
+    if (!h) fprintf(stderr, "%s\n", fft3d_last_error(NULL));
+    for each frame:
+      fft3d_push_plane(h, src, src_pitch);
+      while (fft3d_pull_plane(h, dst, dst_pitch) == FFT3D_OK) write dst;
+    fft3d_finish(h);
+    while (fft3d_pull_plane(h, dst, dst_pitch) == FFT3D_OK) write dst;
+    fft3d_destroy(h);
+
+  The FFTW library (libfftw3f / fftw3.dll) is loaded at fft3d_create like by the plugin.
+  A handle must not be used by more threads at once, different handles may be.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License version 2 as published by
+  the Free Software Foundation.
+*/
+
+#ifndef __FFT3D_CAPI_H__
+#define __FFT3D_CAPI_H__
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#ifdef FFT3D_CAPI_EXPORTS
+#define FFT3D_API __declspec(dllexport)
+#else
+#define FFT3D_API __declspec(dllimport)
+#endif
+#else
+#define FFT3D_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The parameters of the AviSynth function FFT3DFilter, with its defaults (fft3d_default_params) */
+typedef struct fft3d_params {
+  float sigma, beta;
+  int bw, bh, bt, ow, oh;
+  float kratio, sharpen, scutoff, svr, smin, smax;
+  int measure, interlaced, wintype;
+  int pframe, px, py;
+  int pshow; /* not supported, must be 0 */
+  float pcutoff, pfactor;
+  float sigma2, sigma3, sigma4; /* negative: the value of sigma */
+  float degrid, dehalo, hr, ht;
+  int ncpu, numa, halfcache, hugepages;
+  int membudget; /* MB, 0: no limit */
+  int removemean;
+} fft3d_params;
+
+typedef struct fft3d_handle fft3d_handle;
+
+/* fft3d_push_plane, fft3d_pull_plane, fft3d_finish results */
+#define FFT3D_OK 0
+#define FFT3D_NEED_MORE_INPUT 1 /* pull: push the next frame (or finish) first */
+#define FFT3D_END_OF_STREAM 2 /* pull: all frames were delivered */
+#define FFT3D_ERROR -1 /* see fft3d_last_error */
+
+FFT3D_API void fft3d_default_params(fft3d_params *params);
+
+/* Handle filtering planes of width x height pixels.
+   bits_per_pixel: 8, 10, 12, 14, 16 (uint16_t samples) or 32 (float samples)
+   chroma: U or V plane (integer: centered at half range, float: at 0)
+   cpuflags: CPUF_* flags of avs/cpuid.h limiting the SIMD code, -1: detected
+   Returns NULL on error, fft3d_last_error(NULL) tells why. */
+FFT3D_API fft3d_handle *fft3d_create(const fft3d_params *params, int width, int height, int bits_per_pixel, int chroma, int cpuflags);
+
+/* Adds the next frame, pitch in bytes. The plane is copied. */
+FFT3D_API int fft3d_push_plane(fft3d_handle *h, const void *src, ptrdiff_t pitch);
+
+/* No more frames: the last frames can be delivered. */
+FFT3D_API int fft3d_finish(fft3d_handle *h);
+
+/* Writes the next filtered frame to dst, pitch in bytes. */
+FFT3D_API int fft3d_pull_plane(fft3d_handle *h, void *dst, ptrdiff_t pitch);
+
+/* Message of the last error of h, of the last failed fft3d_create for NULL. */
+FFT3D_API const char *fft3d_last_error(const fft3d_handle *h);
+
+FFT3D_API void fft3d_destroy(fft3d_handle *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __FFT3D_CAPI_H__ */
@@ -0,0 +1,61 @@
+//
+//	FFT3DFilter plugin for Avisynth 2.5 - 3D Frequency Domain filter
+//  AVX2 (with F16C) functions
+//
+//	Copyright(C)2004-2006 A.G.Balakhnin aka Fizick, bag@hotmail.ru, http://avisynth.org.ru
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as published by
+//	the Free Software Foundation.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program; if not, write to the Free Software
+//	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//-----------------------------------------------------------------------------------------
+//
+#include <avs/config.h> // x64
+#include <immintrin.h>
+#include <stdint.h>
+
+//-------------------------------------------------------------------------------------------
+// Half precision storage of cached spectra - v2.11
+// Same results as FloatToHalf_C / HalfToFloat_C: scale is a power of 2, rounding is to nearest even
+void FloatToHalf_F16C(const float *src, uint16_t *dst, int count, float scale)
+{
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int i;
+  for (i = 0; i + 8 <= count; i += 8)
+  {
+    __m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + i), vscale);
+    _mm_storeu_si128((__m128i *)(dst + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+  }
+  for (; i < count; i++)
+  {
+    __m128 v = _mm_mul_ss(_mm_load_ss(src + i), _mm256_castps256_ps128(vscale));
+    dst[i] = (uint16_t)_mm_extract_epi16(_mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT), 0);
+  }
+  _mm256_zeroupper();
+}
+
+void HalfToFloat_F16C(const uint16_t *src, float *dst, int count, float scale)
+{
+  const __m256 vscale = _mm256_set1_ps(scale);
+  int i;
+  for (i = 0; i + 8 <= count; i += 8)
+  {
+    __m256 v = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(v, vscale));
+  }
+  for (; i < count; i++)
+  {
+    __m128 v = _mm_cvtph_ps(_mm_cvtsi32_si128(src[i]));
+    _mm_store_ss(dst + i, _mm_mul_ss(v, _mm256_castps256_ps128(vscale)));
+  }
+  _mm256_zeroupper();
+}
@@ -27,6 +27,8 @@
 #include "fftwlite.h"
 #include "math.h" // for sqrtf
 #include <algorithm>
+#include <stdint.h>
+#include <string.h>
 
 // since v1.7 we use outpitch instead of outwidth
 
@@ -161,11 +163,11 @@ void ApplyPattern2D_C(fftwf_complex *outcur, int outwidth, int outpitch, int bh,
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D2_C(fftwf_complex *outcur, fftwf_complex *outprev, 
-					int outwidth, int outpitch, int bh, int howmanyblocks, 
+					fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, 
 					float sigmaSquaredNoiseNormed, 	float beta)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float lowlimit = (beta-1)/beta; //     (beta-1)/beta>=0
 	float psd;
 	float WienerFactor;
@@ -193,12 +195,12 @@ void ApplyWiener3D2_C(fftwf_complex *outcur, fftwf_complex *outprev,
 				f3d1r *= WienerFactor; // apply filter on real  part	
 				f3d1i *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 2 points
-				outprev[w][0] = (f3d0r + f3d1r)*0.5f; // get  real  part	
-				outprev[w][1] = (f3d0i + f3d1i)*0.5f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (f3d0r + f3d1r)*0.5f; // get  real  part	
+				outdst[w][1] = (f3d0i + f3d1i)*0.5f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 		}
 	}
 }
@@ -206,11 +208,11 @@ void ApplyWiener3D2_C(fftwf_complex *outcur, fftwf_complex *outprev,
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D2_C(fftwf_complex *outcur, fftwf_complex *outprev, 
-					 int outwidth, int outpitch, int bh, 
+					 fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					 int howmanyblocks, float *pattern3d, float beta)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float lowlimit = (beta-1)/beta; //     (beta-1)/beta>=0
 	float psd;
 	float WienerFactor;
@@ -238,12 +240,12 @@ void ApplyPattern3D2_C(fftwf_complex *outcur, fftwf_complex *outprev,
 				f3d1r *= WienerFactor; // apply filter on real  part	
 				f3d1i *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 2 points
-				outprev[w][0] = (f3d0r + f3d1r)*0.5f; // get  real  part	
-				outprev[w][1] = (f3d0i + f3d1i)*0.5f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (f3d0r + f3d1r)*0.5f; // get  real  part	
+				outdst[w][1] = (f3d0i + f3d1i)*0.5f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			pattern3d += outpitch;
 		}
 		pattern3d -= outpitch*bh; // restore pointer for new block
@@ -253,11 +255,11 @@ void ApplyPattern3D2_C(fftwf_complex *outcur, fftwf_complex *outprev,
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D3_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, 
-					int outwidth, int outpitch, int bh, int howmanyblocks, 
+					fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, 
 					float sigmaSquaredNoiseNormed, float beta)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni;
 	float WienerFactor;
 	float psd;
@@ -299,12 +301,12 @@ void ApplyWiener3D3_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_compl
 				fnr *= WienerFactor; // apply filter on real  part	
 				fni *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 3 points
-				outprev[w][0] = (fcr + fpr + fnr)*0.33333333333f; // get  real  part	
-				outprev[w][1] = (fci + fpi + fni)*0.33333333333f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (fcr + fpr + fnr)*0.33333333333f; // get  real  part	
+				outdst[w][1] = (fci + fpi + fni)*0.33333333333f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			outnext += outpitch;
 		}
 	}
@@ -312,11 +314,11 @@ void ApplyWiener3D3_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_compl
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D3_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, 
-					 int outwidth, int outpitch, int bh, int howmanyblocks, 
+					 fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, 
 					 float *pattern3d, float beta)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni;
 	float WienerFactor;
 	float psd;
@@ -356,12 +358,12 @@ void ApplyPattern3D3_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_comp
 				fnr *= WienerFactor; // apply filter on real  part	
 				fni *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 3 points
-				outprev[w][0] = (fcr + fpr + fnr)*0.33333333333f; // get  real  part	
-				outprev[w][1] = (fci + fpi + fni)*0.33333333333f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (fcr + fpr + fnr)*0.33333333333f; // get  real  part	
+				outdst[w][1] = (fci + fpi + fni)*0.33333333333f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			outnext += outpitch;
 			pattern3d += outpitch;
 		}
@@ -373,12 +375,12 @@ void ApplyPattern3D3_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_comp
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D4_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					fftwf_complex *outnext, int outwidth, int outpitch, int bh, 
+					fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					int howmanyblocks, float sigmaSquaredNoiseNormed, float beta)
 {
 	// dft with 4 points
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i;
 	float WienerFactor;
 	float psd;
@@ -424,12 +426,12 @@ void ApplyWiener3D4_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_comp
 				fni *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 4 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr)*0.25f; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni)*0.25f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr)*0.25f; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni)*0.25f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 		}
@@ -438,12 +440,12 @@ void ApplyWiener3D4_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_comp
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D4_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					 fftwf_complex *outnext, int outwidth, int outpitch, int bh, 
+					 fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					 int howmanyblocks, float* pattern3d, float beta)
 {
 	// dft with 4 points
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i;
 	float WienerFactor;
 	float psd;
@@ -489,12 +491,12 @@ void ApplyPattern3D4_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_com
 				fni *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 4 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr)*0.25f; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni)*0.25f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr)*0.25f; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni)*0.25f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			pattern3d += outpitch;
@@ -505,15 +507,16 @@ void ApplyPattern3D4_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_com
 //
 //-----------------------------------------------------------------------------------------
 //
+// covar and covarProcess are real: the re and im updates are the same, they are kept once - v2.11
 void ApplyKalmanPattern_C( fftwf_complex *outcur, fftwf_complex *outLast, 
-						fftwf_complex *covar, fftwf_complex *covarProcess,
+						float *covar, float *covarProcess,
 						int outwidth, int outpitch, int bh, int howmanyblocks,  
 						float *covarNoiseNormed, float kratio2)
 {
 // return result in outLast
-	float GainRe, GainIm;  // Kalman Gain 
+	float Gain;  // Kalman Gain 
 //	float filteredRe, filteredIm;
-	float sumre, sumim;
+	float sum;
 	int block;
 	int h,w;
 
@@ -529,10 +532,8 @@ void ApplyKalmanPattern_C( fftwf_complex *outcur, fftwf_complex *outLast,
 				{
 					// big pixel variation due to motion etc
 					// reset filter
-					covar[w][0] = covarNoiseNormed[w]; 
-					covar[w][1] = covarNoiseNormed[w]; 
-					covarProcess[w][0] = covarNoiseNormed[w]; 
-					covarProcess[w][1] = covarNoiseNormed[w]; 
+					covar[w] = covarNoiseNormed[w]; 
+					covarProcess[w] = covarNoiseNormed[w]; 
 					outLast[w][0] = outcur[w][0];
 					outLast[w][1] = outcur[w][1];
 					//return result in outLast
@@ -540,19 +541,15 @@ void ApplyKalmanPattern_C( fftwf_complex *outcur, fftwf_complex *outLast,
 				else
 				{ // small variation
 					// useful sum
-					sumre = (covar[w][0] + covarProcess[w][0]);
-					sumim = (covar[w][1] + covarProcess[w][1]);
-					// real gain, imagine gain
-					GainRe = sumre/(sumre + covarNoiseNormed[w]);
-					GainIm = sumim/(sumim + covarNoiseNormed[w]);
+					sum = (covar[w] + covarProcess[w]);
+					// gain, the same for real and imagine
+					Gain = sum/(sum + covarNoiseNormed[w]);
 					// update process
-					covarProcess[w][0] = (GainRe*GainRe*covarNoiseNormed[w]);
-					covarProcess[w][1] = (GainIm*GainIm*covarNoiseNormed[w]);
+					covarProcess[w] = (Gain*Gain*covarNoiseNormed[w]);
 					// update variation
-					covar[w][0] =  (1-GainRe)*sumre ;
-					covar[w][1] =  (1-GainIm)*sumim ;
-					outLast[w][0] = ( GainRe*outcur[w][0] + (1 - GainRe)*outLast[w][0] );
-					outLast[w][1] = ( GainIm*outcur[w][1] + (1 - GainIm)*outLast[w][1] );
+					covar[w] =  (1-Gain)*sum ;
+					outLast[w][0] = ( Gain*outcur[w][0] + (1 - Gain)*outLast[w][0] );
+					outLast[w][1] = ( Gain*outcur[w][1] + (1 - Gain)*outLast[w][1] );
 					//return filtered result in outLast
 				}
 			}
@@ -568,14 +565,14 @@ void ApplyKalmanPattern_C( fftwf_complex *outcur, fftwf_complex *outLast,
 }
 //-----------------------------------------------------------------------------------------
 //
-void ApplyKalman_C( fftwf_complex *outcur, fftwf_complex *outLast, fftwf_complex *covar, 
-				 fftwf_complex *covarProcess, int outwidth, int outpitch, int bh, 
+void ApplyKalman_C( fftwf_complex *outcur, fftwf_complex *outLast, float *covar, 
+				 float *covarProcess, int outwidth, int outpitch, int bh, 
 				 int howmanyblocks,  float covarNoiseNormed, float kratio2)
 {
 // return result in outLast
-	float GainRe, GainIm;  // Kalman Gain 
+	float Gain;  // Kalman Gain 
 //	float filteredRe, filteredIm;
-	float sumre, sumim;
+	float sum;
 	int block;
 	int h,w;
 
@@ -593,10 +590,8 @@ void ApplyKalman_C( fftwf_complex *outcur, fftwf_complex *outLast, fftwf_complex
 				{
 					// big pixel variation due to motion etc
 					// reset filter
-					covar[w][0] = covarNoiseNormed; 
-					covar[w][1] = covarNoiseNormed; 
-					covarProcess[w][0] = covarNoiseNormed; 
-					covarProcess[w][1] = covarNoiseNormed; 
+					covar[w] = covarNoiseNormed; 
+					covarProcess[w] = covarNoiseNormed; 
 					outLast[w][0] = outcur[w][0];
 					outLast[w][1] = outcur[w][1];
 					//return result in outLast
@@ -604,19 +599,15 @@ void ApplyKalman_C( fftwf_complex *outcur, fftwf_complex *outLast, fftwf_complex
 				else
 				{ // small variation
 					// useful sum
-					sumre = (covar[w][0] + covarProcess[w][0]);
-					sumim = (covar[w][1] + covarProcess[w][1]);
-					// real gain, imagine gain
-					GainRe = sumre/(sumre + covarNoiseNormed);
-					GainIm = sumim/(sumim + covarNoiseNormed);
+					sum = (covar[w] + covarProcess[w]);
+					// gain, the same for real and imagine
+					Gain = sum/(sum + covarNoiseNormed);
 					// update process
-					covarProcess[w][0] = (GainRe*GainRe*covarNoiseNormed);
-					covarProcess[w][1] = (GainIm*GainIm*covarNoiseNormed);
+					covarProcess[w] = (Gain*Gain*covarNoiseNormed);
 					// update variation
-					covar[w][0] =  (1-GainRe)*sumre ;
-					covar[w][1] =  (1-GainIm)*sumim ;
-					outLast[w][0] = ( GainRe*outcur[w][0] + (1 - GainRe)*outLast[w][0] );
-					outLast[w][1] = ( GainIm*outcur[w][1] + (1 - GainIm)*outLast[w][1] );
+					covar[w] =  (1-Gain)*sum ;
+					outLast[w][0] = ( Gain*outcur[w][0] + (1 - Gain)*outLast[w][0] );
+					outLast[w][1] = ( Gain*outcur[w][1] + (1 - Gain)*outLast[w][1] );
 					//return filtered result in outLast
 				}
 			}
@@ -969,12 +960,12 @@ void ApplyWiener2D_degrid_C(fftwf_complex *outcur, int outwidth, int outpitch, i
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, 
-					int outwidth, int outpitch, int bh, int howmanyblocks, 
+					fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, 
 					float sigmaSquaredNoiseNormed, 	float beta, 
 					float degrid, fftwf_complex *gridsample)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float lowlimit = (beta-1)/beta; //     (beta-1)/beta>=0
 	float psd;
 	float WienerFactor;
@@ -1006,12 +997,12 @@ void ApplyWiener3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev,
 				f3d1r *= WienerFactor; // apply filter on real  part	
 				f3d1i *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 2 points
-				outprev[w][0] = (f3d0r + f3d1r + gridcorrection0_2)*0.5f ; // get  real  part	
-				outprev[w][1] = (f3d0i + f3d1i + gridcorrection1_2)*0.5f ; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (f3d0r + f3d1r + gridcorrection0_2)*0.5f ; // get  real  part	
+				outdst[w][1] = (f3d0i + f3d1i + gridcorrection1_2)*0.5f ; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			gridsample += outpitch;
 		}
 		gridsample -= outpitch*bh; // restore pointer to only valid first block
@@ -1020,12 +1011,12 @@ void ApplyWiener3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev,
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, 
-					int outwidth, int outpitch, int bh, int howmanyblocks, 
+					fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, 
 					float sigmaSquaredNoiseNormed, float beta, 
 					float degrid, fftwf_complex *gridsample)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni;
 	float WienerFactor;
 	float psd;
@@ -1070,12 +1061,12 @@ void ApplyWiener3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftw
 				fnr *= WienerFactor; // apply filter on real  part	
 				fni *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 3 points
-				outprev[w][0] = (fcr + fpr + fnr + gridcorrection0_3)*0.33333333333f; // get  real  part	
-				outprev[w][1] = (fci + fpi + fni + gridcorrection1_3)*0.33333333333f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (fcr + fpr + fnr + gridcorrection0_3)*0.33333333333f; // get  real  part	
+				outdst[w][1] = (fci + fpi + fni + gridcorrection1_3)*0.33333333333f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			outnext += outpitch;
 			gridsample += outpitch;
 		}
@@ -1085,13 +1076,13 @@ void ApplyWiener3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftw
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D4_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					fftwf_complex *outnext, int outwidth, int outpitch, int bh, 
+					fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, 
 					float degrid, fftwf_complex *gridsample)
 {
 	// dft with 4 points
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i;
 	float WienerFactor;
 	float psd;
@@ -1142,12 +1133,12 @@ void ApplyWiener3D4_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fft
 				fni *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 4 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr + gridcorrection0_4)*0.25f ; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni + gridcorrection1_4)*0.25f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr + gridcorrection0_4)*0.25f ; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni + gridcorrection1_4)*0.25f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			gridsample += outpitch;
@@ -1201,12 +1192,12 @@ void ApplyPattern2D_degrid_C(fftwf_complex *outcur, int outwidth, int outpitch,
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, 
-					 int outwidth, int outpitch, int bh, 
+					 fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					 int howmanyblocks, float *pattern3d, float beta,
 					 float degrid, fftwf_complex *gridsample)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float lowlimit = (beta-1)/beta; //     (beta-1)/beta>=0
 	float psd;
 	float WienerFactor;
@@ -1237,12 +1228,12 @@ void ApplyPattern3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev,
 				f3d1r *= WienerFactor; // apply filter on real  part	
 				f3d1i *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 2 points
-				outprev[w][0] = (f3d0r + f3d1r + gridcorrection0_2)*0.5f; // get  real  part	
-				outprev[w][1] = (f3d0i + f3d1i + gridcorrection1_2)*0.5f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (f3d0r + f3d1r + gridcorrection0_2)*0.5f; // get  real  part	
+				outdst[w][1] = (f3d0i + f3d1i + gridcorrection1_2)*0.5f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			pattern3d += outpitch;
 			gridsample += outpitch;
 		}
@@ -1254,12 +1245,12 @@ void ApplyPattern3D2_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev,
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fftwf_complex *outnext, 
-					 int outwidth, int outpitch, int bh, int howmanyblocks, 
+					 fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks, 
 					 float *pattern3d, float beta,
 					 float degrid, fftwf_complex *gridsample)
 {
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni;
 	float WienerFactor;
 	float psd;
@@ -1304,12 +1295,12 @@ void ApplyPattern3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fft
 				fnr *= WienerFactor; // apply filter on real  part	
 				fni *= WienerFactor; // apply filter on imaginary part
 				// reverse dft for 3 points
-				outprev[w][0] = (fcr + fpr + fnr + gridcorrection0_3)*0.33333333333f; // get  real  part	
-				outprev[w][1] = (fci + fpi + fni + gridcorrection1_3)*0.33333333333f; // get imaginary part
-				// Attention! return filtered "out" in "outprev" to preserve "out" for next step
+				outdst[w][0] = (fcr + fpr + fnr + gridcorrection0_3)*0.33333333333f; // get  real  part	
+				outdst[w][1] = (fci + fpi + fni + gridcorrection1_3)*0.33333333333f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev += outpitch;
+			outdst += outpitch;
 			outnext += outpitch;
 			pattern3d += outpitch;
 			gridsample += outpitch;
@@ -1322,13 +1313,13 @@ void ApplyPattern3D3_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev, fft
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D4_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					 fftwf_complex *outnext, int outwidth, int outpitch, int bh, 
+					 fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					 int howmanyblocks, float* pattern3d, float beta,
 					 float degrid, fftwf_complex *gridsample)
 {
 	// dft with 4 points
 	// this function take 25% CPU time and may be easy optimized for AMD Athlon 3DNOW assembler
-	// return result in outprev
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i;
 	float WienerFactor;
 	float psd;
@@ -1379,12 +1370,12 @@ void ApplyPattern3D4_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, ff
 				fni *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 4 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr + gridcorrection0_4)*0.25f; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni + gridcorrection1_4)*0.25f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr + gridcorrection0_4)*0.25f; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni + gridcorrection1_4)*0.25f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			pattern3d += outpitch;
@@ -1397,12 +1388,12 @@ void ApplyPattern3D4_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, ff
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D5_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					fftwf_complex *outnext, fftwf_complex *outnext2, int outwidth, int outpitch, int bh, 
+					fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					int howmanyblocks, float *pattern3d, float beta, 
 					float degrid, fftwf_complex *gridsample)
 {
 	// dft with 5 points
-	// return result in outprev2
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i, fn2r, fn2i;
 	float WienerFactor;
 	float psd;
@@ -1472,12 +1463,12 @@ void ApplyPattern3D5_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, ff
 				fn2i *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 5 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr + fn2r + gridcorrection0_5)*0.2f ; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni + fn2i + gridcorrection1_5)*0.2f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr + fn2r + gridcorrection0_5)*0.2f ; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni + fn2i + gridcorrection1_5)*0.2f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			outnext2 += outpitch;
@@ -1492,12 +1483,12 @@ void ApplyPattern3D5_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, ff
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D5_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					fftwf_complex *outnext, fftwf_complex *outnext2, int outwidth, int outpitch, int bh, 
+					fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					int howmanyblocks, float sigmaSquaredNoiseNormed, float beta, 
 					float degrid, fftwf_complex *gridsample)
 {
 	// dft with 5 points
-	// return result in outprev2
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i, fn2r, fn2i;
 	float WienerFactor;
 	float psd;
@@ -1583,12 +1574,12 @@ void ApplyWiener3D5_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fft
 				fn2i *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 5 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr + fn2r + gridcorrection0_5)*0.2f ; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni + fn2i + gridcorrection1_5)*0.2f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr + fn2r + gridcorrection0_5)*0.2f ; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni + fn2i + gridcorrection1_5)*0.2f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			outnext2 += outpitch;
@@ -1600,11 +1591,11 @@ void ApplyWiener3D5_degrid_C(fftwf_complex *outcur, fftwf_complex *outprev2, fft
 //-----------------------------------------------------------------------------------------
 //
 void ApplyPattern3D5_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					fftwf_complex *outnext, fftwf_complex *outnext2, int outwidth, int outpitch, int bh, 
+					fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					int howmanyblocks, float *pattern3d, float beta)
 {
 	// dft with 5 points
-	// return result in outprev2
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i, fn2r, fn2i;
 	float WienerFactor;
 	float psd;
@@ -1669,12 +1660,12 @@ void ApplyPattern3D5_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_com
 				fn2i *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 5 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr + fn2r)*0.2f ; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni + fn2i)*0.2f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr + fn2r)*0.2f ; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni + fn2i)*0.2f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			outnext2 += outpitch;
@@ -1687,11 +1678,11 @@ void ApplyPattern3D5_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_com
 //-----------------------------------------------------------------------------------------
 //
 void ApplyWiener3D5_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_complex *outprev, 
-					fftwf_complex *outnext, fftwf_complex *outnext2, int outwidth, int outpitch, int bh, 
+					fftwf_complex *outnext, fftwf_complex *outnext2, fftwf_complex *outdst, int outwidth, int outpitch, int bh, 
 					int howmanyblocks, float sigmaSquaredNoiseNormed, float beta)
 {
 	// dft with 5 points
-	// return result in outprev2
+	// return result in outdst
 	float fcr, fci, fpr, fpi, fnr, fni, fp2r, fp2i, fn2r, fn2i;
 	float WienerFactor;
 	float psd;
@@ -1756,15 +1747,146 @@ void ApplyWiener3D5_C(fftwf_complex *outcur, fftwf_complex *outprev2, fftwf_comp
 				fn2i *= WienerFactor; // apply filter on imaginary part
 
 				// reverse dft for 5 points
-				outprev2[w][0] = (fp2r + fpr + fcr + fnr + fn2r)*0.2f ; // get  real  part	
-				outprev2[w][1] = (fp2i + fpi + fci + fni + fn2i)*0.2f; // get imaginary part
-				// Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+				outdst[w][0] = (fp2r + fpr + fcr + fnr + fn2r)*0.2f ; // get  real  part	
+				outdst[w][1] = (fp2i + fpi + fci + fni + fn2i)*0.2f; // get imaginary part
 			}
 			outcur += outpitch;
 			outprev2 += outpitch;
+			outdst += outpitch;
 			outprev += outpitch;
 			outnext += outpitch;
 			outnext2 += outpitch;
 		}
 	}
 }
+//-------------------------------------------------------------------------------------------
+// Half precision (IEEE 754 binary16) storage of cached spectra - v2.11
+// Values are multiplied by scale (a power of 2, so exactly) and rounded to nearest even,
+// too large ones become infinity. Gives the same bits as the F16C instructions.
+static inline uint16_t FloatToHalf(float f)
+{
+	uint32_t x;
+	memcpy(&x, &f, 4);
+	uint32_t sign = (x >> 16) & 0x8000;
+	x &= 0x7fffffff;
+	uint32_t h;
+	if (x >= 0x47800000) // 65536 or more: infinity, or NaN (quiet, upper payload bits kept as F16C does)
+		h = x > 0x7f800000 ? 0x7e00 | ((x >> 13) & 0x3ff) : 0x7c00;
+	else if (x < 0x38800000) // less than 2^-14: subnormal or zero
+	{
+		// the float addition aligns and rounds the 10 mantissa bits to the bottom
+		const uint32_t magic_bits = (127 - 15 + 23 - 10 + 1) << 23;
+		float magic, sum;
+		memcpy(&magic, &magic_bits, 4);
+		memcpy(&f, &x, 4);
+		sum = f + magic;
+		memcpy(&h, &sum, 4);
+		h -= magic_bits;
+	}
+	else
+	{
+		uint32_t mant_odd = (x >> 13) & 1;
+		x += ((uint32_t)(15 - 127) << 23) + 0xfff + mant_odd; // rebias exponent, round to nearest even
+		h = x >> 13;
+	}
+	return (uint16_t)(h | sign);
+}
+
+static inline float HalfToFloat(uint16_t h)
+{
+	const uint32_t shifted_exp = 0x7c00 << 13;
+	uint32_t x = (uint32_t)(h & 0x7fff) << 13;
+	uint32_t exp = x & shifted_exp;
+	x += (127 - 15) << 23; // rebias exponent
+	float f;
+	if (exp == shifted_exp) // infinity or NaN
+		x += (128 - 16) << 23;
+	else if (exp == 0) // zero or subnormal: renormalize
+	{
+		const uint32_t magic_bits = 113 << 23;
+		float magic;
+		memcpy(&magic, &magic_bits, 4);
+		x += 1 << 23;
+		memcpy(&f, &x, 4);
+		f -= magic;
+		memcpy(&x, &f, 4);
+	}
+	x |= (uint32_t)(h & 0x8000) << 16;
+	memcpy(&f, &x, 4);
+	return f;
+}
+
+void FloatToHalf_C(const float *src, uint16_t *dst, int count, float scale)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] = FloatToHalf(src[i] * scale);
+}
+
+void HalfToFloat_C(const uint16_t *src, float *dst, int count, float scale)
+{
+	for (int i = 0; i < count; i++)
+		dst[i] = HalfToFloat(src[i]) * scale;
+}
+
+//-------------------------------------------------------------------------------------------
+// YUY2 rows, plane 0: Y (bytes 0, 2, ...), 1: U (bytes 1, 5, ...), 2: V (bytes 3, 7, ...) - v2.11
+void YUY2ToPlaneRow_C(const uint8_t *src, uint8_t *dst, int width, int plane)
+{
+	const int step = plane == 0 ? 2 : 4;
+	const int offset = plane == 0 ? 0 : plane * 2 - 1;
+	for (int x = 0; x < width; x++)
+		dst[x] = src[x * step + offset];
+}
+
+// the other bytes of dst are not changed
+void PlaneRowToYUY2_C(const uint8_t *src, uint8_t *dst, int width, int plane)
+{
+	const int step = plane == 0 ? 2 : 4;
+	const int offset = plane == 0 ? 0 : plane * 2 - 1;
+	for (int x = 0; x < width; x++)
+		dst[x * step + offset] = src[x];
+}
+
+// Y from srcY, U from srcU, V from srcV, all of them YUY2 rows of rowsize bytes
+void MergeYUY2Row_C(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize)
+{
+	for (int w = 0; w < rowsize; w += 4)
+	{
+		dst[w] = srcY[w];
+		dst[w + 1] = srcU[w + 1];
+		dst[w + 2] = srcY[w + 2];
+		dst[w + 3] = srcV[w + 3];
+	}
+}
+
+//-------------------------------------------------------------------------------------------
+// Block mean (removemean) - v2.11
+// wanblock: analysis window of a block (bwbh values), meannorm: 1 / sum of wanblock.
+// The window weighted mean of each block goes to mean, its windowed part is subtracted,
+// so the block has no DC.
+void GetAndSubtractMean_C(float *in, int howmanyblocks, int bwbh, const float *wanblock, float meannorm, float *mean)
+{
+	for (int block = 0; block < howmanyblocks; block++)
+	{
+		float sum = 0;
+		for (int i = 0; i < bwbh; i++)
+			sum += in[i];
+		float meanblock = sum * meannorm;
+		mean[block] = meanblock;
+		for (int i = 0; i < bwbh; i++)
+			in[i] -= meanblock * wanblock[i];
+		in += bwbh;
+	}
+}
+
+// after the inverse FFT, which multiplies by scale (bw*bh)
+void RestoreMean_C(float *in, int howmanyblocks, int bwbh, const float *wanblock, float scale, const float *mean)
+{
+	for (int block = 0; block < howmanyblocks; block++)
+	{
+		float meanblock = mean[block] * scale;
+		for (int i = 0; i < bwbh; i++)
+			in[i] += meanblock * wanblock[i];
+		in += bwbh;
+	}
+}
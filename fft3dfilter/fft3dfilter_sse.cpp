@@ -39,21 +39,22 @@ typedef struct xmmregstruct
 // x64 C -> simd: 10.24 -> 11.41 fps
 // x86 C -> simd:  8.38 ->  9.86 fps
 void ApplyKalman_SSE2_simd(fftwf_complex *outcur, fftwf_complex *outLast,
-  fftwf_complex *covar, fftwf_complex *covarProcess,
+  float *covar, float *covarProcess,
   int outwidth, int outpitch, int bh, int howmanyblocks,
   float covarNoiseNormed, float kratio2)
 {
   // return result in outLast
-  int totalbytes = howmanyblocks*bh*outpitch * 8;
+  // covar and covarProcess are real (the same for re and im), the padding columns are skipped - v2.11
 
   __m128 xmm0, xmm2, xmm3, xmm4, xmm5;
   __m128 covarNoiseNormed_vect = _mm_set1_ps(covarNoiseNormed);
 
   __m128 sigmaSquaredMotionNormed = _mm_mul_ps(covarNoiseNormed_vect, _mm_set1_ps(kratio2));
 
-  for (int eax = 0; eax < totalbytes; eax += 8) {
-    __m128 cur = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>((uint8_t *)outcur + eax))); // cur real | img 
-    __m128 last = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>((uint8_t *)outLast + eax))); // last real | img
+  for (int row = 0; row < howmanyblocks*bh; row++) {
+  for (int w = 0; w < outwidth; w++) {
+    __m128 cur = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(outcur + w))); // cur real | img 
+    __m128 last = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(outLast + w))); // last real | img
                                                                                                                        
     // use one of possible method for motion detection:
     // if ( (outcur[w][0]-outLast[w][0])*(outcur[w][0]-outLast[w][0]) > sigmaSquaredMotionNormed ||
@@ -76,78 +77,58 @@ void ApplyKalman_SSE2_simd(fftwf_complex *outcur, fftwf_complex *outLast,
       // reset filter
       // outLast[w][0] = outcur[w][0];
       // outLast[w][1] = outcur[w][1];
-      _mm_storel_epi64(reinterpret_cast<__m128i *>((uint8_t*)outLast + eax), _mm_castps_si128(cur)); // return result in outLast
-
-      // covar[w][0] = covarNoiseNormed; 
-      // covar[w][1] = covarNoiseNormed; 
-      // covarProcess[w][0] = covarNoiseNormed; 
-      // covarProcess[w][1] = covarNoiseNormed; 
-      _mm_storel_epi64(reinterpret_cast<__m128i *>((uint8_t*)covar + eax), _mm_castps_si128(covarNoiseNormed_vect));
-      _mm_storel_epi64(reinterpret_cast<__m128i *>((uint8_t*)covarProcess + eax), _mm_castps_si128(covarNoiseNormed_vect));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(outLast + w), _mm_castps_si128(cur)); // return result in outLast
+
+      // covar[w] = covarNoiseNormed; 
+      // covarProcess[w] = covarNoiseNormed; 
+      _mm_store_ss(covar + w, covarNoiseNormed_vect);
+      _mm_store_ss(covarProcess + w, covarNoiseNormed_vect);
       continue;
     }
     /*
     // small variation
-    sumre = (covar[w][0] + covarProcess[w][0]);
-    sumim = (covar[w][1] + covarProcess[w][1]);
-    // real gain, imagine gain
-    GainRe = sumre / (sumre + covarNoiseNormed);
-    GainIm = sumim / (sumim + covarNoiseNormed);
+    sum = (covar[w] + covarProcess[w]);
+    Gain = sum / (sum + covarNoiseNormed);
     // update process
-    covarProcess[w][0] = (GainRe*GainRe*covarNoiseNormed);
-    covarProcess[w][1] = (GainIm*GainIm*covarNoiseNormed);
+    covarProcess[w] = (Gain*Gain*covarNoiseNormed);
     // update variation
-    covar[w][0] = (1 - GainRe)*sumre;
-    covar[w][1] = (1 - GainIm)*sumim;
-    outLast[w][0] = (GainRe*outcur[w][0] + (1 - GainRe)*outLast[w][0]);
-    outLast[w][1] = (GainIm*outcur[w][1] + (1 - GainIm)*outLast[w][1]);
+    covar[w] = (1 - Gain)*sum;
+    outLast[w][0] = (Gain*outcur[w][0] + (1 - Gain)*outLast[w][0]);
+    outLast[w][1] = (Gain*outcur[w][1] + (1 - Gain)*outLast[w][1]);
     */
-    __m128 covar_xmm2 = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>((uint8_t *)covar + eax))); // covar
-    __m128 covarProcess_xmm3 = _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>((uint8_t *)covarProcess + eax))); // covarProcess
-
     // useful sum
-    // sumre = (covar[w][0] + covarProcess[w][0]);
-    // sumim = (covar[w][1] + covarProcess[w][1]);
-    __m128 sum_xmm4 = _mm_add_ps(covar_xmm2, covarProcess_xmm3); // sum = (covar +covarProcess)
-
-    // real gain, imagine gain
-    xmm5 = _mm_add_ps(sum_xmm4, covarNoiseNormed_vect); // sum + covarnoise
-    // xmm5.low_ps = Re
-    xmm3 = _mm_shuffle_ps(xmm5, xmm5, _MM_SHUFFLE(2, 3, 0, 1)); // swap re & im
-    // xmm3.low_ps = Im
-
-    // really _mm_scp_ss would be enough,
-    // GainRe = sumre/(sumre + covarNoiseNormed);
-    xmm5 = _mm_rcp_ps(xmm5); // 1/(sumRe + covarnoise)
-    // GainIm = sumim/(sumim + covarNoiseNormed);
-    xmm3 = _mm_rcp_ps(xmm3); // 1/(sumIm + covarnoise)
-    // combine re im
-    xmm5 = _mm_unpacklo_ps(xmm5, xmm3);
-
-    __m128 gain_xmm5 = _mm_mul_ps(xmm5, sum_xmm4); // gain = 1/(sum + covarnoise) * sum
+    __m128 sum_xmm4 = _mm_add_ss(_mm_load_ss(covar + w), _mm_load_ss(covarProcess + w)); // sum = (covar +covarProcess)
+
+    // gain, the same for re and im
+    xmm5 = _mm_add_ss(sum_xmm4, covarNoiseNormed_vect); // sum + covarnoise
+    xmm5 = _mm_rcp_ss(xmm5); // 1/(sum + covarnoise)
+    __m128 gain_xmm5 = _mm_mul_ss(xmm5, sum_xmm4); // gain = 1/(sum + covarnoise) * sum
 
     // update process
-    xmm3 = _mm_mul_ps(gain_xmm5, gain_xmm5); // gain*gain
-    xmm3 = _mm_mul_ps(xmm3, covarNoiseNormed_vect); // gain*gain*covarNoiseNormed
-    // covarProcess[w][0] = (GainRe*GainRe*covarNoiseNormed);
-    // covarProcess[w][1] = (GainIm*GainIm*covarNoiseNormed);
-    _mm_storel_epi64(reinterpret_cast<__m128i *>((uint8_t*)covarProcess + eax), _mm_castps_si128(xmm3));
+    xmm3 = _mm_mul_ss(gain_xmm5, gain_xmm5); // gain*gain
+    xmm3 = _mm_mul_ss(xmm3, covarNoiseNormed_vect); // gain*gain*covarNoiseNormed
+    _mm_store_ss(covarProcess + w, xmm3);
 
     // update variation
-    xmm3 = _mm_mul_ps(gain_xmm5, sum_xmm4); // gain*sum
-    xmm3 = _mm_sub_ps(sum_xmm4, xmm3); // sum - gain*sum
-    // covar[w][0] =  (1-GainRe)*sumre ; = sumre - GainRe*sumre
-    // covar[w][1] =  (1-GainIm)*sumim ;
-    _mm_storel_epi64(reinterpret_cast<__m128i *>((uint8_t*)covar + eax), _mm_castps_si128(xmm3));
+    xmm3 = _mm_mul_ss(gain_xmm5, sum_xmm4); // gain*sum
+    xmm3 = _mm_sub_ss(sum_xmm4, xmm3); // sum - gain*sum
+    // covar[w] =  (1-Gain)*sum ; = sum - Gain*sum
+    _mm_store_ss(covar + w, xmm3);
 
     // make output
+    gain_xmm5 = _mm_shuffle_ps(gain_xmm5, gain_xmm5, _MM_SHUFFLE(0, 0, 0, 0)); // gain for re and im
     xmm0 = _mm_sub_ps(cur, last); // cur-last
     xmm0 = _mm_mul_ps(xmm0, gain_xmm5); // (cur-last)*gain
     xmm0 = _mm_add_ps(xmm0, last); // (cur-last)*gain + last
-    // outLast[w][0] = ( GainRe*outcur[w][0] + (1 - GainRe)*outLast[w][0] ); = GainRe*(outcur[w][0]-outLast[w][0]) + outLast[w][0]
-    // outLast[w][1] = ( GainIm*outcur[w][1] + (1 - GainIm)*outLast[w][1] );
+    // outLast[w][0] = ( Gain*outcur[w][0] + (1 - Gain)*outLast[w][0] ); = Gain*(outcur[w][0]-outLast[w][0]) + outLast[w][0]
+    // outLast[w][1] = ( Gain*outcur[w][1] + (1 - Gain)*outLast[w][1] );
     //return filtered result in outLast
-    _mm_storel_epi64(reinterpret_cast<__m128i *>((uint8_t*)outLast + eax), _mm_castps_si128(xmm0));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(outLast + w), _mm_castps_si128(xmm0));
+  }
+  outcur += outpitch;
+  outLast += outpitch;
+  covar += outpitch;
+  covarProcess += outpitch;
   }
 }
 
@@ -155,10 +136,10 @@ void ApplyKalman_SSE2_simd(fftwf_complex *outcur, fftwf_complex *outLast,
 // bt=2, degrid=0, pfactor=0
 // PF 170302 simd, SSE2 x64 C -> x64 simd: 11.37 -> 13.26
 void ApplyWiener3D2_SSE_simd(fftwf_complex *outcur, fftwf_complex *outprev,
-  int outwidth, int outpitch, int bh, int howmanyblocks,
+  fftwf_complex *outdst, int outwidth, int outpitch, int bh, int howmanyblocks,
   float sigmaSquaredNoiseNormed, float beta)
 {
-  // return result in outprev
+  // return result in outdst
 
   int totalbytes = howmanyblocks*bh*outpitch * 8;
 
@@ -230,8 +211,7 @@ void ApplyWiener3D2_SSE_simd(fftwf_complex *outcur, fftwf_complex *outprev,
     // outprev[w][0] = (f3d0r + f3d1r)*0.5f; // get real part
     // outprev[w][1] = (f3d0i + f3d1i)*0.5f; // get imaginary part
     xmm2 = _mm_mul_ps(xmm2, onehalf); // filterd(sum + dif)*0.5
-    _mm_store_ps(reinterpret_cast<float *>((uint8_t*)outprev + n), xmm2);
-    // Attention! return filtered "outcur" in "outprev" to preserve "outcur" for next step
+    _mm_store_ps(reinterpret_cast<float *>((uint8_t*)outdst + n), xmm2);
   }
 }
 
@@ -242,11 +222,11 @@ inline __m128 _mm_swap_re_im(__m128 x)
 
 void ApplyWiener3D4_SSE_simd(fftwf_complex* outcur, fftwf_complex* outprev2,
   fftwf_complex* outprev, fftwf_complex* outnext,
-  int outwidth, int outpitch, int bh, int howmanyblocks,
+  fftwf_complex* outdst, int outwidth, int outpitch, int bh, int howmanyblocks,
   float sigmaSquaredNoiseNormed, float beta)
 {
   // dft 3d (very short - 3 points)
-  // return result in outprev
+  // return result in outdst
   // float fcr, fci, fpr, fpi, fnr, fni;
   // float pnr, pni, di, dr;
   // float WienerFactor =1;
@@ -356,9 +336,7 @@ void ApplyWiener3D4_SSE_simd(fftwf_complex* outcur, fftwf_complex* outprev2,
     final_sum = _mm_mul_ps(final_sum, onefourth_ps);
     // outprev2[w][0] = (fcr + fpr + fnr + fp2r)*0.25f; // get real part
     // outprev2[w][1] = (fci + fpi + fni + fp2i)*0.25f; // get imaginary part
-    _mm_storel_epi64(reinterpret_cast<__m128i*>((uint8_t*)outprev2 + eax), _mm_castps_si128(final_sum));
-    // write output to prev array
-    // Attention! return filtered "out" in "outprev2" to preserve "out" for next step
+    _mm_storel_epi64(reinterpret_cast<__m128i*>((uint8_t*)outdst + eax), _mm_castps_si128(final_sum));
   }
 }
 
@@ -1410,13 +1388,13 @@ finish:			emms;
 
 // bt=3
 void ApplyWiener3D3_degrid_SSE_simd(fftwf_complex *outcur, fftwf_complex *outprev,
-  fftwf_complex *outnext, int outwidth, int outpitch, int bh,
+  fftwf_complex *outnext, fftwf_complex *outdst, int outwidth, int outpitch, int bh,
   int howmanyblocks, float sigmaSquaredNoiseNormed, float beta,
   float degrid, fftwf_complex *gridsample)
 {
   // dft 3d (very short - 3 points)
   // optimized for SSE assembler
-  // return result in outprev
+  // return result in outdst
   //	float fcr, fci, fpr, fpi, fnr, fni;
   //	float pnr, pni, di, dr;
   //	float WienerFactor =1;
@@ -1444,6 +1422,7 @@ void ApplyWiener3D3_degrid_SSE_simd(fftwf_complex *outcur, fftwf_complex *outpre
   uint8_t*pOutcur = (uint8_t*)outcur; //  mov esi, outcur; // current
   uint8_t*pOutPrev = (uint8_t*)outprev; //  mov edi, outprev;
   uint8_t*pOutNext = (uint8_t*)outnext; //  mov edx, outnext;
+  uint8_t*pOutDst = (uint8_t*)outdst;
 
   __m128 xmm1, xmm2, xmm3, xmm4, xmm5, xmm6, xmm7;
 
@@ -1559,11 +1538,11 @@ void ApplyWiener3D3_degrid_SSE_simd(fftwf_complex *outcur, fftwf_complex *outpre
       // outprev[w][0] = (fcr + fpr + fnr)*0.33333333333f; // get  real  part	
       // outprev[w][1] = (fci + fpi + fni)*0.33333333333f; // get imaginary part
 
-      _mm_store_ps((float *)(pOutPrev + eax), xmm4); // movaps[edi + n], xmm4; // write output to prev array
-                               // Attention! return filtered "out" in "outprev" to preserve "out" for next step
+      _mm_store_ps((float *)(pOutDst + eax), xmm4); // write output
     }
     pOutNext += ecx_bytesperblock;
     pOutPrev += ecx_bytesperblock;
+    pOutDst += ecx_bytesperblock;
     pOutcur += ecx_bytesperblock;
   }
 } // simd
@@ -2390,3 +2369,132 @@ finish:			emms;
 #endif
 }
 
+
+//-------------------------------------------------------------------------------------------
+// YUY2 rows - v2.11, same as the _C versions
+void YUY2ToPlaneRow_C(const uint8_t *src, uint8_t *dst, int width, int plane);
+void PlaneRowToYUY2_C(const uint8_t *src, uint8_t *dst, int width, int plane);
+void MergeYUY2Row_C(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize);
+
+void YUY2ToPlaneRow_SSE2(const uint8_t *src, uint8_t *dst, int width, int plane)
+{
+	int x = 0;
+	if (plane == 0)
+	{
+		const __m128i lobytes = _mm_set1_epi16(0x00FF);
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 2 * x)), lobytes);
+			__m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(src + 2 * x + 16)), lobytes);
+			_mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(a, b));
+		}
+		YUY2ToPlaneRow_C(src + 2 * x, dst + x, width - x, plane);
+	}
+	else
+	{
+		const __m128i lobyte = _mm_set1_epi32(0xFF);
+		const __m128i shift = _mm_cvtsi32_si128(plane == 1 ? 8 : 24);
+		for (; x + 16 <= width; x += 16)
+		{
+			const uint8_t *s = src + 4 * x;
+			__m128i a = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)s), shift), lobyte);
+			__m128i b = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(s + 16)), shift), lobyte);
+			__m128i c = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(s + 32)), shift), lobyte);
+			__m128i d = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128((const __m128i *)(s + 48)), shift), lobyte);
+			_mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+		}
+		YUY2ToPlaneRow_C(src + 4 * x, dst + x, width - x, plane);
+	}
+}
+
+void PlaneRowToYUY2_SSE2(const uint8_t *src, uint8_t *dst, int width, int plane)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int x = 0;
+	if (plane == 0)
+	{
+		const __m128i keep = _mm_set1_epi16((short)0xFF00);
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i *)(src + x));
+			__m128i *d = (__m128i *)(dst + 2 * x);
+			_mm_storeu_si128(d, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(d), keep), _mm_unpacklo_epi8(p, zero)));
+			_mm_storeu_si128(d + 1, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(d + 1), keep), _mm_unpackhi_epi8(p, zero)));
+		}
+		PlaneRowToYUY2_C(src + x, dst + 2 * x, width - x, plane);
+	}
+	else
+	{
+		const int bits = plane == 1 ? 8 : 24;
+		const __m128i keep = _mm_set1_epi32(~(0xFF << bits));
+		const __m128i shift = _mm_cvtsi32_si128(bits);
+		for (; x + 16 <= width; x += 16)
+		{
+			__m128i p = _mm_loadu_si128((const __m128i *)(src + x));
+			__m128i lo = _mm_unpacklo_epi8(p, zero);
+			__m128i hi = _mm_unpackhi_epi8(p, zero);
+			__m128i q[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero), _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+			__m128i *d = (__m128i *)(dst + 4 * x);
+			for (int i = 0; i < 4; i++)
+				_mm_storeu_si128(d + i, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(d + i), keep), _mm_sll_epi32(q[i], shift)));
+		}
+		PlaneRowToYUY2_C(src + x, dst + 4 * x, width - x, plane);
+	}
+}
+
+void MergeYUY2Row_SSE2(const uint8_t *srcY, const uint8_t *srcU, const uint8_t *srcV, uint8_t *dst, int rowsize)
+{
+	const __m128i maskY = _mm_set1_epi16(0x00FF);
+	const __m128i maskU = _mm_set1_epi32(0x0000FF00);
+	const __m128i maskV = _mm_set1_epi32((int)0xFF000000);
+	int w = 0;
+	for (; w + 16 <= rowsize; w += 16)
+	{
+		__m128i y = _mm_and_si128(_mm_loadu_si128((const __m128i *)(srcY + w)), maskY);
+		__m128i u = _mm_and_si128(_mm_loadu_si128((const __m128i *)(srcU + w)), maskU);
+		__m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i *)(srcV + w)), maskV);
+		_mm_storeu_si128((__m128i *)(dst + w), _mm_or_si128(y, _mm_or_si128(u, v)));
+	}
+	MergeYUY2Row_C(srcY + w, srcU + w, srcV + w, dst + w, rowsize - w);
+}
+
+//-------------------------------------------------------------------------------------------
+// Block mean (removemean) - v2.11, see GetAndSubtractMean_C
+void GetAndSubtractMean_SSE2(float *in, int howmanyblocks, int bwbh, const float *wanblock, float meannorm, float *mean)
+{
+	for (int block = 0; block < howmanyblocks; block++)
+	{
+		__m128 sum4 = _mm_setzero_ps();
+		int i;
+		for (i = 0; i + 4 <= bwbh; i += 4)
+			sum4 = _mm_add_ps(sum4, _mm_loadu_ps(in + i));
+		sum4 = _mm_add_ps(sum4, _mm_movehl_ps(sum4, sum4));
+		sum4 = _mm_add_ss(sum4, _mm_shuffle_ps(sum4, sum4, 1));
+		float sum = _mm_cvtss_f32(sum4);
+		for (; i < bwbh; i++)
+			sum += in[i];
+		float meanblock = sum * meannorm;
+		mean[block] = meanblock;
+		const __m128 m = _mm_set1_ps(meanblock);
+		for (i = 0; i + 4 <= bwbh; i += 4)
+			_mm_storeu_ps(in + i, _mm_sub_ps(_mm_loadu_ps(in + i), _mm_mul_ps(m, _mm_loadu_ps(wanblock + i))));
+		for (; i < bwbh; i++)
+			in[i] -= meanblock * wanblock[i];
+		in += bwbh;
+	}
+}
+
+void RestoreMean_SSE2(float *in, int howmanyblocks, int bwbh, const float *wanblock, float scale, const float *mean)
+{
+	for (int block = 0; block < howmanyblocks; block++)
+	{
+		float meanblock = mean[block] * scale;
+		const __m128 m = _mm_set1_ps(meanblock);
+		int i;
+		for (i = 0; i + 4 <= bwbh; i += 4)
+			_mm_storeu_ps(in + i, _mm_add_ps(_mm_loadu_ps(in + i), _mm_mul_ps(m, _mm_loadu_ps(wanblock + i))));
+		for (; i < bwbh; i++)
+			in[i] += meanblock * wanblock[i];
+		in += bwbh;
+	}
+}
@@ -0,0 +1,57 @@
+#ifndef __FRAMESTATS_H__
+#define __FRAMESTATS_H__
+
+// Counters and timings of one filter instance for the current frame (stats=true).
+// The timings are summed over all threads which worked on the frame, so with
+// ncpu>1 they can be more than the wall clock time of the frame.
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+
+struct FrameStats {
+  std::atomic<int64_t> fftns; // forward and inverse FFT
+  std::atomic<int64_t> kernelns; // frequency domain filters (Wiener, Kalman, pattern, sharpen)
+  std::atomic<int64_t> overlapns; // source plane to overlapped windowed blocks
+  std::atomic<int64_t> decodens; // blocks back to the destination plane
+  int cachehits; // spectra of the temporal window found in the cache (bt=2..5)
+  int cachemisses; // spectra of the temporal window made for this frame
+  int pipehits; // spectrum made in background was the needed one
+  int pipemisses; // spectrum made in background was thrown away (not sequential access)
+
+  FrameStats() { clear(); }
+
+  void clear()
+  {
+    fftns = 0;
+    kernelns = 0;
+    overlapns = 0;
+    decodens = 0;
+    cachehits = cachemisses = 0;
+    pipehits = pipemisses = 0;
+  }
+};
+
+// Adds the time spent in its scope to acc, does nothing when acc is null.
+class ScopedTimer {
+  std::atomic<int64_t>* acc;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  explicit ScopedTimer(std::atomic<int64_t>* _acc) : acc(_acc)
+  {
+    if (acc != nullptr)
+      start = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedTimer()
+  {
+    if (acc != nullptr)
+      *acc += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+#endif // __FRAMESTATS_H__
@@ -0,0 +1,239 @@
+#ifndef __STAGEPROFILE_H__
+#define __STAGEPROFILE_H__
+
+// Per stage timing of one filter instance over its whole life, for profiling builds.
+// Compiled in only with FFT3D_PROFILE defined (CMake option FFT3D_PROFILE), otherwise
+// the PROFILE_STAGE probes are empty and cost nothing.
+// Every pass through a probed stage adds one sample: its duration in ticks (TSC on x86,
+// nanoseconds elsewhere) to the count, sum, min, max and a log2 histogram of the stage.
+// Samples may come from several threads at once (ncpu>1, pipeline), so a stage is called
+// per stripe or block row there and the sums can be more than the wall clock time.
+//
+// With FFT3D_ITT defined (CMake option FFT3D_ITT) the same probes are also ITT tasks of the
+// "FFT3DFilter" domain, named as the stages, so VTune (or any ITT collector) shows them on
+// its timeline and groups the samples by stage. Without a collector attached they are no-ops.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#ifdef FFT3D_ITT
+#include <ittnotify.h>
+#endif
+
+// Stage and kernel entry points are kept out of line, so sampling profilers (perf, VTune)
+// attribute their samples to a frame of their own name instead of to the caller
+#if defined(_MSC_VER)
+#define FFT3D_NOINLINE __declspec(noinline)
+#else
+#define FFT3D_NOINLINE __attribute__((noinline))
+#endif
+
+enum ProfileStage {
+  STAGE_SOURCE, // child->GetFrame
+  STAGE_OVERLAP, // source plane to overlapped windowed blocks (InitOverlapPlane)
+  STAGE_FFT, // forward FFT
+  STAGE_KERNEL, // Wiener, pattern and Kalman filters, temporal ones with their FP16 expansion
+  STAGE_SHARPEN, // Sharpen, Sharpen_degrid (2D Wiener sharpens inside STAGE_KERNEL)
+  STAGE_IFFT, // inverse FFT
+  STAGE_DECODE, // blocks back to the destination plane (DecodeOverlapPlane)
+  STAGE_COUNT
+};
+
+class StageProfile {
+public:
+  static const int buckets = 48; // bucket b: durations of 2^b .. 2^(b+1)-1 ticks
+
+  struct Stage {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+    std::atomic<uint64_t> hist[buckets];
+  };
+
+  StageProfile() { clear(); }
+
+  static uint64_t now()
+  {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  void add(int stage, uint64_t ticks)
+  {
+    Stage& s = stages[stage];
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(ticks, std::memory_order_relaxed);
+    s.hist[bucket(ticks)].fetch_add(1, std::memory_order_relaxed);
+    uint64_t m = s.min.load(std::memory_order_relaxed);
+    while (ticks < m && !s.min.compare_exchange_weak(m, ticks, std::memory_order_relaxed))
+      ;
+    m = s.max.load(std::memory_order_relaxed);
+    while (ticks > m && !s.max.compare_exchange_weak(m, ticks, std::memory_order_relaxed))
+      ;
+  }
+
+  void clear()
+  {
+    for (Stage& s : stages)
+    {
+      s.count = 0;
+      s.sum = 0;
+      s.min = UINT64_MAX;
+      s.max = 0;
+      for (auto& h : s.hist)
+        h = 0;
+    }
+    starttick = now();
+    starttime = std::chrono::steady_clock::now();
+  }
+
+  const Stage& stage(int stage) const { return stages[stage]; }
+
+  uint64_t samples() const
+  {
+    uint64_t n = 0;
+    for (const Stage& s : stages)
+      n += s.count;
+    return n;
+  }
+
+  // ticks are measured against the clock since clear(), 1 without TSC
+  double ns_per_tick() const
+  {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - starttime).count();
+    uint64_t ticks = now() - starttick;
+    return ticks > 0 ? ns / ticks : 1.0;
+#else
+    return 1.0;
+#endif
+  }
+
+  static const char* name(int stage)
+  {
+    static const char* const names[STAGE_COUNT] = { "source", "overlap", "fft", "kernel", "sharpen", "ifft", "decode" };
+    return names[stage];
+  }
+
+  // table of the stages which were called, times in microseconds;
+  // p50/p90/p99 are the upper ends of their histogram buckets
+  void print(FILE* f, const char* title) const
+  {
+    double us = ns_per_tick() / 1000;
+    fprintf(f, "%s\n", title);
+    fprintf(f, "  %-8s %9s %11s %9s %9s %9s %9s %9s %9s\n", "stage", "calls", "total ms", "mean us", "min us", "p50 us", "p90 us", "p99 us", "max us");
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+      const Stage& s = stages[i];
+      uint64_t n = s.count;
+      if (n == 0)
+        continue;
+      fprintf(f, "  %-8s %9llu %11.3f %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", name(i), (unsigned long long)n,
+        s.sum * us / 1000, (double)s.sum * us / n, s.min * us,
+        percentile(s, 0.50) * us, percentile(s, 0.90) * us, percentile(s, 0.99) * us, s.max * us);
+    }
+    fprintf(f, "  histogram: calls per duration, bucket upper ends in us\n");
+    for (int i = 0; i < STAGE_COUNT; i++)
+    {
+      const Stage& s = stages[i];
+      if (s.count == 0)
+        continue;
+      fprintf(f, "  %-8s", name(i));
+      for (int b = 0; b < buckets; b++)
+        if (s.hist[b] != 0)
+          fprintf(f, " <%.3g:%llu", ldexp(1.0, b + 1) * us, (unsigned long long)s.hist[b].load());
+      fprintf(f, "\n");
+    }
+  }
+
+private:
+  Stage stages[STAGE_COUNT];
+  uint64_t starttick;
+  std::chrono::steady_clock::time_point starttime;
+
+  static int bucket(uint64_t ticks)
+  {
+    int b = 0;
+    while (ticks > 1 && b < buckets - 1)
+    {
+      ticks >>= 1;
+      b++;
+    }
+    return b;
+  }
+
+  static double percentile(const Stage& s, double p)
+  {
+    uint64_t n = s.count, seen = 0;
+    for (int b = 0; b < buckets; b++)
+    {
+      seen += s.hist[b];
+      if (seen >= p * n)
+        return std::min((double)s.max, ldexp(1.0, b + 1));
+    }
+    return (double)s.max;
+  }
+};
+
+// Adds the time spent in its scope to one stage of a profile.
+class StageProbe {
+  StageProfile& profile;
+  int stage;
+  uint64_t start;
+
+public:
+  StageProbe(StageProfile& _profile, int _stage) : profile(_profile), stage(_stage), start(StageProfile::now()) {}
+  ~StageProbe() { profile.add(stage, StageProfile::now() - start); }
+
+  StageProbe(const StageProbe&) = delete;
+  StageProbe& operator=(const StageProbe&) = delete;
+};
+
+#ifdef FFT3D_ITT
+// An ITT task for the time spent in its scope, named as the stage.
+class StageTask {
+public:
+  explicit StageTask(int stage)
+  {
+    static __itt_domain* const domain = __itt_domain_create("FFT3DFilter");
+    static __itt_string_handle* const handles[STAGE_COUNT] = {
+      __itt_string_handle_create("fft3d_source"), __itt_string_handle_create("fft3d_overlap"),
+      __itt_string_handle_create("fft3d_fft"), __itt_string_handle_create("fft3d_kernel"),
+      __itt_string_handle_create("fft3d_sharpen"), __itt_string_handle_create("fft3d_ifft"),
+      __itt_string_handle_create("fft3d_decode") };
+    current = domain;
+    __itt_task_begin(domain, __itt_null, __itt_null, handles[stage]);
+  }
+  ~StageTask() { __itt_task_end(current); }
+
+  StageTask(const StageTask&) = delete;
+  StageTask& operator=(const StageTask&) = delete;
+
+private:
+  const __itt_domain* current;
+};
+#define ITT_STAGE(stage) StageTask stage_task(stage)
+#else
+#define ITT_STAGE(stage)
+#endif
+
+// in members of a class having a StageProfile 'profile' member
+#ifdef FFT3D_PROFILE
+#define PROFILE_STAGE(stage) ITT_STAGE(stage); StageProbe stage_probe(profile, stage)
+#else
+#define PROFILE_STAGE(stage) ITT_STAGE(stage)
+#endif
+
+#endif // __STAGEPROFILE_H__
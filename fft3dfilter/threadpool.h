@@ -0,0 +1,239 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+// Small internal worker pool used to spread the work of a single frame
+// (block rows, stripes) over several cores, and a single background worker
+// for running ahead of GetFrame.
+// Worker functions must not call back into the Avisynth environment.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Restricts thread t to the processors of the NUMA node the calling thread is running on,
+// on Linux limited to the affinity mask of the process.
+// Returns false when it is not supported or the node cannot be determined.
+inline bool BindThreadToCallerNode(std::thread& t)
+{
+#ifdef _WIN32
+  PROCESSOR_NUMBER pn;
+  USHORT node;
+  GROUP_AFFINITY ga;
+  GetCurrentProcessorNumberEx(&pn);
+  if (!GetNumaProcessorNodeEx(&pn, &node) || !GetNumaNodeProcessorMaskEx(node, &ga))
+    return false;
+  return SetThreadGroupAffinity((HANDLE)t.native_handle(), &ga, NULL) != 0;
+#elif defined(__linux__)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+    return false;
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    return false;
+  // list like "0-7,16-23"
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  int from, to;
+  while (fscanf(f, "%d", &from) == 1)
+  {
+    to = from;
+    int c = fgetc(f);
+    if (c == '-')
+    {
+      if (fscanf(f, "%d", &to) != 1)
+        break;
+      c = fgetc(f);
+    }
+    for (int i = from; i <= to && i < CPU_SETSIZE; i++)
+      CPU_SET(i, &set);
+    if (c != ',')
+      break;
+  }
+  fclose(f);
+  // only the processors of the node this process is allowed to run on (taskset, cgroup cpusets)
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return false;
+  CPU_AND(&set, &set, &allowed);
+  if (CPU_COUNT(&set) == 0)
+    return false;
+  return pthread_setaffinity_np(t.native_handle(), sizeof(set), &set) == 0;
+#else
+  (void)t;
+  return false;
+#endif
+}
+
+// The calling thread takes part in the work, so a pool of size n creates n-1 threads.
+class ThreadPool {
+  std::vector<std::thread> workers;
+  std::mutex mtx;
+  std::condition_variable cv_start;
+  std::condition_variable cv_done;
+  const std::function<void(int)>* job;
+  int jobcount;
+  std::atomic<int> next;
+  int busy; // workers not yet finished with the current job
+  unsigned generation; // incremented for each new job
+  bool quit;
+
+  void run_items()
+  {
+    int i;
+    while ((i = next.fetch_add(1)) < jobcount)
+      (*job)(i);
+  }
+
+  void worker()
+  {
+    unsigned seen = 0;
+    for (;;)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv_start.wait(lock, [&] { return quit || generation != seen; });
+        if (quit)
+          return;
+        seen = generation;
+      }
+      run_items();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--busy == 0)
+          cv_done.notify_one();
+      }
+    }
+  }
+
+public:
+  explicit ThreadPool(int nthreads) : job(nullptr), jobcount(0), next(0), busy(0), generation(0), quit(false)
+  {
+    for (int i = 1; i < nthreads; i++)
+      workers.emplace_back(&ThreadPool::worker, this);
+  }
+
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      quit = true;
+    }
+    cv_start.notify_all();
+    for (auto& t : workers)
+      t.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int size() const { return (int)workers.size() + 1; }
+
+  // moves the workers to the NUMA node of the calling thread
+  void bind_to_caller_node()
+  {
+    for (auto& t : workers)
+      BindThreadToCallerNode(t);
+  }
+
+  // calls func(i) for every i in [0, count), returns when all of them are finished
+  void parallel_for(int count, const std::function<void(int)>& func)
+  {
+    if (workers.empty() || count <= 1)
+    {
+      for (int i = 0; i < count; i++)
+        func(i);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      job = &func;
+      jobcount = count;
+      next = 0;
+      busy = (int)workers.size();
+      generation++;
+    }
+    cv_start.notify_all();
+    run_items();
+    std::unique_lock<std::mutex> lock(mtx);
+    cv_done.wait(lock, [&] { return busy == 0; });
+    job = nullptr;
+  }
+};
+
+// Single background thread, runs the submitted jobs one after the other.
+// Queued jobs are still finished by the destructor.
+class SerialWorker {
+  std::thread thread;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::deque<std::packaged_task<void()>> jobs;
+  bool quit;
+
+  void run()
+  {
+    for (;;)
+    {
+      std::packaged_task<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [&] { return quit || !jobs.empty(); });
+        if (jobs.empty())
+          return;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+public:
+  SerialWorker() : quit(false)
+  {
+    thread = std::thread(&SerialWorker::run, this);
+  }
+
+  ~SerialWorker()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      quit = true;
+    }
+    cv.notify_one();
+    thread.join();
+  }
+
+  SerialWorker(const SerialWorker&) = delete;
+  SerialWorker& operator=(const SerialWorker&) = delete;
+
+  void bind_to_caller_node() { BindThreadToCallerNode(thread); }
+
+  std::future<void> submit(std::function<void()> func)
+  {
+    std::packaged_task<void()> job(std::move(func));
+    std::future<void> done = job.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return done;
+  }
+};
+
+#endif // __THREADPOOL_H__
@@ -0,0 +1,336 @@
+//
+//	FFT3DFilter plugin for Avisynth 2.6 and Avisynth+ - 3D Frequency Domain filter
+//  FFT3DFilter_Tune: block size, overlap, window and kernel set tuner - v2.11
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as published by
+//	the Free Software Foundation.
+//
+//	This program is distributed in the hope that it will be useful,
+//	but WITHOUT ANY WARRANTY; without even the implied warranty of
+//	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//	GNU General Public License for more details.
+//
+//	You should have received a copy of the GNU General Public License
+//	along with this program; if not, write to the Free Software
+//	Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+//
+//-----------------------------------------------------------------------------------------
+//
+// The sample frames start..start+frames-1 of the clip are filtered with the default block
+// settings (bw=bh=32, ow=oh=bw/3, wintype=0, all kernels of the CPU): the reference.
+// Then with every combination of the bws, overlaps (ow=bw/overlap), wintypes and opts lists,
+// each timed over the sample after two warmup frames and compared to the reference:
+// PSNR over the filtered planes, SSIM of the first filtered plane. The accepted ones are
+// timed in two more rounds over all of them, the best round counts.
+// The fastest combination with at least psnr dB and ssim is returned as FFT3DFilter arguments,
+//   Eval("FFT3DFilter(sigma=3, " + FFT3DFilter_Tune(sigma=3) + ")")
+// The result is kept per resolution, format and arguments for the life of the process,
+// and in the cache file if given. log: file for the table of all combinations.
+
+#include "tune.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct TuneConfig {
+  int bw, ow, wintype, opt;
+};
+
+struct TuneResult {
+  TuneConfig config;
+  double fps, psnr, ssim;
+  bool ok;
+};
+
+std::mutex tunemutex;
+std::map<std::string, std::string> tunecache; // key: resolution, format, arguments
+
+std::vector<int> ParseInts(const char *s)
+{
+  std::vector<int> list;
+  while (s && *s)
+  {
+    char *end;
+    long v = strtol(s, &end, 10);
+    if (end == s)
+      break;
+    list.push_back((int)v);
+    s = *end == ',' ? end + 1 : end;
+  }
+  return list;
+}
+
+// One processed plane of a frame, samples read as 0..1
+struct PlaneView {
+  const uint8_t *ptr;
+  int pitch, width, height, bits;
+  double scale;
+
+  double operator()(int x, int y) const
+  {
+    const uint8_t *row = ptr + (size_t)y * pitch;
+    return bits == 8 ? row[x] * scale : bits == 32 ? ((const float *)row)[x] : ((const uint16_t *)row)[x] * scale;
+  }
+};
+
+// The planes of a frame the filter processed
+class PlaneReader {
+  const VideoInfo &vi;
+  std::vector<int> planes; // AviSynth plane ids, 0: packed YUY2
+
+public:
+  PlaneReader(const VideoInfo &_vi, int plane) : vi(_vi)
+  {
+    if (!vi.IsPlanar())
+    {
+      planes.push_back(0);
+      return;
+    }
+    const int yuv[3] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+    const int rgb[3] = { PLANAR_R, PLANAR_G, PLANAR_B };
+    if (vi.IsY())
+      planes.push_back(PLANAR_Y);
+    else if (vi.IsRGB())
+      planes.assign(rgb, rgb + 3); // plane=-1 filters them all, plane 0..2 one of them: compared all the same
+    else if (plane == 3)
+      planes = { PLANAR_U, PLANAR_V };
+    else if (plane == 4)
+      planes.assign(yuv, yuv + 3);
+    else
+      planes.push_back(yuv[std::max(0, std::min(plane, 2))]);
+  }
+
+  int Count() const { return (int)planes.size(); }
+
+  PlaneView View(const PVideoFrame &f, int i) const
+  {
+    int p = planes[i];
+    int bits = vi.BitsPerComponent();
+    return { p ? f->GetReadPtr(p) : f->GetReadPtr(), p ? f->GetPitch(p) : f->GetPitch(),
+      (p ? f->GetRowSize(p) : f->GetRowSize()) / vi.ComponentSize(), p ? f->GetHeight(p) : f->GetHeight(),
+      bits, bits == 32 ? 1.0 : 1.0 / ((1 << bits) - 1) };
+  }
+};
+
+void SquaredError(const PlaneView &a, const PlaneView &b, double &se, size_t &count)
+{
+  for (int y = 0; y < a.height; y++)
+    for (int x = 0; x < a.width; x++)
+    {
+      double d = a(x, y) - b(x, y);
+      se += d * d;
+    }
+  count += (size_t)a.width * a.height;
+}
+
+// mean SSIM of 8x8 windows on a 4 pixel grid, values in 0..1
+double SSIM(const PlaneView &a, const PlaneView &b)
+{
+  const double c1 = 0.01 * 0.01, c2 = 0.03 * 0.03;
+  double sum = 0;
+  int count = 0;
+  for (int y = 0; y + 8 <= a.height; y += 4)
+    for (int x = 0; x + 8 <= a.width; x += 4)
+    {
+      double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+      for (int j = 0; j < 8; j++)
+        for (int i = 0; i < 8; i++)
+        {
+          double va = a(x + i, y + j), vb = b(x + i, y + j);
+          sa += va; sb += vb; saa += va * va; sbb += vb * vb; sab += va * vb;
+        }
+      double ma = sa / 64, mb = sb / 64;
+      double va = saa / 64 - ma * ma, vb = sbb / 64 - mb * mb, cov = sab / 64 - ma * mb;
+      sum += (2 * ma * mb + c1) * (2 * cov + c2) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+      count++;
+    }
+  return count ? sum / count : 1.0;
+}
+
+} // namespace
+
+AVSValue __cdecl Create_FFT3DFilterTune(AVSValue args, void* user_data, IScriptEnvironment* env)
+{
+  (void)user_data;
+  PClip clip = args[0].AsClip();
+  const VideoInfo &vi = clip->GetVideoInfo();
+  float sigma = (float)args[1].AsFloat(2.0f);
+  float beta = (float)args[2].AsFloat(1.0f);
+  int plane = args[3].AsInt(-1);
+  int bt = args[4].AsInt(3);
+  float sharpen = (float)args[5].AsFloat(0.0f);
+  float degrid = (float)args[6].AsFloat(1.0f);
+  float pfactor = (float)args[7].AsFloat(0.0f);
+  int ncpu = args[8].AsInt(1);
+  bool measure = args[9].AsBool(true);
+  const int warmup = 2;
+  const int rounds = 3;
+  int frames = args[11].AsInt(10);
+  int start = args[10].AsInt(std::max(0, (vi.num_frames - frames - warmup) / 2)); // middle of the clip
+  const char *bwlist = args[12].AsString("16,24,32,48,64");
+  const char *overlaplist = args[13].AsString("4,3,2");
+  const char *wintypelist = args[14].AsString("0,1,2");
+  int cpuflags = env->GetCPUFlags();
+  const char *optlist = args[15].AsString((cpuflags & CPUF_AVX2) ? "1,2" : "1");
+  double minpsnr = args[16].AsFloat(40.0f);
+  double minssim = args[17].AsFloat(0.98f);
+  const char *cachepath = args[18].AsString("");
+  const char *logpath = args[19].AsString("");
+
+  if (frames < 1)
+    env->ThrowError("FFT3DFilter_Tune: frames must be at least 1");
+  if (start < 0 || start + warmup + frames > vi.num_frames)
+    env->ThrowError("FFT3DFilter_Tune: clip is too short for start=%d and frames=%d (+%d warmup)", start, frames, warmup);
+
+  std::vector<int> bws = ParseInts(bwlist), overlaps = ParseInts(overlaplist), wintypes = ParseInts(wintypelist), opts = ParseInts(optlist);
+  if (bws.empty() || overlaps.empty() || wintypes.empty() || opts.empty())
+    env->ThrowError("FFT3DFilter_Tune: empty bws, overlaps, wintypes or opts list");
+
+  // per resolution and format, and everything else which changes the result
+  char key[512];
+  snprintf(key, sizeof(key), "%dx%d pixel_type=%d sigma=%g beta=%g plane=%d bt=%d sharpen=%g degrid=%g pfactor=%g ncpu=%d measure=%d cpu=%d bws=%s overlaps=%s wintypes=%s opts=%s psnr=%g ssim=%g",
+    vi.width, vi.height, vi.pixel_type, sigma, beta, plane, bt, sharpen, degrid, pfactor, ncpu, (int)measure, cpuflags, bwlist, overlaplist, wintypelist, optlist, minpsnr, minssim);
+  {
+    std::lock_guard<std::mutex> lock(tunemutex);
+    auto hit = tunecache.find(key);
+    if (hit == tunecache.end() && *cachepath)
+    {
+      FILE *f = fopen(cachepath, "r");
+      char line[1024];
+      while (f && fgets(line, sizeof(line), f))
+      {
+        char *tab = strchr(line, '\t');
+        if (tab == nullptr)
+          continue;
+        *tab = 0;
+        std::string value(tab + 1);
+        while (!value.empty() && (value.back() == '\n' || value.back() == '\r'))
+          value.pop_back();
+        tunecache[line] = value;
+      }
+      if (f)
+        fclose(f);
+      hit = tunecache.find(key);
+    }
+    if (hit != tunecache.end())
+      return env->SaveString(hit->second.c_str());
+  }
+
+  // the filter with the fixed arguments and one configuration, bw<0: the defaults.
+  // Returns frames/s of the sample, its frames in out if given.
+  auto run = [&](const TuneConfig &c, std::vector<PVideoFrame> *out) {
+    std::vector<AVSValue> values = { clip, sigma, beta, plane, bt, sharpen, degrid, pfactor, ncpu, measure };
+    std::vector<const char *> names = { nullptr, "sigma", "beta", "plane", "bt", "sharpen", "degrid", "pfactor", "ncpu", "measure" };
+    if (c.bw > 0)
+    {
+      values.insert(values.end(), { c.bw, c.bw, c.ow, c.ow, c.wintype, c.opt });
+      names.insert(names.end(), { "bw", "bh", "ow", "oh", "wintype", "opt" });
+    }
+    PClip filtered = env->Invoke("FFT3DFilter", AVSValue(values.data(), (int)values.size()), names.data()).AsClip();
+    for (int n = start; n < start + warmup; n++)
+      filtered->GetFrame(n, env); // FFTW planning, buffers, pipeline
+    auto t0 = std::chrono::steady_clock::now();
+    for (int n = start + warmup; n < start + warmup + frames; n++)
+    {
+      PVideoFrame f = filtered->GetFrame(n, env);
+      if (out)
+        out->push_back(f);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    return sec > 0 ? frames / sec : 0.0;
+  };
+
+  std::vector<PVideoFrame> ref;
+  run({ -1, 0, 0, 0 }, &ref);
+  PlaneReader reader(vi, plane);
+
+  std::vector<TuneResult> results;
+  for (int opt : opts)
+    for (int bw : bws)
+      for (int overlap : overlaps)
+        for (int wintype : wintypes)
+        {
+          if (bw <= 0 || overlap < 2)
+            env->ThrowError("FFT3DFilter_Tune: bws must be positive and overlaps at least 2");
+          results.push_back({ { bw, bw / overlap, wintype, opt }, 0, 0, 0, false });
+        }
+
+  // Every combination is timed in each of the rounds, a round runs all of them once, so that
+  // a slow phase of the machine (other load, clock changes) does not hit only some of them.
+  // The best round counts. The first round also compares the output to the reference, frame by frame,
+  // the later ones time only the accepted combinations.
+  for (int round = 0; round < rounds; round++)
+    for (TuneResult &r : results)
+    {
+      if (round > 0)
+      {
+        if (r.ok)
+          r.fps = std::max(r.fps, run(r.config, nullptr));
+        continue;
+      }
+      std::vector<PVideoFrame> out;
+      r.fps = run(r.config, &out);
+      double se = 0, ssim = 0;
+      size_t count = 0;
+      for (size_t n = 0; n < out.size(); n++)
+      {
+        for (int p = 0; p < reader.Count(); p++)
+          SquaredError(reader.View(out[n], p), reader.View(ref[n], p), se, count);
+        ssim += SSIM(reader.View(out[n], 0), reader.View(ref[n], 0));
+      }
+      double mse = count ? se / count : 0;
+      r.psnr = mse > 0 ? 10 * log10(1.0 / mse) : 999.0;
+      r.ssim = ssim / out.size();
+      r.ok = r.psnr >= minpsnr && r.ssim >= minssim;
+    }
+
+  const TuneResult *best = nullptr;
+  for (const TuneResult &r : results)
+    if (r.ok && (best == nullptr || r.fps > best->fps))
+      best = &r;
+  if (best == nullptr) // only with lists not containing the defaults
+    env->ThrowError("FFT3DFilter_Tune: no combination is within psnr=%g and ssim=%g", minpsnr, minssim);
+
+  char result[128];
+  snprintf(result, sizeof(result), "bw=%d, bh=%d, ow=%d, oh=%d, wintype=%d, opt=%d",
+    best->config.bw, best->config.bw, best->config.ow, best->config.ow, best->config.wintype, best->config.opt);
+
+  if (*logpath)
+  {
+    FILE *f = fopen(logpath, "w");
+    if (f)
+    {
+      fprintf(f, "# %s\n# bw ow wintype opt frames/s psnr ssim ok\n", key);
+      for (const TuneResult &r : results)
+        fprintf(f, "%d %d %d %d %.2f %.2f %.5f %d\n", r.config.bw, r.config.ow, r.config.wintype, r.config.opt, r.fps, r.psnr, r.ssim, r.ok);
+      fprintf(f, "# result: %s\n", result);
+      fclose(f);
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(tunemutex);
+    tunecache[key] = result;
+    if (*cachepath)
+    {
+      FILE *f = fopen(cachepath, "a");
+      if (f)
+      {
+        fprintf(f, "%s\t%s\n", key, result);
+        fclose(f);
+      }
+    }
+  }
+  return env->SaveString(result);
+}
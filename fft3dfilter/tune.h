@@ -0,0 +1,22 @@
+//
+//	FFT3DFilter plugin for Avisynth 2.6 and Avisynth+ - 3D Frequency Domain filter
+//  FFT3DFilter_Tune: block size, overlap, window and kernel set tuner - v2.11
+//
+//	This program is free software; you can redistribute it and/or modify
+//	it under the terms of the GNU General Public License version 2 as published by
+//	the Free Software Foundation.
+//
+//-----------------------------------------------------------------------------------------
+#ifndef __FFT3D_TUNE_H__
+#define __FFT3D_TUNE_H__
+
+#include "avisynth.h"
+
+// FFT3DFilter_Tune(clip, ...) returns the fastest "bw=.., bh=.., ow=.., oh=.., wintype=.., opt=.."
+// whose output on a sample of the clip is within psnr/ssim of the output of the default block settings.
+#define FFT3DFILTER_TUNE_PARAMS "c[sigma]f[beta]f[plane]i[bt]i[sharpen]f[degrid]f[pfactor]f[ncpu]i[measure]b" \
+  "[start]i[frames]i[bws]s[overlaps]s[wintypes]s[opts]s[psnr]f[ssim]f[cache]s[log]s"
+
+AVSValue __cdecl Create_FFT3DFilterTune(AVSValue args, void* user_data, IScriptEnvironment* env);
+
+#endif // __FFT3D_TUNE_H__
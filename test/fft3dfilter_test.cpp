@@ -0,0 +1,534 @@
+// fft3dfilter_test: golden output and cross-ISA equivalence test, run by ctest.
+//
+// For one source format, every bt (-1..5) with degrid, pfactor, sharpen and dehalo
+// off and on is run on a small synthetic noisy clip (avs_stub.cpp host), once for
+// each CPU dispatch variant: C (CPU flags 0), SSE2 and the detected set (AVX2).
+// Checked for every combination:
+//   - each SIMD variant against the C output: largest pixel difference within the
+//     tolerance (1 code value, for 16 bit and float half an 8 bit code value)
+//   - the C output against the stored golden checksum: mean, rms and position weighted
+//     rms of the residual (output - source) in 8 bit units, equal within 0.002. They
+//     are not bit exact hashes since FFTW may pick other codelets on another build.
+// Then for bt=2..5, with the C and each SIMD variant, the output of halfcache=true is
+// compared to the float cache: PSNR at least 68 dB (8 bit scale).
+// Then with the detected set, bit exact against the default path (ncpu=1, frames read
+// in order 0..4), for every bt with degrid off and on:
+//   - frames read in reverse, jumping and stepping back (pipeline, ring cache)
+//   - ncpu=4 in order and out of order (row parallel Kalman, parallel ring refill); out of
+//     order bt=0, which keeps its state from the frame read before, against the same order
+//   - removemean=true with ncpu=4 out of order, against removemean=true
+//   - plane=4 (planes merged in one pass, YUY2 packed) against plane=0, 1 and 2 in a chain
+//   - membudget=1 on a 512x384 clip: the row strips must be in use (stats FFT3D_Setup),
+//     against halfcache=true for bt>=2
+// --half checks the FP16 conversions of the halfcache spectra instead: FloatToHalf_C /
+// HalfToFloat_C give the same bits as the F16C versions for all 65536 halves, the floats
+// next to and half way between them, scaled by powers of 2.
+//
+// usage: fft3dfilter_test --format NAME --golden FILE [--update]
+//        fft3dfilter_test --half
+//   --update   write the checksums of this format to FILE instead of checking them
+// Exit code 0: passed, 1: failed, 77: skipped (FFTW library not found; --half: no F16C).
+
+#include "avs_stub.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" const char* __stdcall AvisynthPluginInit3(IScriptEnvironment* env, const AVS_Linkage* const vectors);
+
+// FP16 conversions of fft3dfilter_c.cpp and fft3dfilter_avx2.cpp
+void FloatToHalf_C(const float *src, uint16_t *dst, int count, float scale);
+void HalfToFloat_C(const uint16_t *src, float *dst, int count, float scale);
+void FloatToHalf_F16C(const float *src, uint16_t *dst, int count, float scale);
+void HalfToFloat_F16C(const uint16_t *src, float *dst, int count, float scale);
+
+static const int width = 128, height = 96, frames = 5;
+
+struct Checksum {
+  double mean, rms, wmean;
+};
+
+struct Output {
+  std::vector<double> pixels; // all planes of all frames, native scale
+  double scale; // native value of one 8 bit code value
+};
+
+// frames fetched in the given order (default 0..frames-1), stored in frame order
+static Output ReadPixels(IScriptEnvironment* env, PClip clip, const std::vector<int>& order = {})
+{
+  const VideoInfo& vi = clip->GetVideoInfo();
+  Output out;
+  int bits = vi.BitsPerComponent();
+  out.scale = bits == 32 ? 1.0 / 255 : (double)(1 << (bits - 8));
+  const int planes[] = { PLANAR_Y, PLANAR_U, PLANAR_V };
+  int planecount = !vi.IsPlanar() || vi.IsY() ? 1 : 3; // YUY2: the packed plane
+  std::vector<std::vector<double>> framepixels(frames);
+  for (int i = 0; i < frames; i++)
+  {
+    int n = order.empty() ? i : order[i];
+    PVideoFrame f = clip->GetFrame(n, env);
+    std::vector<double>& px = framepixels[n];
+    px.clear();
+    for (int p = 0; p < planecount; p++)
+    {
+      int plane = vi.IsPlanar() ? planes[p] : 0;
+      const uint8_t* ptr = f->GetReadPtr(plane);
+      int pitch = f->GetPitch(plane);
+      int w = f->GetRowSize(plane) / vi.ComponentSize();
+      int h = f->GetHeight(plane);
+      for (int y = 0; y < h; y++, ptr += pitch)
+        for (int x = 0; x < w; x++)
+        {
+          if (bits == 8)
+            px.push_back(ptr[x]);
+          else if (bits == 32)
+            px.push_back(((const float*)ptr)[x]);
+          else
+            px.push_back(((const uint16_t*)ptr)[x]);
+        }
+    }
+  }
+  for (const std::vector<double>& px : framepixels)
+    out.pixels.insert(out.pixels.end(), px.begin(), px.end());
+  return out;
+}
+
+// FFT3DFilter argument added to or replacing the ones of Render
+struct Arg {
+  const char* name;
+  AVSValue value;
+};
+
+static PClip Filter(IScriptEnvironment* env, PClip src, int bt, float degrid, float pfactor, float sharpen, float dehalo, const std::vector<Arg>& extra = {})
+{
+  std::vector<AVSValue> values = { src, bt, degrid, pfactor, sharpen, dehalo, src->GetVideoInfo().IsY() ? 0 : 4, 3.0f, false, 1 };
+  std::vector<const char*> names = { nullptr, "bt", "degrid", "pfactor", "sharpen", "dehalo", "plane", "sigma", "measure", "ncpu" };
+  for (const Arg& a : extra)
+  {
+    auto it = std::find_if(names.begin() + 1, names.end(), [&](const char* n) { return !strcmp(n, a.name); });
+    if (it != names.end())
+      values[it - names.begin()] = a.value;
+    else
+    {
+      names.push_back(a.name);
+      values.push_back(a.value);
+    }
+  }
+  return env->Invoke("FFT3DFilter", AVSValue(values.data(), (int)values.size()), names.data()).AsClip();
+}
+
+static Output Render(IScriptEnvironment* env, PClip src, int bt, float degrid, float pfactor, float sharpen, float dehalo, const std::vector<Arg>& extra = {}, const std::vector<int>& order = {})
+{
+  return ReadPixels(env, Filter(env, src, bt, degrid, pfactor, sharpen, dehalo, extra), order);
+}
+
+// number of differing samples, 0 for bit exact output
+static size_t Differs(const Output& a, const Output& b)
+{
+  if (a.pixels.size() != b.pixels.size())
+    return std::max(a.pixels.size(), b.pixels.size());
+  size_t count = 0;
+  for (size_t i = 0; i < a.pixels.size(); i++)
+    count += memcmp(&a.pixels[i], &b.pixels[i], sizeof(double)) != 0;
+  return count;
+}
+
+// smallest striprows of the planes in the FFT3D_Setup property (stats=true), -1 if missing
+static int StripRows(IScriptEnvironment* env, PClip clip)
+{
+  PVideoFrame f = clip->GetFrame(0, env);
+  const AVSMap* props = env->getFramePropsRO(f);
+  int error = 0;
+  const char* setup = env->propGetData(props, "FFT3D_Setup", 0, &error);
+  if (error || setup == nullptr)
+    return -1;
+  int rows = -1;
+  for (const char* s = strstr(setup, "striprows="); s; s = strstr(s + 1, "striprows="))
+  {
+    int r = atoi(s + 10);
+    rows = rows < 0 ? r : std::min(rows, r);
+  }
+  return rows;
+}
+
+// keeps every frame, like the cache AviSynth puts between filters: the pipeline of a filter
+// asks its child for the next frame ahead of time, bt=0 of the child must not see it twice
+class FrameCache : public GenericVideoFilter {
+  std::map<int, PVideoFrame> cached;
+  std::mutex lock;
+public:
+  FrameCache(PClip _child) : GenericVideoFilter(_child) {}
+  PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) override
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = cached.find(n);
+    if (it == cached.end())
+      it = cached.emplace(n, child->GetFrame(n, env)).first;
+    return it->second;
+  }
+};
+
+// in dB of the 8 bit scale, 999 if equal
+static double PSNR(const Output& a, const Output& b)
+{
+  double se = 0;
+  for (size_t i = 0; i < a.pixels.size(); i++)
+  {
+    double d = (a.pixels[i] - b.pixels[i]) / a.scale;
+    se += d * d;
+  }
+  double mse = se / std::max<size_t>(a.pixels.size(), 1);
+  return mse > 0 ? 10 * log10(255.0 * 255.0 / mse) : 999.0;
+}
+
+// C and F16C FP16 conversions, bit for bit
+static int CheckHalf()
+{
+  int detected = avsstub::DetectCPUFlags();
+  if (!(detected & CPUF_AVX2) || !(detected & CPUF_F16C))
+  {
+    printf("SKIP: no AVX2 and F16C\n");
+    return 77;
+  }
+  int failed = 0;
+  std::vector<uint16_t> halves(65536);
+  for (int h = 0; h < 65536; h++)
+    halves[h] = (uint16_t)h;
+  for (float scale : { 1.0f, 1.0f / 4096, 32.0f })
+  {
+    std::vector<float> c(65536), f16c(65536);
+    HalfToFloat_C(halves.data(), c.data(), 65536, 1 / scale);
+    HalfToFloat_F16C(halves.data(), f16c.data(), 65536, 1 / scale);
+    for (int h = 0; h < 65536; h++)
+      if (memcmp(&c[h], &f16c[h], sizeof(float)) != 0 && failed++ < 10)
+        printf("FAIL HalfToFloat scale=%g: half %04x: C %a, F16C %a\n", scale, h, c[h], f16c[h]);
+
+    // the float of every half, its neighbours and the ties half way to the next half
+    std::vector<float> floats;
+    for (int h = 0; h < 65536; h++)
+    {
+      float v = c[h];
+      floats.push_back(v);
+      floats.push_back(nextafterf(v, INFINITY));
+      floats.push_back(nextafterf(v, -INFINITY));
+      if ((h & 0x7fff) < 0x7c00 && (h & 0x7fff) != 0x7bff)
+        floats.push_back((v + c[h + 1]) / 2);
+    }
+    int count = (int)floats.size();
+    std::vector<uint16_t> hc(count), hf16c(count);
+    FloatToHalf_C(floats.data(), hc.data(), count, scale);
+    FloatToHalf_F16C(floats.data(), hf16c.data(), count, scale);
+    for (int i = 0; i < count; i++)
+      if (hc[i] != hf16c[i] && failed++ < 10)
+        printf("FAIL FloatToHalf scale=%g: %a: C %04x, F16C %04x\n", scale, floats[i], hc[i], hf16c[i]);
+  }
+  printf("FP16 conversions: C against F16C, %d failures\n", failed);
+  return failed ? 1 : 0;
+}
+
+// of the residual (output - source), so that the checksums see the filtering and not the picture
+static Checksum Sum(const Output& o, const Output& src)
+{
+  double s = 0, s2 = 0, sw = 0, wsum = 0;
+  for (size_t i = 0; i < o.pixels.size(); i++)
+  {
+    double r = (o.pixels[i] - src.pixels[i]) / o.scale;
+    double w = 1 + (i * 7919) % 31; // catches moved or swapped pixels
+    s += r;
+    s2 += r * r;
+    sw += r * r * w;
+    wsum += w;
+  }
+  size_t n = std::max<size_t>(o.pixels.size(), 1);
+  return { s / n, sqrt(s2 / n), sqrt(sw / wsum) };
+}
+
+static std::map<std::string, Checksum> ReadGolden(const char* path)
+{
+  std::map<std::string, Checksum> golden;
+  std::ifstream f(path);
+  std::string line;
+  while (std::getline(f, line))
+  {
+    size_t bar = line.find('|');
+    if (line.empty() || line[0] == '#' || bar == std::string::npos)
+      continue;
+    Checksum c;
+    std::istringstream(line.substr(bar + 1)) >> c.mean >> c.rms >> c.wmean;
+    golden[line.substr(0, bar)] = c;
+  }
+  return golden;
+}
+
+// replaces the lines of this format, keeps the others
+static bool WriteGolden(const char* path, const std::string& format, const std::vector<std::pair<std::string, Checksum>>& sums)
+{
+  std::vector<std::string> lines;
+  {
+    std::ifstream f(path);
+    std::string line;
+    while (std::getline(f, line))
+      if (line.compare(0, format.size() + 1, format + " ") != 0)
+        lines.push_back(line);
+  }
+  if (lines.empty())
+    lines.push_back("# fft3dfilter_test golden checksums of the C output: format bt degrid pfactor sharpen dehalo | residual mean rms weighted rms (8 bit units)");
+  char buf[256];
+  for (auto& s : sums)
+  {
+    snprintf(buf, sizeof(buf), "%s| %.4f %.4f %.4f", s.first.c_str(), s.second.mean, s.second.rms, s.second.wmean);
+    lines.push_back(buf);
+  }
+  std::ofstream f(path);
+  for (auto& l : lines)
+    f << l << "\n";
+  return (bool)f;
+}
+
+int main(int argc, char** argv)
+{
+  const char* format = nullptr;
+  const char* goldenpath = nullptr;
+  bool update = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--format") && i + 1 < argc) format = argv[++i];
+    else if (!strcmp(argv[i], "--golden") && i + 1 < argc) goldenpath = argv[++i];
+    else if (!strcmp(argv[i], "--update")) update = true;
+    else if (!strcmp(argv[i], "--half")) return CheckHalf();
+    else
+    {
+      fprintf(stderr, "usage: fft3dfilter_test --format NAME --golden FILE [--update] | --half\n");
+      return 2;
+    }
+  }
+  int pixel_type = format ? avsstub::PixelTypeFromName(format) : 0;
+  if (pixel_type == 0 || goldenpath == nullptr)
+  {
+    fprintf(stderr, "usage: fft3dfilter_test --format NAME --golden FILE [--update] | --half\n");
+    return 2;
+  }
+
+  struct Variant {
+    const char* name;
+    int flags;
+  };
+  int detected = avsstub::DetectCPUFlags();
+  std::vector<Variant> variants;
+  const int sse2 = CPUF_MMX | CPUF_INTEGER_SSE | CPUF_SSE | CPUF_SSE2;
+  if ((detected & sse2) == sse2)
+    variants.push_back({ "SSE2", detected & (sse2 | CPUF_SSE3 | CPUF_SSSE3 | CPUF_SSE4_1 | CPUF_SSE4_2) });
+  if (detected & CPUF_AVX2)
+    variants.push_back({ "AVX2", detected });
+
+  std::map<std::string, Checksum> golden = ReadGolden(goldenpath);
+  std::vector<std::pair<std::string, Checksum>> sums;
+  int failed = 0, checked = 0;
+
+  IScriptEnvironment* env = avsstub::CreateEnvironment(0);
+  AvisynthPluginInit3(env, env->GetAVSLinkage());
+  {
+    PClip src = avsstub::CreateNoiseClip(env, pixel_type, width, height, frames, 10.0f, 1234);
+    Output source = ReadPixels(env, src);
+    // 1 code value, at least half an 8 bit code value
+    int bits = src->GetVideoInfo().BitsPerComponent();
+    double tolerance = bits == 32 ? 0.5 / 255 : std::max(1.0, 0.5 * (1 << (bits - 8)));
+
+    for (int bt = -1; bt <= 5; bt++)
+      for (float degrid : { 0.0f, 1.0f })
+        for (float pfactor : { 0.0f, 0.1f })
+          for (float sharpen : { 0.0f, 0.3f })
+            for (float dehalo : { 0.0f, 0.5f })
+            {
+              char key[128];
+              snprintf(key, sizeof(key), "%s bt=%d degrid=%g pfactor=%g sharpen=%g dehalo=%g ", format, bt, degrid, pfactor, sharpen, dehalo);
+              try
+              {
+                avsstub::SetCPUFlags(env, 0);
+                Output ref = Render(env, src, bt, degrid, pfactor, sharpen, dehalo);
+                Checksum c = Sum(ref, source);
+                sums.push_back({ key, c });
+                checked++;
+
+                for (const Variant& v : variants)
+                {
+                  avsstub::SetCPUFlags(env, v.flags);
+                  Output o = Render(env, src, bt, degrid, pfactor, sharpen, dehalo);
+                  double maxdiff = 0;
+                  for (size_t i = 0; i < ref.pixels.size(); i++)
+                    maxdiff = std::max(maxdiff, fabs(o.pixels[i] - ref.pixels[i]));
+                  if (maxdiff > tolerance)
+                  {
+                    printf("FAIL %s: %s differs from C by %g\n", key, v.name, maxdiff);
+                    failed++;
+                  }
+                }
+
+                if (!update)
+                {
+                  auto g = golden.find(key);
+                  if (g == golden.end())
+                  {
+                    printf("FAIL %s: no golden checksum\n", key);
+                    failed++;
+                  }
+                  else if (fabs(g->second.mean - c.mean) > 0.002 || fabs(g->second.rms - c.rms) > 0.002 || fabs(g->second.wmean - c.wmean) > 0.002)
+                  {
+                    printf("FAIL %s: checksum %.4f %.4f %.4f, golden %.4f %.4f %.4f\n", key, c.mean, c.rms, c.wmean,
+                      g->second.mean, g->second.rms, g->second.wmean);
+                    failed++;
+                  }
+                }
+              }
+              catch (const AvisynthError& e)
+              {
+                if (strstr(e.msg, "libfftw3f") || strstr(e.msg, "fftw3.dll"))
+                {
+                  printf("SKIP: %s\n", e.msg);
+                  avsstub::DeleteEnvironment(env);
+                  return 77;
+                }
+                printf("FAIL %s: %s\n", key, e.msg);
+                failed++;
+              }
+            }
+
+    // FP16 cache of the past frames against the float cache, with the C conversion and F16C.
+    // At 8 bit the difference is single code values flipped at the rounding boundaries: 70 dB
+    // for bt=2 with the SSE kernels (0.6% of the pixels), the bound leaves room for other FFTW codelets.
+    std::vector<Variant> all = { { "C", 0 } };
+    all.insert(all.end(), variants.begin(), variants.end());
+    for (int bt = 2; !update && bt <= 5; bt++)
+      for (float degrid : { 0.0f, 1.0f })
+        for (const Variant& v : all)
+        {
+          char key[128];
+          snprintf(key, sizeof(key), "%s bt=%d degrid=%g halfcache=true %s", format, bt, degrid, v.name);
+          try
+          {
+            avsstub::SetCPUFlags(env, v.flags);
+            Output ref = Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f);
+            Output half = Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, { { "halfcache", true } });
+            double psnr = PSNR(half, ref);
+            if (psnr < 68.0)
+            {
+              printf("FAIL %s: PSNR %.2f dB against halfcache=false\n", key, psnr);
+              failed++;
+            }
+            checked++;
+          }
+          catch (const AvisynthError& e)
+          {
+            printf("FAIL %s: %s\n", key, e.msg);
+            failed++;
+          }
+        }
+
+    // Processing paths, bit exact against the default one (ncpu=1, frames read in order),
+    // with the detected CPU flags
+    if (!update)
+    {
+      avsstub::SetCPUFlags(env, detected);
+      const std::vector<std::vector<int>> orders = { { 4, 3, 2, 1, 0 }, { 2, 4, 0, 3, 1 }, { 1, 0, 3, 2, 4 } };
+      auto check = [&](const char* what, int bt, float degrid, const std::function<void(const char*)>& run) {
+        char key[160];
+        snprintf(key, sizeof(key), "%s bt=%d degrid=%g %s", format, bt, degrid, what);
+        try
+        {
+          run(key);
+        }
+        catch (const AvisynthError& e)
+        {
+          printf("FAIL %s: %s\n", key, e.msg);
+          failed++;
+        }
+        checked++;
+      };
+      auto expect = [&](const char* key, const Output& o, const Output& ref) {
+        size_t n = Differs(o, ref);
+        if (n)
+        {
+          printf("FAIL %s: %zu samples differ from the default path\n", key, n);
+          failed++;
+        }
+      };
+
+      for (int bt = -1; bt <= 5; bt++)
+        for (float degrid : { 0.0f, 1.0f })
+        {
+          Output ref = Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f);
+          // bt=0 carries its state from the frame read before, so out of order it is
+          // compared to the default path read in the same order
+          auto inorder = [&](const std::vector<int>& order, const std::vector<Arg>& extra) {
+            return bt == 0 ? Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, extra, order) : Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, extra);
+          };
+          // pipeline and ring cache (bt>=2) on seeks and reverse reads
+          if (bt != 0)
+            check("frames out of order", bt, degrid, [&](const char* key) {
+              for (auto& order : orders)
+                expect(key, Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, {}, order), ref);
+            });
+          // row parallel Kalman (bt=0), parallel refill of the ring cache after a seek (bt>=2)
+          check("ncpu=4 frames out of order", bt, degrid, [&](const char* key) {
+            expect(key, Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, { { "ncpu", 4 } }), ref);
+            for (auto& order : orders)
+              expect(key, Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, { { "ncpu", 4 } }, order), inorder(order, {}));
+          });
+          check("removemean=true ncpu=4 frames out of order", bt, degrid, [&](const char* key) {
+            expect(key, Render(env, src, bt, degrid, 0.0f, 0.0f, 0.0f, { { "removemean", true }, { "ncpu", 4 } }, orders[1]),
+              inorder(orders[1], { { "removemean", true } }));
+          });
+          // the planes of plane=4 merged in one pass against one plane after the other
+          if (!src->GetVideoInfo().IsY())
+            check("plane=4 against plane=0,1,2", bt, degrid, [&](const char* key) {
+              PClip chain = src;
+              for (int plane = 0; plane < 3; plane++)
+                chain = new FrameCache(Filter(env, chain, bt, degrid, 0.0f, 0.0f, 0.0f, { { "plane", plane } }));
+              expect(key, ReadPixels(env, chain), ref);
+            });
+        }
+
+      // membudget: 1 MB makes the filters of a bigger clip work in row strips, against
+      // the full frame path; over budget bt>=2 also keeps its cache in FP16
+      PClip big = avsstub::CreateNoiseClip(env, pixel_type, 512, 384, frames, 10.0f, 4321);
+      for (int bt = -1; bt <= 5; bt++)
+        check("membudget=1", bt, 1.0f, [&](const char* key) {
+          Output ref = Render(env, big, bt, 1.0f, 0.0f, 0.0f, 0.0f, { { "halfcache", bt >= 2 } });
+          PClip strips = Filter(env, big, bt, 1.0f, 0.0f, 0.0f, 0.0f, { { "membudget", 1 }, { "stats", true } });
+          expect(key, ReadPixels(env, strips), ref);
+          int rows = StripRows(env, strips);
+          if (rows <= 0)
+          {
+            printf("FAIL %s: no row strips (striprows %d)\n", key, rows);
+            failed++;
+          }
+        });
+    }
+  }
+  avsstub::DeleteEnvironment(env);
+
+  if (update)
+  {
+    if (!WriteGolden(goldenpath, format, sums))
+    {
+      fprintf(stderr, "cannot write %s\n", goldenpath);
+      return 1;
+    }
+    printf("%s: %d checksums written to %s\n", format, (int)sums.size(), goldenpath);
+    return 0;
+  }
+  printf("%s: %d combinations, C", format, checked);
+  for (const Variant& v : variants)
+    printf(" %s", v.name);
+  printf(", %d failures\n", failed);
+  return failed ? 1 : 0;
+}